@@ -0,0 +1,4 @@
+source conda.sh
+
+cd ../../tree_maximum_matching_build/
+./ConstrainedTreeMatchingTest "$@"
@@ -0,0 +1,6 @@
+source conda.sh
+
+# Timings need a release build without debugging output:
+# cmake -S ../ -B ../../tree_maximum_matching_build -DCMAKE_BUILD_TYPE=Release -DTREE_MATCHING_DEBUG=OFF
+cd ../../tree_maximum_matching_build/
+./TreeMatchingBenchmark "$@"
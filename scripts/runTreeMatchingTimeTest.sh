@@ -1,8 +1,4 @@
 source conda.sh
 
 cd ../../tree_maximum_matching_build/
-if [ $# -eq 2 ]; then
-    ./TreeMatchingTimeTest "$1" "$2"
-elif [ $# -eq 3 ]; then
-    ./TreeMatchingTimeTest "$1" "$2" "$3"
-fi
\ No newline at end of file
+./TreeMatchingTimeTest "$@"
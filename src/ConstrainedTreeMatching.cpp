@@ -0,0 +1,96 @@
+#include "ConstrainedTreeMatching.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#include "FrameArena.hpp"
+#include "HungarianAlgorithm.hpp"
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Minimum number of parent pairs per task when a level is solved in parallel,
+// the problems are too small to be worth a task each.
+constexpr size_t kConstrainedPairsPerTask = 32;
+
+template <typename T>
+std::vector<int> matchTreesConstrained(const TreeWrapper<T>& treeA,
+                                       const TreeWrapper<T>& treeB,
+                                       const std::string& similarityType,
+                                       ThreadPool& pool) {
+  T (*similarity)(const std::vector<T>&, const std::vector<T>&);
+  if (similarityType == "cosine") {
+    similarity = computeCosineSimilarity<T>;
+  } else if (similarityType == "euclidean") {
+    similarity = computeEuclideanSimilarity<T>;
+  } else {
+    std::cout << "unknown similarityType " << similarityType << std::endl;
+    exit(1);
+  }
+
+  std::vector<int> matching(treeA.nodes.size(), -1);
+  if (treeA.nodes.empty() || treeB.nodes.empty()) return matching;
+
+  // Feature vectors as matchTrees computes them.
+  TreeEmbedding<T> embeddingA, embeddingB;
+  std::vector<std::vector<T>> featuresA, featuresB;
+  generatePairFeatures(treeA, treeB, embeddingA, embeddingB, featuresA,
+                       featuresB);
+
+  // Pairs of matched nodes whose children are matched next.
+  std::vector<std::pair<int, int>> level(1, std::make_pair(0, 0));
+  matching[0] = 0;
+  // Matched children of every pair of the current level.
+  std::vector<std::vector<std::pair<int, int>>> childPairs;
+
+  while (!level.empty()) {
+    childPairs.resize(level.size());
+    pool.parallelFor(
+        0, level.size(),
+        [&](size_t p) {
+          // Scratch of the worker, reused for all its problems.
+          static thread_local FrameArena arena;
+          static thread_local std::vector<std::vector<T>> costMatrix;
+
+          std::vector<std::pair<int, int>>& pairs = childPairs[p];
+          pairs.clear();
+          const std::vector<int>& childrenA =
+              treeA.nodes[level[p].first].children;
+          const std::vector<int>& childrenB =
+              treeB.nodes[level[p].second].children;
+          if (childrenA.empty() || childrenB.empty()) return;
+
+          // cost[i][j] = -similarity of child i of A and child j of B.
+          costMatrix.resize(childrenA.size());
+          for (size_t i = 0; i < childrenA.size(); ++i) {
+            costMatrix[i].resize(childrenB.size());
+            for (size_t j = 0; j < childrenB.size(); ++j) {
+              costMatrix[i][j] = -similarity(featuresA[childrenA[i]],
+                                             featuresB[childrenB[j]]);
+            }
+          }
+
+          std::vector<int> childMatching =
+              hungarianAlgorithm(costMatrix, arena).second;
+          for (size_t i = 0; i < childrenA.size(); ++i) {
+            if (childMatching[i] < 0) continue;
+            int childA = childrenA[i];
+            int childB = childrenB[childMatching[i]];
+            matching[childA] = childB;
+            pairs.push_back(std::make_pair(childA, childB));
+          }
+        },
+        kConstrainedPairsPerTask);
+
+    level.clear();
+    for (const std::vector<std::pair<int, int>>& pairs : childPairs) {
+      level.insert(level.end(), pairs.begin(), pairs.end());
+    }
+  }
+  return matching;
+}
+
+// Explicit instantiations for type to use.
+template std::vector<int> matchTreesConstrained<float>(
+    const TreeWrapper<float>& treeA, const TreeWrapper<float>& treeB,
+    const std::string& similarityType, ThreadPool& pool);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+#include "TreeNode.hpp"
+
+// Matching that respects the topology of the trees: a node of treeA can only
+// be matched to a node of treeB if their parents are matched to each other.
+// The roots are matched first, then the trees are traversed top-down level by
+// level, and the children of every matched pair are assigned to each other by
+// a small assignment problem on the node feature vectors. The problems of a
+// level are independent and are solved in parallel on pool. Children without
+// a counterpart stay unmatched together with their subtrees.
+//
+// Compared to matchTrees this solves many tiny problems instead of one
+// N x M problem, and every match is structurally valid. The result has the
+// format of matchTrees and uses the same feature vectors. The trees are not
+// modified.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+std::vector<int> matchTreesConstrained(
+    const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB,
+    const std::string& similarityType = "cosine",
+    ThreadPool& pool = defaultThreadPool());
@@ -0,0 +1,230 @@
+#include "FeatureNormalizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+template <typename T>
+void FeatureBounds<T>::update(const TreeNode<T>& node, T tpeRadius) {
+  if (tpeRadius < tpeRadiusMin) tpeRadiusMin = tpeRadius;
+  if (tpeRadius > tpeRadiusMax) tpeRadiusMax = tpeRadius;
+
+  if (node.posX < posXMin) posXMin = node.posX;
+  if (node.posX > posXMax) posXMax = node.posX;
+  if (node.posY < posYMin) posYMin = node.posY;
+  if (node.posY > posYMax) posYMax = node.posY;
+  if (node.offset > offsetMax) offsetMax = node.offset;
+}
+
+template <typename T>
+void FeatureBounds<T>::merge(const FeatureBounds<T>& other) {
+  tpeRadiusMin = std::min(tpeRadiusMin, other.tpeRadiusMin);
+  tpeRadiusMax = std::max(tpeRadiusMax, other.tpeRadiusMax);
+  posXMin = std::min(posXMin, other.posXMin);
+  posXMax = std::max(posXMax, other.posXMax);
+  posYMin = std::min(posYMin, other.posYMin);
+  posYMax = std::max(posYMax, other.posYMax);
+  offsetMax = std::max(offsetMax, other.offsetMax);
+}
+
+// Feature vector of node whose TPE is given by tpeX, tpeY, tpeRadius and
+// tpeAngle.
+template <typename T>
+void computeFeatureVector(const TreeNode<T>& node, T tpeX, T tpeY, T tpeRadius,
+                          T tpeAngle, const FeatureBounds<T>& bounds,
+                          std::vector<T>& featureVector) {
+  featureVector.clear();
+
+  // Append precomputed TPE embedding.
+  featureVector.push_back(tpeX);
+  featureVector.push_back(tpeY);
+
+  // Normalize tpeRadius using min-max scaling.
+  T radiusRange = bounds.tpeRadiusMax - bounds.tpeRadiusMin;
+  T normRadius = (radiusRange == 0)
+                     ? 0.5
+                     : (tpeRadius - bounds.tpeRadiusMin) / radiusRange;
+  featureVector.push_back(normRadius);
+
+  // Convert tpe angle to sine and cosine components.
+  featureVector.push_back(std::sin(tpeAngle));
+  featureVector.push_back(std::cos(tpeAngle));
+
+  // Normalize original position using min-max scaling.
+  T posXRange = bounds.posXMax - bounds.posXMin;
+  T posYRange = bounds.posYMax - bounds.posYMin;
+  T normPosX =
+      (posXRange == 0) ? 0.5 : (node.posX - bounds.posXMin) / posXRange;
+  T normPosY =
+      (posYRange == 0) ? 0.5 : (node.posY - bounds.posYMin) / posYRange;
+  featureVector.push_back(normPosX);
+  featureVector.push_back(normPosY);
+
+  // Normalize offset by dividing by the maximum offset.
+  T normOffset = (bounds.offsetMax == 0) ? 0.0 : node.offset / bounds.offsetMax;
+  featureVector.push_back(normOffset);
+
+  featureVector.push_back(node.angle / (2 * M_PI));
+
+  featureVector.push_back(node.type);
+}
+
+template <typename T>
+void computeFeatureVector(const TreeNode<T>& node,
+                          const FeatureBounds<T>& bounds,
+                          std::vector<T>& featureVector) {
+  computeFeatureVector(node, node.tpeX, node.tpeY, node.tpeRadius,
+                       node.tpeAngle, bounds, featureVector);
+}
+
+template <typename T>
+void computeFeatureVector(const TreeNode<T>& node,
+                          const TreeEmbedding<T>& embedding, size_t idx,
+                          const FeatureBounds<T>& bounds,
+                          std::vector<T>& featureVector) {
+  computeFeatureVector(node, embedding.tpeX[idx], embedding.tpeY[idx],
+                       embedding.tpeRadius[idx], embedding.tpeAngle[idx],
+                       bounds, featureVector);
+}
+
+// Bounds of the nodes of tree. embedding: TPE of tree, nullptr if it is stored
+// in the nodes.
+template <typename T>
+static FeatureBounds<T> computeTreeBounds(const TreeWrapper<T>& tree,
+                                          const TreeEmbedding<T>* embedding) {
+  FeatureBounds<T> bounds;
+  for (size_t i = 0; i < tree.nodes.size(); ++i) {
+    const TreeNode<T>& node = tree.nodes[i];
+    bounds.update(node, embedding ? embedding->tpeRadius[i] : node.tpeRadius);
+  }
+  return bounds;
+}
+
+template <typename T>
+FeatureNormalizer<T>::FeatureNormalizer(size_t windowSize)
+    : windowSize_(windowSize) {}
+
+template <typename T>
+void FeatureNormalizer<T>::reset() {
+  bounds_ = FeatureBounds<T>();
+  lastTreeBounds_ = FeatureBounds<T>();
+  window_.clear();
+}
+
+template <typename T>
+void FeatureNormalizer<T>::addTreeBounds(const FeatureBounds<T>& treeBounds) {
+  lastTreeBounds_ = treeBounds;
+  if (windowSize_ == 0) {
+    bounds_.merge(treeBounds);
+    return;
+  }
+
+  window_.push_back(treeBounds);
+  if (window_.size() > windowSize_) window_.pop_front();
+  bounds_ = FeatureBounds<T>();
+  for (const FeatureBounds<T>& bounds : window_) {
+    bounds_.merge(bounds);
+  }
+}
+
+template <typename T>
+void FeatureNormalizer<T>::generateFeatureVectors(
+    const TreeWrapper<T>& tree, std::vector<std::vector<T>>& features) {
+  generateFeatureVectors(tree, nullptr, features);
+}
+
+template <typename T>
+void FeatureNormalizer<T>::generateFeatureVectors(
+    const TreeWrapper<T>& tree, const TreeEmbedding<T>& embedding,
+    std::vector<std::vector<T>>& features) {
+  generateFeatureVectors(tree, &embedding, features);
+}
+
+template <typename T>
+void FeatureNormalizer<T>::generateFeatureVectors(
+    const TreeWrapper<T>& tree, const TreeEmbedding<T>* embedding,
+    std::vector<std::vector<T>>& features) {
+  features.resize(tree.nodes.size());
+  if (tree.nodes.empty()) return;
+
+  auto updateBounds = [&](FeatureBounds<T>& bounds, size_t i) {
+    const TreeNode<T>& node = tree.nodes[i];
+    bounds.update(node, embedding ? embedding->tpeRadius[i] : node.tpeRadius);
+  };
+  auto computeFeatures = [&](size_t i) {
+    if (embedding) {
+      computeFeatureVector(tree.nodes[i], *embedding, i, bounds_, features[i]);
+    } else {
+      computeFeatureVector(tree.nodes[i], bounds_, features[i]);
+    }
+  };
+
+  // Seed the bounds with the first tree.
+  if (!bounds_.valid()) {
+    addTreeBounds(computeTreeBounds(tree, embedding));
+    for (size_t i = 0; i < tree.nodes.size(); ++i) {
+      computeFeatures(i);
+    }
+    return;
+  }
+
+  // Normalize with the current bounds and collect the bounds of the tree in
+  // the same pass.
+  FeatureBounds<T> treeBounds;
+  for (size_t i = 0; i < tree.nodes.size(); ++i) {
+    computeFeatures(i);
+    updateBounds(treeBounds, i);
+  }
+  if (!frozen_) addTreeBounds(treeBounds);
+}
+
+template <typename T>
+void FeatureNormalizer<T>::generateFeatureVectors(
+    const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB,
+    std::vector<std::vector<T>>& featuresA,
+    std::vector<std::vector<T>>& featuresB) {
+  featuresA.resize(treeA.nodes.size());
+  featuresB.resize(treeB.nodes.size());
+
+  // Seed the bounds with the first pair, which is then normalized with them.
+  if (!bounds_.valid()) {
+    addTreeBounds(computeTreeBounds<T>(treeA, nullptr));
+    addTreeBounds(computeTreeBounds<T>(treeB, nullptr));
+    for (size_t i = 0; i < treeA.nodes.size(); ++i) {
+      computeFeatureVector(treeA.nodes[i], bounds_, featuresA[i]);
+    }
+    for (size_t i = 0; i < treeB.nodes.size(); ++i) {
+      computeFeatureVector(treeB.nodes[i], bounds_, featuresB[i]);
+    }
+    return;
+  }
+
+  // Normalize with the current bounds and collect the bounds of the trees in
+  // the same pass.
+  FeatureBounds<T> treeBoundsA, treeBoundsB;
+  for (size_t i = 0; i < treeA.nodes.size(); ++i) {
+    computeFeatureVector(treeA.nodes[i], bounds_, featuresA[i]);
+    treeBoundsA.update(treeA.nodes[i]);
+  }
+  for (size_t i = 0; i < treeB.nodes.size(); ++i) {
+    computeFeatureVector(treeB.nodes[i], bounds_, featuresB[i]);
+    treeBoundsB.update(treeB.nodes[i]);
+  }
+
+  if (frozen_) return;
+  if (treeBoundsA != lastTreeBounds_) addTreeBounds(treeBoundsA);
+  addTreeBounds(treeBoundsB);
+}
+
+// Explicit instantiations for type to use.
+template struct FeatureBounds<float>;
+
+template void computeFeatureVector<float>(const TreeNode<float>& node,
+                                          const FeatureBounds<float>& bounds,
+                                          std::vector<float>& featureVector);
+
+template void computeFeatureVector<float>(
+    const TreeNode<float>& node, const TreeEmbedding<float>& embedding,
+    size_t idx, const FeatureBounds<float>& bounds,
+    std::vector<float>& featureVector);
+
+template class FeatureNormalizer<float>;
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <vector>
+
+#include "TreeNode.hpp"
+
+// Min-max bounds of the node attributes normalized in the feature vectors.
+template <typename T>
+struct FeatureBounds {
+  T tpeRadiusMin = std::numeric_limits<T>::max();
+  T tpeRadiusMax = std::numeric_limits<T>::lowest();
+  T posXMin = std::numeric_limits<T>::max();
+  T posXMax = std::numeric_limits<T>::lowest();
+  T posYMin = std::numeric_limits<T>::max();
+  T posYMax = std::numeric_limits<T>::lowest();
+  T offsetMax = 0.0;
+
+  // Whether any node has been accumulated.
+  bool valid() const { return tpeRadiusMin <= tpeRadiusMax; }
+
+  void update(const TreeNode<T>& node) { update(node, node.tpeRadius); }
+  // Same as above, with the TPE radius given separately.
+  void update(const TreeNode<T>& node, T tpeRadius);
+  void merge(const FeatureBounds<T>& other);
+
+  bool operator==(const FeatureBounds<T>& other) const {
+    return tpeRadiusMin == other.tpeRadiusMin &&
+           tpeRadiusMax == other.tpeRadiusMax && posXMin == other.posXMin &&
+           posXMax == other.posXMax && posYMin == other.posYMin &&
+           posYMax == other.posYMax && offsetMax == other.offsetMax;
+  }
+  bool operator!=(const FeatureBounds<T>& other) const {
+    return !(*this == other);
+  }
+};
+
+// Number of elements of a node feature vector.
+constexpr int kFeatureDimension = 10;
+
+// Compute the feature vector of node normalized with bounds, featureVector is
+// overwritten and keeps its capacity. The order is:
+// [TPE_x, TPE_y, norm_tpeRadius, sin(tpeAngle), cos(tpeAngle), norm_posX,
+//  norm_posY, norm_offset, angle / 2pi, type]
+template <typename T>
+void computeFeatureVector(const TreeNode<T>& node,
+                          const FeatureBounds<T>& bounds,
+                          std::vector<T>& featureVector);
+
+// Same as above, with the TPE of the node read from entry idx of embedding.
+template <typename T>
+void computeFeatureVector(const TreeNode<T>& node,
+                          const TreeEmbedding<T>& embedding, size_t idx,
+                          const FeatureBounds<T>& bounds,
+                          std::vector<T>& featureVector);
+
+// Normalizes feature vectors of a sequence of trees with bounds that are
+// carried over from frame to frame instead of being recomputed per tree.
+//
+// A tree is normalized with the bounds accumulated from the previous trees, so
+// its feature vectors are produced in a single pass over its nodes, while the
+// bounds of the tree are collected for the following trees. Only the very
+// first tree is scanned upfront to seed the bounds. Attributes exceeding the
+// bounds seen so far are normalized slightly outside of [0, 1].
+//
+// Stable bounds make feature vectors of unchanged nodes identical across
+// frames, which is what allows to reuse them.
+template <typename T>
+class FeatureNormalizer {
+ public:
+  // windowSize: number of most recent trees whose bounds are combined, 0 keeps
+  // running bounds over all trees since the last reset.
+  explicit FeatureNormalizer(size_t windowSize = 0);
+
+  void reset();
+
+  // While frozen the bounds are not updated anymore, all trees are normalized
+  // with the same bounds, e.g. for the duration of a sequence.
+  void freeze() { frozen_ = true; }
+  void unfreeze() { frozen_ = false; }
+  bool isFrozen() const { return frozen_; }
+
+  const FeatureBounds<T>& bounds() const { return bounds_; }
+
+  // Generate feature vectors of tree, features is resized to the number of
+  // nodes and its rows keep their capacity.
+  void generateFeatureVectors(const TreeWrapper<T>& tree,
+                              std::vector<std::vector<T>>& features);
+  // Same as above, with the TPE of the tree kept in embedding.
+  void generateFeatureVectors(const TreeWrapper<T>& tree,
+                              const TreeEmbedding<T>& embedding,
+                              std::vector<std::vector<T>>& features);
+
+  // Generate feature vectors of treeA and treeB to match them with each
+  // other. Both trees are normalized with the same bounds, those from before
+  // the call, and the bounds of each tree are added once afterwards. treeA is
+  // not added again if its bounds are those added last, so in a sequence,
+  // where treeA is the treeB of the previous call, every tree counts once.
+  void generateFeatureVectors(const TreeWrapper<T>& treeA,
+                              const TreeWrapper<T>& treeB,
+                              std::vector<std::vector<T>>& featuresA,
+                              std::vector<std::vector<T>>& featuresB);
+
+ private:
+  // embedding: TPE of tree, nullptr if it is stored in the nodes.
+  void generateFeatureVectors(const TreeWrapper<T>& tree,
+                              const TreeEmbedding<T>* embedding,
+                              std::vector<std::vector<T>>& features);
+
+  void addTreeBounds(const FeatureBounds<T>& treeBounds);
+
+  size_t windowSize_ = 0;
+  bool frozen_ = false;
+  // Combined bounds used for normalization.
+  FeatureBounds<T> bounds_;
+  // Bounds of the tree added last.
+  FeatureBounds<T> lastTreeBounds_;
+  // Bounds of the trees in the window, only used if windowSize_ > 0.
+  std::deque<FeatureBounds<T>> window_;
+};
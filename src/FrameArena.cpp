@@ -0,0 +1,53 @@
+#include "FrameArena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+FrameArena::FrameArena(size_t blockSize)
+    : blockSize_(std::max<size_t>(blockSize, 64)) {}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment) {
+  if (bytes == 0) bytes = 1;
+  while (current_.blockIdx < blocks_.size()) {
+    Block& block = blocks_[current_.blockIdx];
+    // Align the address, not only the offset, since new[] only guarantees
+    // the fundamental alignment.
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+    uintptr_t address = base + current_.offset;
+    address = (address + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    size_t offset = address - base;
+    if (offset + bytes <= block.size) {
+      current_.offset = offset + bytes;
+      return block.data.get() + offset;
+    }
+    // Move on to the next block, the rest of this one stays unused until the
+    // next reset.
+    current_.blockIdx++;
+    current_.offset = 0;
+  }
+
+  // All blocks are exhausted, add one that is at least twice as large as
+  // the previous one and fits the request.
+  size_t size = blocks_.empty() ? blockSize_ : 2 * blocks_.back().size;
+  size = std::max(size, bytes + alignment);
+  blocks_.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+  current_.blockIdx = blocks_.size() - 1;
+  current_.offset = 0;
+  return allocate(bytes, alignment);
+}
+
+size_t FrameArena::capacity() const {
+  size_t total = 0;
+  for (const Block& block : blocks_) {
+    total += block.size;
+  }
+  return total;
+}
+
+size_t FrameArena::bytesUsed() const {
+  size_t total = current_.offset;
+  for (size_t i = 0; i < current_.blockIdx && i < blocks_.size(); ++i) {
+    total += blocks_[i].size;
+  }
+  return total;
+}
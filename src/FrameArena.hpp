@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define TREE_MATCHING_HAS_PMR 1
+#endif
+#endif
+
+// Monotonic arena for the short-lived scratch data of one frame, e.g. solver
+// work arrays and BFS queues. Allocation bumps an offset inside the current
+// block, deallocation is a no-op, and reset() releases everything at once in
+// O(1) while keeping the blocks for the next frame, so a warmed up arena does
+// not call malloc at all.
+//
+// A FrameArena is not thread safe, use one per thread.
+class FrameArena {
+ public:
+  // Position in the arena that allocations can be rolled back to.
+  struct Marker {
+    size_t blockIdx = 0;
+    size_t offset = 0;
+  };
+
+  // blockSize: size of the first block in bytes, later blocks double.
+  explicit FrameArena(size_t blockSize = 64 * 1024);
+
+  FrameArena(const FrameArena&) = delete;
+  FrameArena& operator=(const FrameArena&) = delete;
+
+  void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+  // Release all allocations, the memory is reused by later allocations.
+  void reset() { current_ = Marker(); }
+
+  Marker mark() const { return current_; }
+  // Release the allocations made after marker was taken.
+  void rewind(const Marker& marker) { current_ = marker; }
+
+  // Bytes of all blocks owned by the arena.
+  size_t capacity() const;
+  // Bytes allocated since the last reset, including alignment padding.
+  size_t bytesUsed() const;
+
+ private:
+  struct Block {
+    std::unique_ptr<char[]> data;
+    size_t size;
+  };
+
+  std::vector<Block> blocks_;
+  Marker current_;
+  size_t blockSize_;
+};
+
+// Rewinds the arena to its state at construction when leaving the scope.
+class FrameArenaScope {
+ public:
+  explicit FrameArenaScope(FrameArena& arena)
+      : arena_(arena), marker_(arena.mark()) {}
+  ~FrameArenaScope() { arena_.rewind(marker_); }
+
+  FrameArenaScope(const FrameArenaScope&) = delete;
+  FrameArenaScope& operator=(const FrameArenaScope&) = delete;
+
+ private:
+  FrameArena& arena_;
+  FrameArena::Marker marker_;
+};
+
+// Standard allocator drawing from a FrameArena, so that standard containers
+// can live in the arena. Containers must not outlive the next reset() or
+// rewind() of their arena.
+template <typename U>
+class ArenaAllocator {
+ public:
+  using value_type = U;
+
+  explicit ArenaAllocator(FrameArena& arena) : arena_(&arena) {}
+  template <typename V>
+  ArenaAllocator(const ArenaAllocator<V>& other) : arena_(other.arena()) {}
+
+  U* allocate(size_t n) {
+    return static_cast<U*>(arena_->allocate(n * sizeof(U), alignof(U)));
+  }
+  void deallocate(U*, size_t) {}
+
+  FrameArena* arena() const { return arena_; }
+
+ private:
+  FrameArena* arena_;
+};
+
+template <typename U, typename V>
+bool operator==(const ArenaAllocator<U>& a, const ArenaAllocator<V>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename U, typename V>
+bool operator!=(const ArenaAllocator<U>& a, const ArenaAllocator<V>& b) {
+  return !(a == b);
+}
+
+template <typename U>
+using ArenaVector = std::vector<U, ArenaAllocator<U>>;
+
+#ifdef TREE_MATCHING_HAS_PMR
+// Polymorphic memory resource view of a FrameArena for C++17 code, e.g.
+// std::pmr::vector<float> row(&resource).
+class FrameArenaResource : public std::pmr::memory_resource {
+ public:
+  explicit FrameArenaResource(FrameArena& arena) : arena_(arena) {}
+
+ private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    return arena_.allocate(bytes, alignment);
+  }
+  void do_deallocate(void*, size_t, size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource& other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  FrameArena& arena_;
+};
+#endif
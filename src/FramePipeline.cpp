@@ -0,0 +1,298 @@
+#include "FramePipeline.hpp"
+
+#include <chrono>
+#include <utility>
+
+#include "HungarianAlgorithm.hpp"
+#include "LockFreeQueue.hpp"
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Wait a little before retrying a queue operation: spin first to keep the
+// latency of a hand-off low, then yield and finally sleep to not burn a core
+// while a stage is idle.
+static void waitBackoff(int& attempt) {
+  if (attempt < 64) {
+    // Spin.
+  } else if (attempt < 256) {
+    std::this_thread::yield();
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+  }
+  attempt++;
+}
+
+// Bounded queue of frame slots connecting two stages, blocking on top of a
+// lock-free ring buffer.
+template <typename T>
+class FramePipeline<T>::FrameQueue {
+ public:
+  FrameQueue(size_t capacity, bool singleProducerConsumer) {
+    if (singleProducerConsumer) {
+      spsc_.reset(new SpscQueue<MatchingFrame<T>*>(capacity));
+    } else {
+      mpmc_.reset(new MpmcQueue<MatchingFrame<T>*>(capacity));
+    }
+  }
+
+  bool tryPush(MatchingFrame<T>* frame) {
+    return spsc_ ? spsc_->tryPush(frame) : mpmc_->tryPush(frame);
+  }
+
+  bool tryPop(MatchingFrame<T>*& frame) {
+    return spsc_ ? spsc_->tryPop(frame) : mpmc_->tryPop(frame);
+  }
+
+  // Blocks while the queue is full. Returns false if the queue was closed.
+  bool push(MatchingFrame<T>* frame) {
+    int attempt = 0;
+    while (!tryPush(frame)) {
+      if (closed_.load(std::memory_order_acquire)) return false;
+      waitBackoff(attempt);
+    }
+    return true;
+  }
+
+  // Blocks while the queue is empty. Returns false once the queue is closed
+  // and drained.
+  bool pop(MatchingFrame<T>*& frame) {
+    int attempt = 0;
+    while (!tryPop(frame)) {
+      // Producers close the queue after their last push, so a queue found
+      // empty after it was closed stays empty.
+      if (closed_.load(std::memory_order_acquire)) return tryPop(frame);
+      waitBackoff(attempt);
+    }
+    return true;
+  }
+
+  void close() { closed_.store(true, std::memory_order_release); }
+
+ private:
+  std::unique_ptr<SpscQueue<MatchingFrame<T>*>> spsc_;
+  std::unique_ptr<MpmcQueue<MatchingFrame<T>*>> mpmc_;
+  std::atomic<bool> closed_{false};
+};
+
+template <typename T>
+FramePipeline<T>::FramePipeline(size_t queueCapacity)
+    : queueCapacity_(queueCapacity < 1 ? 1 : queueCapacity) {}
+
+template <typename T>
+FramePipeline<T>::~FramePipeline() {
+  finish();
+  // Unblock workers waiting on full queues, the remaining frames are dropped.
+  for (auto& queue : queues_) {
+    queue->close();
+  }
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+template <typename T>
+void FramePipeline<T>::addStage(const std::string& name,
+                                StageFunction function, int numWorkers) {
+  if (started_) return;
+  std::unique_ptr<Stage> stage(new Stage());
+  stage->function = std::move(function);
+  stage->numWorkers = numWorkers < 1 ? 1 : numWorkers;
+  stage->stats.name = name;
+  stages_.push_back(std::move(stage));
+}
+
+template <typename T>
+void FramePipeline<T>::start() {
+  if (started_) return;
+  started_ = true;
+
+  // Queue i links stage i - 1 (or the pushing thread) to stage i (or the
+  // popping thread).
+  size_t numWorkers = 0;
+  for (size_t i = 0; i <= stages_.size(); ++i) {
+    int producers = i == 0 ? 1 : stages_[i - 1]->numWorkers;
+    int consumers = i == stages_.size() ? 1 : stages_[i]->numWorkers;
+    queues_.emplace_back(
+        new FrameQueue(queueCapacity_, producers == 1 && consumers == 1));
+    if (i < stages_.size()) numWorkers += stages_[i]->numWorkers;
+  }
+
+  // Enough slots to fill every queue, every worker and both ends.
+  size_t numSlots =
+      queues_.size() * roundUpToPowerOfTwo(queueCapacity_) + numWorkers + 2;
+  freeSlots_.reset(new FrameQueue(numSlots, false));
+  for (size_t i = 0; i < numSlots; ++i) {
+    slots_.emplace_back(new MatchingFrame<T>());
+    freeSlots_->tryPush(slots_.back().get());
+  }
+  reorderBuffer_.assign(numSlots, nullptr);
+
+  for (size_t s = 0; s < stages_.size(); ++s) {
+    stages_[s]->activeWorkers = stages_[s]->numWorkers;
+    for (int w = 0; w < stages_[s]->numWorkers; ++w) {
+      workers_.emplace_back(&FramePipeline<T>::runWorker, this, s);
+    }
+  }
+}
+
+template <typename T>
+void FramePipeline<T>::runWorker(size_t stageIdx) {
+  Stage& stage = *stages_[stageIdx];
+  FrameQueue& input = *queues_[stageIdx];
+  FrameQueue& output = *queues_[stageIdx + 1];
+
+  MatchingFrame<T>* frame;
+  while (input.pop(frame)) {
+    auto start = std::chrono::steady_clock::now();
+    stage.function(*frame);
+    auto processed = std::chrono::steady_clock::now();
+    bool pushed = output.push(frame);
+    auto end = std::chrono::steady_clock::now();
+
+    double latency =
+        std::chrono::duration<double, std::micro>(processed - start).count();
+    double blocked =
+        std::chrono::duration<double, std::micro>(end - processed).count();
+    {
+      std::lock_guard<std::mutex> lock(stage.statsMutex);
+      StageStats& stats = stage.stats;
+      stats.totalBlocked += blocked;
+      stats.histogram.record(latency);
+    }
+    if (!pushed) break;
+  }
+
+  // The last worker of the stage propagates the end of the input.
+  if (--stage.activeWorkers == 0) output.close();
+}
+
+template <typename T>
+MatchingFrame<T>* FramePipeline<T>::acquireFrame() {
+  if (!started_ || finished_) return nullptr;
+  MatchingFrame<T>* frame;
+  int attempt = 0;
+  while (!freeSlots_->tryPop(frame)) {
+    waitBackoff(attempt);
+  }
+  return frame;
+}
+
+template <typename T>
+void FramePipeline<T>::push(MatchingFrame<T>* frame) {
+  if (!started_ || finished_ || frame == nullptr) return;
+  frame->sequence = nextPushSequence_++;
+  queues_.front()->push(frame);
+}
+
+template <typename T>
+void FramePipeline<T>::push(MatchingFrame<T>&& frame) {
+  MatchingFrame<T>* slot = acquireFrame();
+  if (slot == nullptr) return;
+  // Swap instead of move to hand the buffers of the slot to the caller.
+  std::swap(*slot, frame);
+  push(slot);
+}
+
+template <typename T>
+void FramePipeline<T>::finish() {
+  if (!started_ || finished_) return;
+  finished_ = true;
+  queues_.front()->close();
+}
+
+template <typename T>
+MatchingFrame<T>* FramePipeline<T>::popFrame() {
+  if (!started_) return nullptr;
+
+  while (true) {
+    MatchingFrame<T>*& waiting =
+        reorderBuffer_[nextPopSequence_ % reorderBuffer_.size()];
+    if (waiting != nullptr) {
+      MatchingFrame<T>* frame = waiting;
+      waiting = nullptr;
+      nextPopSequence_++;
+      return frame;
+    }
+
+    MatchingFrame<T>* next;
+    if (!queues_.back()->pop(next)) return nullptr;
+    if (next->sequence == nextPopSequence_) {
+      nextPopSequence_++;
+      return next;
+    }
+    // At most one slot per sequence is in flight, so the index is unique.
+    reorderBuffer_[next->sequence % reorderBuffer_.size()] = next;
+  }
+}
+
+template <typename T>
+void FramePipeline<T>::releaseFrame(MatchingFrame<T>* frame) {
+  if (frame != nullptr) freeSlots_->tryPush(frame);
+}
+
+template <typename T>
+bool FramePipeline<T>::pop(MatchingFrame<T>& frame) {
+  MatchingFrame<T>* slot = popFrame();
+  if (slot == nullptr) return false;
+  std::swap(frame, *slot);
+  releaseFrame(slot);
+  return true;
+}
+
+template <typename T>
+std::vector<StageStats> FramePipeline<T>::stats() const {
+  std::vector<StageStats> result;
+  for (const auto& stage : stages_) {
+    std::lock_guard<std::mutex> lock(stage->statsMutex);
+    result.push_back(stage->stats);
+  }
+  return result;
+}
+
+template <typename T>
+void addMatchingStages(FramePipeline<T>& pipeline,
+                       const std::string& similarityType, bool rotate) {
+  pipeline.addStage("sort", [rotate](MatchingFrame<T>& frame) {
+    // Convert point from vehicle coordinate system(x->forward, y->left) to
+    // nomal coordinate system(x->right, y->forward).
+    if (rotate) {
+      clockwiseRotate90Degrees(frame.treeA);
+      clockwiseRotate90Degrees(frame.treeB);
+    }
+    // Scratch memory of each worker, reused for all its frames.
+    static thread_local FrameArena arena;
+    sortTree(frame.treeA, frame.sortedTreeA, frame.sortedTreeAIndices, arena);
+    sortTree(frame.treeB, frame.sortedTreeB, frame.sortedTreeBIndices, arena);
+  });
+
+  pipeline.addStage("embed", [](MatchingFrame<T>& frame) {
+    generateTreePreservingEmbedding(frame.sortedTreeA);
+    generateTreePreservingEmbedding(frame.sortedTreeB);
+    frame.featureVectorsA = generateFeatureVectors(frame.sortedTreeA);
+    frame.featureVectorsB = generateFeatureVectors(frame.sortedTreeB);
+  });
+
+  pipeline.addStage("similarity", [similarityType](MatchingFrame<T>& frame) {
+    frame.costMatrix =
+        convertSimilarityMatrix2CostMatrix(createSimilarityMatrix(
+            frame.featureVectorsA, frame.featureVectorsB, similarityType));
+  });
+
+  pipeline.addStage("solve", [](MatchingFrame<T>& frame) {
+    static thread_local FrameArena arena;
+    // Same solver as matchFeatureVectors.
+    std::pair<T, std::vector<int>> maxMatching =
+        hungarianAlgorithmFastPath(frame.costMatrix, arena);
+    frame.matchingCost = maxMatching.first;
+    frame.matching = std::move(maxMatching.second);
+  });
+}
+
+// Explicit instantiations for type to use.
+template struct MatchingFrame<float>;
+
+template class FramePipeline<float>;
+
+template void addMatchingStages<float>(FramePipeline<float>& pipeline,
+                                       const std::string& similarityType,
+                                       bool rotate);
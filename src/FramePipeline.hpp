@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "LatencyHistogram.hpp"
+#include "TreeNode.hpp"
+
+// Data of one frame flowing through the matching pipeline. Each stage reads
+// the fields filled by the previous stages and fills its own.
+template <typename T>
+struct MatchingFrame {
+  // Position of the frame in the input, assigned by FramePipeline::push.
+  uint64_t sequence = 0;
+
+  // Input trees.
+  TreeWrapper<T> treeA;
+  TreeWrapper<T> treeB;
+
+  // Sorted trees with TPE and the mapping to the input node indices.
+  TreeWrapper<T> sortedTreeA;
+  TreeWrapper<T> sortedTreeB;
+  std::vector<int> sortedTreeAIndices;
+  std::vector<int> sortedTreeBIndices;
+
+  std::vector<std::vector<T>> featureVectorsA;
+  std::vector<std::vector<T>> featureVectorsB;
+  std::vector<std::vector<T>> costMatrix;
+
+  // Matching from nodes of sortedTreeA to nodes of sortedTreeB.
+  std::vector<int> matching;
+  T matchingCost = 0.0;
+};
+
+// Latency statistics of a pipeline stage, in microseconds.
+struct StageStats {
+  std::string name;
+  // Time spent waiting for room in the downstream queue (backpressure).
+  double totalBlocked = 0.0;
+  // Distribution of the time spent in the stage function, its count is the
+  // number of frames.
+  LatencyHistogram histogram;
+};
+
+// Streaming pipeline of frame processing stages. Every stage runs on its own
+// worker threads and is connected to the next one by a bounded queue, so that
+// e.g. the preprocessing of frame t + 1 overlaps the solve of frame t. A full
+// queue blocks the upstream stage, which bounds the number of frames in
+// flight. Frames are popped in the order they were pushed, even if a stage
+// has several workers.
+//
+// Frames live in slots preallocated by start(). Stages hand slot pointers to
+// each other through lock-free ring buffers, SPSC if both sides of a link run
+// on a single thread and MPMC otherwise, so neither a lock nor a copy of the
+// trees is involved. A slot keeps the buffers of its previous frame, which
+// avoids allocations once the pipeline is warmed up.
+//
+// Usage: addStage() ... start(), then push() frames from one thread while
+// pop() runs on another one, and finish() after the last frame. push() and
+// pop() swap the frame contents with a slot, alternatively acquireFrame(),
+// push(slot), popFrame() and releaseFrame() work on the slots directly.
+template <typename T>
+class FramePipeline {
+ public:
+  using StageFunction = std::function<void(MatchingFrame<T>&)>;
+
+  explicit FramePipeline(size_t queueCapacity = 4);
+  // Finishes the input and joins the workers, unpopped frames are dropped.
+  ~FramePipeline();
+
+  FramePipeline(const FramePipeline&) = delete;
+  FramePipeline& operator=(const FramePipeline&) = delete;
+
+  void addStage(const std::string& name, StageFunction function,
+                int numWorkers = 1);
+  void start();
+
+  // Push a frame to the first stage, blocks while the first queue is full.
+  // The buffers of the slot are swapped into frame, so they are only reused
+  // if frame is reused as well. A producer building a new frame per call
+  // should fill a slot from acquireFrame() instead.
+  void push(MatchingFrame<T>&& frame);
+  // Signal the end of the input.
+  void finish();
+  // Pop the next processed frame in input order, blocks until it is
+  // available. Returns false once all frames have been popped after finish.
+  bool pop(MatchingFrame<T>& frame);
+
+  // Get a free slot to fill in place, blocks while all slots are in use.
+  MatchingFrame<T>* acquireFrame();
+  // Push a slot returned by acquireFrame to the first stage.
+  void push(MatchingFrame<T>* frame);
+  // Pop the next processed slot in input order, nullptr once all frames have
+  // been popped after finish. The slot must be given back by releaseFrame.
+  MatchingFrame<T>* popFrame();
+  void releaseFrame(MatchingFrame<T>* frame);
+
+  std::vector<StageStats> stats() const;
+
+ private:
+  class FrameQueue;
+
+  struct Stage {
+    StageFunction function;
+    int numWorkers = 1;
+    std::atomic<int> activeWorkers{0};
+    mutable std::mutex statsMutex;
+    StageStats stats;
+  };
+
+  void runWorker(size_t stageIdx);
+
+  size_t queueCapacity_;
+  std::vector<std::unique_ptr<Stage>> stages_;
+  // queues_[i] is the input of stage i, the last queue holds the output.
+  std::vector<std::unique_ptr<FrameQueue>> queues_;
+  std::vector<std::thread> workers_;
+  bool started_ = false;
+  bool finished_ = false;
+  uint64_t nextPushSequence_ = 0;
+  uint64_t nextPopSequence_ = 0;
+  // Preallocated frames and the queue of the free ones.
+  std::vector<std::unique_ptr<MatchingFrame<T>>> slots_;
+  std::unique_ptr<FrameQueue> freeSlots_;
+  // Frames that left the last stage ahead of their predecessors, indexed by
+  // sequence modulo the number of slots.
+  std::vector<MatchingFrame<T>*> reorderBuffer_;
+};
+
+// Add the stages of matchTrees to pipeline:
+// "sort": optionally rotate and sort both trees,
+// "embed": TPE and feature vectors of both sorted trees,
+// "similarity": cost matrix, "solve": Hungarian algorithm.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+void addMatchingStages(FramePipeline<T>& pipeline,
+                       const std::string& similarityType = "cosine",
+                       bool rotate = false);
@@ -0,0 +1,204 @@
+#include "HierarchicalTreeMatching.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#include "HungarianAlgorithm.hpp"
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+namespace {
+
+// Preorder layout of a tree: the subtree of node i consists of the nodes
+// order[first[i]] ... order[first[i] + size[i] - 1]. Nodes not reachable from
+// the root have size 0.
+struct SubtreeLayout {
+  std::vector<int> order;
+  std::vector<int> first;
+  std::vector<int> size;
+};
+
+}  // namespace
+
+template <typename T>
+static SubtreeLayout computeSubtreeLayout(const TreeWrapper<T>& tree) {
+  SubtreeLayout layout;
+  int numNodes = tree.nodes.size();
+  layout.first.assign(numNodes, -1);
+  layout.size.assign(numNodes, 0);
+  if (numNodes == 0) return layout;
+
+  layout.order.reserve(numNodes);
+  std::vector<int> stack(1, 0);
+  while (!stack.empty()) {
+    int idx = stack.back();
+    stack.pop_back();
+    layout.first[idx] = layout.order.size();
+    layout.order.push_back(idx);
+    const std::vector<int>& children = tree.nodes[idx].children;
+    // Push in reverse to visit the children in their order.
+    for (auto it = children.rbegin(); it != children.rend(); ++it) {
+      stack.push_back(*it);
+    }
+  }
+
+  // In reverse preorder every node comes after its descendants.
+  for (auto it = layout.order.rbegin(); it != layout.order.rend(); ++it) {
+    int size = 1;
+    for (int child : tree.nodes[*it].children) size += layout.size[child];
+    layout.size[*it] = size;
+  }
+  return layout;
+}
+
+// Mean feature vector of the nodes of every subtree.
+template <typename T>
+static std::vector<std::vector<T>> computeSubtreeMeanFeatures(
+    const TreeWrapper<T>& tree, const SubtreeLayout& layout,
+    const std::vector<std::vector<T>>& features) {
+  std::vector<std::vector<T>> sums(tree.nodes.size(),
+                                   std::vector<T>(kFeatureDimension, 0));
+  for (auto it = layout.order.rbegin(); it != layout.order.rend(); ++it) {
+    std::vector<T>& sum = sums[*it];
+    for (int k = 0; k < kFeatureDimension; ++k) sum[k] += features[*it][k];
+    for (int child : tree.nodes[*it].children) {
+      for (int k = 0; k < kFeatureDimension; ++k) sum[k] += sums[child][k];
+    }
+  }
+  for (int idx : layout.order) {
+    for (T& value : sums[idx]) value /= layout.size[idx];
+  }
+  return sums;
+}
+
+// Minimum cost assignment between the feature vectors of nodesA and nodesB,
+// result[i] is the index into nodesB matched to nodesA[i] or -1.
+template <typename T>
+static std::vector<int> solveNodeAssignment(
+    const std::vector<int>& nodesA, const std::vector<int>& nodesB,
+    const std::vector<std::vector<T>>& featuresA,
+    const std::vector<std::vector<T>>& featuresB,
+    const std::string& similarityType) {
+  std::vector<std::vector<T>> subFeaturesA, subFeaturesB;
+  subFeaturesA.reserve(nodesA.size());
+  for (int idx : nodesA) subFeaturesA.push_back(featuresA[idx]);
+  subFeaturesB.reserve(nodesB.size());
+  for (int idx : nodesB) subFeaturesB.push_back(featuresB[idx]);
+
+  std::vector<std::vector<T>> costMatrix = convertSimilarityMatrix2CostMatrix(
+      createSimilarityMatrix(subFeaturesA, subFeaturesB, similarityType));
+  return hungarianAlgorithm(costMatrix).second;
+}
+
+// Nodes of the subtree of root in ascending index order.
+static std::vector<int> collectSubtreeNodes(const SubtreeLayout& layout,
+                                            int root) {
+  std::vector<int> nodes(layout.order.begin() + layout.first[root],
+                         layout.order.begin() + layout.first[root] +
+                             layout.size[root]);
+  std::sort(nodes.begin(), nodes.end());
+  return nodes;
+}
+
+template <typename T>
+std::vector<int> matchTreesHierarchical(const TreeWrapper<T>& treeA,
+                                        const TreeWrapper<T>& treeB,
+                                        const std::string& similarityType,
+                                        size_t maxSubproblemSize,
+                                        ThreadPool& pool) {
+  if (similarityType != "cosine" && similarityType != "euclidean") {
+    std::cout << "unknown similarityType " << similarityType << std::endl;
+    exit(1);
+  }
+  std::vector<int> matching(treeA.nodes.size(), -1);
+  if (treeA.nodes.empty() || treeB.nodes.empty()) return matching;
+
+  // Feature vectors as matchTrees computes them.
+  TreeEmbedding<T> embeddingA, embeddingB;
+  std::vector<std::vector<T>> featuresA, featuresB;
+  generatePairFeatures(treeA, treeB, embeddingA, embeddingB, featuresA,
+                       featuresB);
+
+  SubtreeLayout layoutA = computeSubtreeLayout(treeA);
+  SubtreeLayout layoutB = computeSubtreeLayout(treeB);
+  std::vector<std::vector<T>> meanFeaturesA =
+      computeSubtreeMeanFeatures(treeA, layoutA, featuresA);
+  std::vector<std::vector<T>> meanFeaturesB =
+      computeSubtreeMeanFeatures(treeB, layoutB, featuresB);
+
+  // char instead of bool, the subproblems write it concurrently.
+  std::vector<char> matchedB(treeB.nodes.size(), 0);
+
+  // Decompose paired subtrees until they are small enough.
+  std::vector<std::pair<int, int>> subproblems;
+  std::vector<std::pair<int, int>> pending(1, std::make_pair(0, 0));
+  while (!pending.empty()) {
+    int rootA = pending.back().first;
+    int rootB = pending.back().second;
+    pending.pop_back();
+
+    size_t sizeA = layoutA.size[rootA];
+    size_t sizeB = layoutB.size[rootB];
+    if (std::max(sizeA, sizeB) <= maxSubproblemSize) {
+      subproblems.push_back(std::make_pair(rootA, rootB));
+      continue;
+    }
+
+    // Pair the roots and match their children subtrees.
+    matching[rootA] = rootB;
+    matchedB[rootB] = 1;
+    const std::vector<int>& childrenA = treeA.nodes[rootA].children;
+    const std::vector<int>& childrenB = treeB.nodes[rootB].children;
+    if (childrenA.empty() || childrenB.empty()) continue;
+
+    std::vector<int> childMatching = solveNodeAssignment(
+        childrenA, childrenB, meanFeaturesA, meanFeaturesB, similarityType);
+    for (size_t i = 0; i < childrenA.size(); ++i) {
+      if (childMatching[i] < 0) continue;
+      pending.push_back(
+          std::make_pair(childrenA[i], childrenB[childMatching[i]]));
+    }
+  }
+
+  // Solve the subtree pairs in parallel, they cover disjoint nodes.
+  pool.parallelFor(0, subproblems.size(), [&](size_t s) {
+    std::vector<int> nodesA =
+        collectSubtreeNodes(layoutA, subproblems[s].first);
+    std::vector<int> nodesB =
+        collectSubtreeNodes(layoutB, subproblems[s].second);
+    std::vector<int> subMatching = solveNodeAssignment(
+        nodesA, nodesB, featuresA, featuresB, similarityType);
+    for (size_t i = 0; i < nodesA.size(); ++i) {
+      if (subMatching[i] < 0) continue;
+      matching[nodesA[i]] = nodesB[subMatching[i]];
+      matchedB[nodesB[subMatching[i]]] = 1;
+    }
+  });
+
+  // Global solve of the nodes without a counterpart in their subtree pair.
+  std::vector<int> leftoverA, leftoverB;
+  for (size_t i = 0; i < matching.size(); ++i) {
+    if (matching[i] < 0) leftoverA.push_back(i);
+  }
+  for (size_t j = 0; j < matchedB.size(); ++j) {
+    if (!matchedB[j]) leftoverB.push_back(j);
+  }
+  if (leftoverA.empty() || leftoverB.empty()) return matching;
+
+  std::vector<int> leftoverMatching = solveNodeAssignment(
+      leftoverA, leftoverB, featuresA, featuresB, similarityType);
+  for (size_t i = 0; i < leftoverA.size(); ++i) {
+    if (leftoverMatching[i] >= 0) {
+      matching[leftoverA[i]] = leftoverB[leftoverMatching[i]];
+    }
+  }
+  return matching;
+}
+
+// Explicit instantiations for type to use.
+template std::vector<int> matchTreesHierarchical<float>(
+    const TreeWrapper<float>& treeA, const TreeWrapper<float>& treeB,
+    const std::string& similarityType, size_t maxSubproblemSize,
+    ThreadPool& pool);
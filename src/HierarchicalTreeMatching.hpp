@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+#include "TreeNode.hpp"
+
+// Approximate matchTrees for very large trees by decomposing them into
+// subtrees. Starting with the roots, the children subtrees of two paired
+// nodes are matched by the mean feature vector of their nodes, and matched
+// subtree pairs are decomposed further until both have at most
+// maxSubproblemSize nodes. These subtree pairs are then solved as independent
+// assignment problems in parallel on pool. Nodes left unmatched, e.g. in
+// subtrees without a counterpart, are matched by one final global solve.
+//
+// The result has the format of matchTrees, with the same feature vectors and
+// similarity. If both trees have at most maxSubproblemSize nodes it is the
+// exact matchTrees result. The trees are not modified.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+std::vector<int> matchTreesHierarchical(
+    const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB,
+    const std::string& similarityType = "cosine",
+    size_t maxSubproblemSize = 128, ThreadPool& pool = defaultThreadPool());
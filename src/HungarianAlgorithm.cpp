@@ -7,32 +7,34 @@
  * Function: padCostMatrix
  * -----------------------
  * Converts a possibly rectangular cost matrix into a square matrix.
- * Cells outside the original matrix are filled with INF so that they
- * are not chosen in an optimal assignment.
+ * Cells outside the original matrix are filled with padValue. A padded row or
+ * column costs the same whichever cell it takes, so the optimal assignment of
+ * the original cells is not changed.
  *
  * Parameters:
  *  - costMatrix: The original cost matrix.
  *  - size: The target dimension for the square matrix.
- *  - INF: A large value used to discourage the selection of padded cells.
+ *  - padValue: The cost of the padded cells.
+ *  - arena: Arena the padded matrix is allocated from.
  *
  * Returns:
- *  A square matrix of dimensions size x size.
+ *  A square matrix of dimensions size x size, stored row by row in a single
+ *  array.
  */
 template <typename T>
-std::vector<std::vector<T>> padCostMatrix(
-    const std::vector<std::vector<T>>& costMatrix, int size, T INF) {
+ArenaVector<T> padCostMatrix(const std::vector<std::vector<T>>& costMatrix,
+                             int size, T padValue, FrameArena& arena) {
   int numRows = costMatrix.size();
   int numCols = (numRows > 0 ? costMatrix[0].size() : 0);
 
-  // Create a square matrix filled with INF.
-  std::vector<std::vector<T>> paddedCost(size, std::vector<T>(size, INF));
+  // Create a square matrix filled with padValue.
+  ArenaVector<T> paddedCost(size * size, padValue, ArenaAllocator<T>(arena));
 
   // Copy over the original values; indices beyond the original dimensions
-  // remain as INF.
-  for (int i = 0; i < size; i++) {
-    for (int j = 0; j < size; j++) {
-      if (i < numRows && j < numCols) paddedCost[i][j] = costMatrix[i][j];
-    }
+  // remain as padValue.
+  for (int i = 0; i < numRows; i++) {
+    std::copy(costMatrix[i].begin(), costMatrix[i].begin() + numCols,
+              paddedCost.begin() + i * size);
   }
   return paddedCost;
 }
@@ -53,14 +55,15 @@ std::vector<std::vector<T>> padCostMatrix(
  * Returns:
  *  A vector where each element is the assigned column (0-indexed) for that row.
  */
-std::vector<int> buildAssignment(const std::vector<int>& columnMatching,
+std::vector<int> buildAssignment(const ArenaVector<int>& columnMatching,
                                  int numRows, int numCols, int size) {
   std::vector<int> assignment(numRows, -1);
   // Iterate over the padded matching results (starting at index 1).
   for (int j = 1; j <= size; j++) {
     int matchedRow = columnMatching[j];
-    // Validate that the match is within the original dimensions.
-    if (matchedRow <= numRows && j <= numCols) {
+    // Validate that the column is matched and the match is within the
+    // original dimensions.
+    if (matchedRow > 0 && matchedRow <= numRows && j <= numCols) {
       // Convert from 1-indexed to 0-indexed.
       assignment[matchedRow - 1] = j - 1;
     }
@@ -78,13 +81,13 @@ std::vector<int> buildAssignment(const std::vector<int>& columnMatching,
  * The reduced cost for a given cell is computed as:
  *   cost[row][col] - rowDuals[row] - colDuals[col]
  *
- * While scanning, it records the predecessor of each column for path
+ * While scanning, it records the predecessor of each improved column for path
  * construction.
  *
  * Parameters:
  *  - currentColumn: The column from which to start the exploration.
  *  - size: The size of the square matrix.
- *  - cost: The padded cost matrix.
+ *  - cost: The padded cost matrix, stored row by row.
  *  - rowDuals: Dual variables for rows.
  *  - colDuals: Dual variables for columns.
  *  - minReducedCost: Array holding the current best reduced costs for each
@@ -102,13 +105,13 @@ std::vector<int> buildAssignment(const std::vector<int>& columnMatching,
  */
 template <typename T>
 std::pair<int, T> exploreColumns(int currentColumn, int size,
-                                 const std::vector<std::vector<T>>& cost,
-                                 const std::vector<T>& rowDuals,
-                                 const std::vector<T>& colDuals,
-                                 std::vector<T>& minReducedCost,
-                                 const std::vector<bool>& visitedColumns,
-                                 const std::vector<int>& columnMatching,
-                                 std::vector<int>& previousColumn, T INF) {
+                                 const ArenaVector<T>& cost,
+                                 const ArenaVector<T>& rowDuals,
+                                 const ArenaVector<T>& colDuals,
+                                 ArenaVector<T>& minReducedCost,
+                                 const ArenaVector<bool>& visitedColumns,
+                                 const ArenaVector<int>& columnMatching,
+                                 ArenaVector<int>& previousColumn, T INF) {
   // Retrieve the row currently matched with the current column.
   // columnMatching[currentColumn]: The row associated with currentColumn.
   int rowIdx = columnMatching[currentColumn];
@@ -119,16 +122,23 @@ std::pair<int, T> exploreColumns(int currentColumn, int size,
   // Minimal adjustment value.
   T delta = INF;
 
+  // Row rowIdx of the cost matrix, shifted by one so that it can be indexed
+  // by 1-based columns.
+  const T* costRow = cost.data() + (rowIdx - 1) * size - 1;
+
   // Explore all columns to update their minimal reduced costs, columns are
   // regarded with 1-based indexing.
   for (int j = 1; j <= size; j++) {
     if (!visitedColumns[j]) {
-      // cost[rowIdx - 1][j - 1]: 1-based indexing to 0-based indexing.
-      T reducedCost = cost[rowIdx - 1][j - 1] - rowDuals[rowIdx] - colDuals[j];
+      // costRow[j]: cost[rowIdx - 1][j - 1], 1-based to 0-based indexing.
+      T reducedCost = costRow[j] - rowDuals[rowIdx] - colDuals[j];
 
-      // For each unvisited column j, if a better reduced cost is found.
+      // For each unvisited column j, if a better reduced cost is found,
+      // record that column j is reached from currentColumn. This establishes
+      // a path for backtracking when reconstructing the augmenting path.
       if (reducedCost < minReducedCost[j]) {
         minReducedCost[j] = reducedCost;
+        previousColumn[j] = currentColumn;
       }
 
       // Update delta and candidate if this cell's cost is the best so far.
@@ -139,11 +149,6 @@ std::pair<int, T> exploreColumns(int currentColumn, int size,
     }
   }
 
-  // Record that column candidateColumn was reached from currentColumn during
-  // exploration.
-  // This establishes a path for backtracking when reconstructing the
-  // augmenting path.
-  previousColumn[candidateColumn] = currentColumn;
   return std::make_pair(candidateColumn, delta);
 }
 
@@ -169,11 +174,11 @@ std::pair<int, T> exploreColumns(int currentColumn, int size,
  *  - delta: The minimal adjustment value from the current exploration.
  */
 template <typename T>
-void updateDualVariables(int size, std::vector<T>& rowDuals,
-                         std::vector<T>& colDuals,
-                         std::vector<T>& minReducedCost,
-                         const std::vector<bool>& visitedColumns,
-                         const std::vector<int>& columnMatching, T delta) {
+void updateDualVariables(int size, ArenaVector<T>& rowDuals,
+                         ArenaVector<T>& colDuals,
+                         ArenaVector<T>& minReducedCost,
+                         const ArenaVector<bool>& visitedColumns,
+                         const ArenaVector<int>& columnMatching, T delta) {
   // Update dual variables for all columns, index 0 is a holder for path
   // construction.
   for (int j = 0; j <= size; j++) {
@@ -203,8 +208,8 @@ void updateDualVariables(int size, std::vector<T>& rowDuals,
  *  - columnMatching: The matching vector to update (modified in place).
  *  - previousColumn: The array containing the backtracking information.
  */
-void reconstructMatching(int currentColumn, std::vector<int>& columnMatching,
-                         const std::vector<int>& previousColumn) {
+void reconstructMatching(int currentColumn, ArenaVector<int>& columnMatching,
+                         const ArenaVector<int>& previousColumn) {
   // Backtrack until the dummy index (0) is reached.
   while (currentColumn != 0) {
     int temp = previousColumn[currentColumn];
@@ -224,28 +229,32 @@ void reconstructMatching(int currentColumn, std::vector<int>& columnMatching,
  * Parameters:
  *  - currentRow: The row for which the assignment is being improved.
  *  - size: Dimension of the padded square matrix.
- *  - cost: The padded cost matrix.
+ *  - cost: The padded cost matrix, stored row by row.
  *  - rowDuals: Row dual variables (updated in the process).
  *  - colDuals: Column dual variables (updated in the process).
  *  - columnMatching: The matching vector (1-indexed, updated in place).
  *  - previousColumn: Array used to store the path for reconstructing the
  * matching.
+ *  - minReducedCost: Scratch array of size + 1 entries, reinitialized here so
+ * that it is allocated once for all rows.
+ *  - visitedColumns: Scratch array of size + 1 entries, reinitialized here.
  *  - INF: A large value representing infinity.
  */
 template <typename T>
-void augmentRowAssignment(int currentRow, int size,
-                          const std::vector<std::vector<T>>& cost,
-                          std::vector<T>& rowDuals, std::vector<T>& colDuals,
-                          std::vector<int>& columnMatching,
-                          std::vector<int>& previousColumn, T INF) {
+void augmentRowAssignment(int currentRow, int size, const ArenaVector<T>& cost,
+                          ArenaVector<T>& rowDuals, ArenaVector<T>& colDuals,
+                          ArenaVector<int>& columnMatching,
+                          ArenaVector<int>& previousColumn,
+                          ArenaVector<T>& minReducedCost,
+                          ArenaVector<bool>& visitedColumns, T INF) {
   // Begin the augmenting path with currentRow assigned at the special index 0.
   columnMatching[0] = currentRow;
 
   // Initialize the minimal reduced cost for each column.
-  std::vector<T> minReducedCost(size + 1, INF);
+  std::fill(minReducedCost.begin(), minReducedCost.end(), INF);
 
   // Keep track of which columns are included in the current augmenting path.
-  std::vector<bool> visitedColumns(size + 1, false);
+  std::fill(visitedColumns.begin(), visitedColumns.end(), false);
 
   int currentColumn = 0;
   // Build the augmenting path until an unmatched(free) column is reached.
@@ -292,6 +301,8 @@ void augmentRowAssignment(int currentRow, int size,
  *
  * Parameters:
  *  - costMatrix: The original cost matrix for the assignment problem.
+ *  - arena: Arena for the padded matrix and the work arrays, rewound to its
+ * previous state before returning.
  *
  * Returns:
  *  A pair where:
@@ -301,10 +312,11 @@ void augmentRowAssignment(int currentRow, int size,
  */
 template <typename T>
 std::pair<T, std::vector<int>> hungarianAlgorithm(
-    const std::vector<std::vector<T>>& costMatrix) {
+    const std::vector<std::vector<T>>& costMatrix, FrameArena& arena) {
   int numRows = costMatrix.size();
   if (numRows == 0) return std::make_pair(T(0), std::vector<int>());
   int numCols = costMatrix[0].size();
+  FrameArenaScope scope(arena);
 
   // Determine the dimension for the square cost matrix.
   int size = std::max(numRows, numCols);
@@ -312,32 +324,39 @@ std::pair<T, std::vector<int>> hungarianAlgorithm(
   // overflow.
   const T INF = std::numeric_limits<T>::max() / 4;
 
-  // Pad the cost matrix to form a square matrix where dummy cells have INF
-  // cost.
-  std::vector<std::vector<T>> cost = padCostMatrix(costMatrix, size, INF);
+  // Pad the cost matrix to form a square matrix where dummy cells have zero
+  // cost. Padding with INF would drive the dual variables towards INF, where
+  // the real costs are lost to rounding.
+  ArenaVector<T> cost = padCostMatrix(costMatrix, size, T(0), arena);
 
   // size + 1: 1-based indexing, valid range is [1, size]. Extra slot at index
   // 0.
 
   // Row and column dual variables used to adjust the cost matrix during
   // optimization.
-  std::vector<T> rowDuals(size + 1, 0), colDuals(size + 1, 0);
+  ArenaAllocator<T> allocator(arena);
+  ArenaVector<T> rowDuals(size + 1, 0, allocator);
+  ArenaVector<T> colDuals(size + 1, 0, allocator);
 
   // Tracks the current matching of columns to rows.
-  std::vector<int> columnMatching(size + 1, 0);
+  ArenaVector<int> columnMatching(size + 1, 0, allocator);
 
   // Used to trace back the path while constructing an augmenting path.
   // previousColumn is used to store the column indices that form the augmenting
   // path during the search for an unmatched (free) column. It essentially acts
   // as a breadcrumb trail, allowing the algorithm to trace back the path once
   // an unmatched (free) column is found.
-  std::vector<int> previousColumn(size + 1, 0);
+  ArenaVector<int> previousColumn(size + 1, 0, allocator);
+
+  // Work arrays of the augmenting path search, shared by all rows.
+  ArenaVector<T> minReducedCost(size + 1, INF, allocator);
+  ArenaVector<bool> visitedColumns(size + 1, false, allocator);
 
   // For each row (considering padded dimension), attempt to improve the
   // matching.
   for (int i = 1; i <= size; i++) {
     augmentRowAssignment(i, size, cost, rowDuals, colDuals, columnMatching,
-                         previousColumn, INF);
+                         previousColumn, minReducedCost, visitedColumns, INF);
   }
 
   // Map the computed matching back to an assignment for the original matrix
@@ -350,27 +369,359 @@ std::pair<T, std::vector<int>> hungarianAlgorithm(
   return std::make_pair(optimalCost, assignment);
 }
 
+/*
+ * Function: augmentRowAssignmentWithUnmatched
+ * -------------------------------------------
+ * Same as augmentRowAssignment, but every row additionally has its own dummy
+ * column which only this row can take, at a cost of unmatchedCost. A row
+ * assigned to its dummy column is unmatched.
+ *
+ * The dummy columns are not stored. Since only its own row reaches a dummy
+ * column, its column dual stays zero and it can only end an augmenting path.
+ * So it is enough to keep the minimal reduced cost among the dummy columns of
+ * the rows reached so far, and the column through which that row was reached.
+ *
+ * Parameters:
+ *  - currentRow: The row for which the assignment is being improved.
+ *  - numCols: Number of real columns.
+ *  - cost: The cost matrix, stored row by row with numCols columns.
+ *  - unmatchedCost: The cost of leaving a row unmatched.
+ *  - Others: As for augmentRowAssignment.
+ */
+template <typename T>
+void augmentRowAssignmentWithUnmatched(
+    int currentRow, int numCols, const ArenaVector<T>& cost, T unmatchedCost,
+    ArenaVector<T>& rowDuals, ArenaVector<T>& colDuals,
+    ArenaVector<int>& columnMatching, ArenaVector<int>& previousColumn,
+    ArenaVector<T>& minReducedCost, ArenaVector<bool>& visitedColumns,
+    T INF) {
+  columnMatching[0] = currentRow;
+  std::fill(minReducedCost.begin(), minReducedCost.end(), INF);
+  std::fill(visitedColumns.begin(), visitedColumns.end(), false);
+
+  // Minimal reduced cost of the dummy columns, and the column through which
+  // the row of that dummy column was reached.
+  T dummyReducedCost = INF;
+  int dummyColumn = 0;
+
+  int currentColumn = 0;
+  while (true) {
+    visitedColumns[currentColumn] = true;
+
+    // The dummy column of the row reached through currentColumn.
+    T reducedCost = unmatchedCost - rowDuals[columnMatching[currentColumn]];
+    if (reducedCost < dummyReducedCost) {
+      dummyReducedCost = reducedCost;
+      dummyColumn = currentColumn;
+    }
+
+    std::pair<int, T> result = exploreColumns(
+        currentColumn, numCols, cost, rowDuals, colDuals, minReducedCost,
+        visitedColumns, columnMatching, previousColumn, INF);
+    int candidateColumn = result.first;
+    T delta = result.second;
+
+    // On a tie a real column is preferred over leaving a row unmatched.
+    bool unmatched = dummyReducedCost < delta;
+    if (unmatched) delta = dummyReducedCost;
+
+    updateDualVariables(numCols, rowDuals, colDuals, minReducedCost,
+                        visitedColumns, columnMatching, delta);
+    dummyReducedCost -= delta;
+
+    if (unmatched) {
+      // The row of dummyColumn leaves it for its dummy column, the rows on
+      // the path to it shift by one column.
+      reconstructMatching(dummyColumn, columnMatching, previousColumn);
+      return;
+    }
+    currentColumn = candidateColumn;
+    if (columnMatching[currentColumn] == 0) {
+      reconstructMatching(currentColumn, columnMatching, previousColumn);
+      return;
+    }
+  }
+}
+
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithmWithUnmatched(
+    const std::vector<std::vector<T>>& costMatrix, T unmatchedCost,
+    FrameArena& arena) {
+  int numRows = costMatrix.size();
+  if (numRows == 0) return std::make_pair(T(0), std::vector<int>());
+  int numCols = costMatrix[0].size();
+  FrameArenaScope scope(arena);
+  const T INF = std::numeric_limits<T>::max() / 4;
+
+  // No padding is needed, every row can always take its dummy column.
+  ArenaAllocator<T> allocator(arena);
+  ArenaVector<T> cost(allocator);
+  cost.reserve(numRows * numCols);
+  for (const std::vector<T>& row : costMatrix) {
+    cost.insert(cost.end(), row.begin(), row.begin() + numCols);
+  }
+
+  ArenaVector<T> rowDuals(numRows + 1, 0, allocator);
+  ArenaVector<T> colDuals(numCols + 1, 0, allocator);
+  ArenaVector<int> columnMatching(numCols + 1, 0, allocator);
+  ArenaVector<int> previousColumn(numCols + 1, 0, allocator);
+  ArenaVector<T> minReducedCost(numCols + 1, INF, allocator);
+  ArenaVector<bool> visitedColumns(numCols + 1, false, allocator);
+
+  for (int i = 1; i <= numRows; i++) {
+    augmentRowAssignmentWithUnmatched(i, numCols, cost, unmatchedCost,
+                                      rowDuals, colDuals, columnMatching,
+                                      previousColumn, minReducedCost,
+                                      visitedColumns, INF);
+  }
+
+  std::vector<int> assignment =
+      buildAssignment(columnMatching, numRows, numCols, numCols);
+  T totalCost = 0;
+  for (int i = 0; i < numRows; i++) {
+    totalCost += assignment[i] < 0 ? unmatchedCost
+                                   : costMatrix[i][assignment[i]];
+  }
+  return std::make_pair(totalCost, assignment);
+}
+
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithmWithUnmatched(
+    const std::vector<std::vector<T>>& costMatrix, T unmatchedCost) {
+  size_t numCells = costMatrix.empty()
+                        ? 0
+                        : costMatrix.size() * costMatrix[0].size();
+  size_t size = costMatrix.empty()
+                    ? 0
+                    : std::max(costMatrix.size(), costMatrix[0].size());
+  FrameArena arena((numCells + 8 * (size + 1)) * sizeof(T) + 256);
+  return hungarianAlgorithmWithUnmatched(costMatrix, unmatchedCost, arena);
+}
+
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithm(
+    const std::vector<std::vector<T>>& costMatrix) {
+  // Size the arena to hold the padded matrix and the work arrays at once.
+  size_t size = costMatrix.empty()
+                    ? 0
+                    : std::max(costMatrix.size(), costMatrix[0].size());
+  FrameArena arena((size * size + 8 * (size + 1)) * sizeof(T) + 256);
+  return hungarianAlgorithm(costMatrix, arena);
+}
+
+template <typename T>
+void augmentAssignment(const ArenaVector<T>& cost, int size,
+                       const std::vector<int>& rows, HungarianState<T>& state,
+                       FrameArena& arena) {
+  FrameArenaScope scope(arena);
+  const T INF = std::numeric_limits<T>::max() / 4;
+  if (state.columnMatching.empty()) {
+    state.rowDuals.assign(size + 1, 0);
+    state.colDuals.assign(size + 1, 0);
+    state.columnMatching.assign(size + 1, 0);
+  }
+
+  // The solver works on arena arrays, the state is copied in and out.
+  ArenaAllocator<T> allocator(arena);
+  ArenaVector<T> rowDuals(state.rowDuals.begin(), state.rowDuals.end(),
+                          allocator);
+  ArenaVector<T> colDuals(state.colDuals.begin(), state.colDuals.end(),
+                          allocator);
+  ArenaVector<int> columnMatching(state.columnMatching.begin(),
+                                  state.columnMatching.end(), allocator);
+  ArenaVector<int> previousColumn(size + 1, 0, allocator);
+  ArenaVector<T> minReducedCost(size + 1, INF, allocator);
+  ArenaVector<bool> visitedColumns(size + 1, false, allocator);
+
+  for (int row : rows) {
+    augmentRowAssignment(row, size, cost, rowDuals, colDuals, columnMatching,
+                         previousColumn, minReducedCost, visitedColumns, INF);
+  }
+
+  std::copy(rowDuals.begin(), rowDuals.end(), state.rowDuals.begin());
+  std::copy(colDuals.begin(), colDuals.end(), state.colDuals.begin());
+  std::copy(columnMatching.begin(), columnMatching.end(),
+            state.columnMatching.begin());
+}
+
+template <typename T>
+std::vector<int> matchTightPairs(const ArenaVector<T>& cost, int size,
+                                 HungarianState<T>& state, FrameArena& arena) {
+  state.colDuals.assign(size + 1, std::numeric_limits<T>::max());
+  state.columnMatching.assign(size + 1, 0);
+
+  // Column reduction against the row duals, remembering the row each column
+  // is tight with.
+  ArenaVector<int> tightRow(size + 1, 0, ArenaAllocator<int>(arena));
+  state.colDuals[0] = 0;
+  for (int i = 1; i <= size; i++) {
+    const T* costRow = &cost[(i - 1) * size] - 1;
+    T rowDual = state.rowDuals[i];
+    for (int j = 1; j <= size; j++) {
+      T reducedCost = costRow[j] - rowDual;
+      if (reducedCost < state.colDuals[j]) {
+        state.colDuals[j] = reducedCost;
+        tightRow[j] = i;
+      }
+    }
+  }
+
+  // Greedy matching on the tight pairs: every column with the row it is
+  // tightest with, then the rows left over with any free tight column.
+  ArenaVector<int> rowColumn(size + 1, 0, ArenaAllocator<int>(arena));
+  for (int j = 1; j <= size; j++) {
+    if (rowColumn[tightRow[j]] == 0) {
+      rowColumn[tightRow[j]] = j;
+      state.columnMatching[j] = tightRow[j];
+    }
+  }
+  std::vector<int> freeRows;
+  for (int i = 1; i <= size; i++) {
+    if (rowColumn[i] != 0) continue;
+    const T* costRow = &cost[(i - 1) * size] - 1;
+    for (int j = 1; j <= size; j++) {
+      if (state.columnMatching[j] == 0 &&
+          costRow[j] - state.rowDuals[i] - state.colDuals[j] == 0) {
+        rowColumn[i] = j;
+        state.columnMatching[j] = i;
+        break;
+      }
+    }
+    if (rowColumn[i] == 0) freeRows.push_back(i);
+  }
+  return freeRows;
+}
+
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithmFastPath(
+    const std::vector<std::vector<T>>& costMatrix, FrameArena& arena,
+    FastPathStats* stats) {
+  int numRows = costMatrix.size();
+  if (numRows == 0) return std::make_pair(T(0), std::vector<int>());
+  int numCols = costMatrix[0].size();
+  int size = std::max(numRows, numCols);
+  FrameArenaScope scope(arena);
+  ArenaVector<T> cost = padCostMatrix(costMatrix, size, T(0), arena);
+
+  // Row reduction: every row dual is the minimum of its row.
+  HungarianState<T> state;
+  state.rowDuals.assign(size + 1, 0);
+  for (int i = 1; i <= size; i++) {
+    const T* costRow = &cost[(i - 1) * size];
+    state.rowDuals[i] = *std::min_element(costRow, costRow + size);
+  }
+
+  std::vector<int> freeRows = matchTightPairs(cost, size, state, arena);
+
+  if (stats != nullptr) {
+    stats->numSolves++;
+    if (freeRows.empty()) stats->numGreedyOptimal++;
+    stats->numGreedyRows += size - freeRows.size();
+    stats->numAugmentedRows += freeRows.size();
+  }
+  if (!freeRows.empty()) {
+    augmentAssignment(cost, size, freeRows, state, arena);
+  }
+
+  // The padded cells cost zero, so the cost of the original cells is the
+  // optimal cost.
+  std::vector<int> assignment(numRows, -1);
+  T optimalCost = 0;
+  for (int j = 1; j <= numCols; j++) {
+    int row = state.columnMatching[j];
+    if (row > 0 && row <= numRows) {
+      assignment[row - 1] = j - 1;
+      optimalCost += costMatrix[row - 1][j - 1];
+    }
+  }
+  return std::make_pair(optimalCost, assignment);
+}
+
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithmFastPath(
+    const std::vector<std::vector<T>>& costMatrix, FastPathStats* stats) {
+  // Size the arena as for hungarianAlgorithm, plus the greedy work arrays.
+  size_t size = costMatrix.empty()
+                    ? 0
+                    : std::max(costMatrix.size(), costMatrix[0].size());
+  FrameArena arena((size * size + 10 * (size + 1)) * sizeof(T) + 256);
+  return hungarianAlgorithmFastPath(costMatrix, arena, stats);
+}
+
+template <typename T>
+std::vector<std::pair<T, std::vector<int>>> hungarianAlgorithmBatch(
+    const std::vector<std::vector<std::vector<T>>>& costMatrices,
+    ThreadPool& pool) {
+  std::vector<std::pair<T, std::vector<int>>> results(costMatrices.size());
+  pool.parallelFor(0, costMatrices.size(), [&](size_t i) {
+    results[i] = hungarianAlgorithm(costMatrices[i]);
+  });
+  return results;
+}
+
 // Explicit instantiations for type to use.
-template std::vector<std::vector<float>> padCostMatrix<float>(
-    const std::vector<std::vector<float>>& costMatrix, int size, float INF);
+template ArenaVector<float> padCostMatrix<float>(
+    const std::vector<std::vector<float>>& costMatrix, int size,
+    float padValue, FrameArena& arena);
 
 template std::pair<int, float> exploreColumns<float>(
-    int currentColumn, int size, const std::vector<std::vector<float>>& cost,
-    const std::vector<float>& rowDuals, const std::vector<float>& colDuals,
-    std::vector<float>& minReducedCost, const std::vector<bool>& visitedColumns,
-    const std::vector<int>& columnMatching, std::vector<int>& previousColumn,
+    int currentColumn, int size, const ArenaVector<float>& cost,
+    const ArenaVector<float>& rowDuals, const ArenaVector<float>& colDuals,
+    ArenaVector<float>& minReducedCost, const ArenaVector<bool>& visitedColumns,
+    const ArenaVector<int>& columnMatching, ArenaVector<int>& previousColumn,
     float INF);
 
 template void updateDualVariables<float>(
-    int size, std::vector<float>& rowDuals, std::vector<float>& colDuals,
-    std::vector<float>& minReducedCost, const std::vector<bool>& visitedColumns,
-    const std::vector<int>& columnMatching, float delta);
+    int size, ArenaVector<float>& rowDuals, ArenaVector<float>& colDuals,
+    ArenaVector<float>& minReducedCost, const ArenaVector<bool>& visitedColumns,
+    const ArenaVector<int>& columnMatching, float delta);
 
 template void augmentRowAssignment<float>(
-    int currentRow, int size, const std::vector<std::vector<float>>& cost,
-    std::vector<float>& rowDuals, std::vector<float>& colDuals,
-    std::vector<int>& columnMatching, std::vector<int>& previousColumn,
+    int currentRow, int size, const ArenaVector<float>& cost,
+    ArenaVector<float>& rowDuals, ArenaVector<float>& colDuals,
+    ArenaVector<int>& columnMatching, ArenaVector<int>& previousColumn,
+    ArenaVector<float>& minReducedCost, ArenaVector<bool>& visitedColumns,
     float INF);
 
 template std::pair<float, std::vector<int>> hungarianAlgorithm<float>(
-    const std::vector<std::vector<float>>& costMatrix);
\ No newline at end of file
+    const std::vector<std::vector<float>>& costMatrix, FrameArena& arena);
+
+template std::pair<float, std::vector<int>> hungarianAlgorithm<float>(
+    const std::vector<std::vector<float>>& costMatrix);
+
+template void augmentRowAssignmentWithUnmatched<float>(
+    int currentRow, int numCols, const ArenaVector<float>& cost,
+    float unmatchedCost, ArenaVector<float>& rowDuals,
+    ArenaVector<float>& colDuals, ArenaVector<int>& columnMatching,
+    ArenaVector<int>& previousColumn, ArenaVector<float>& minReducedCost,
+    ArenaVector<bool>& visitedColumns, float INF);
+
+template std::pair<float, std::vector<int>>
+hungarianAlgorithmWithUnmatched<float>(
+    const std::vector<std::vector<float>>& costMatrix, float unmatchedCost,
+    FrameArena& arena);
+
+template std::pair<float, std::vector<int>>
+hungarianAlgorithmWithUnmatched<float>(
+    const std::vector<std::vector<float>>& costMatrix, float unmatchedCost);
+
+template void augmentAssignment<float>(const ArenaVector<float>& cost,
+                                       int size, const std::vector<int>& rows,
+                                       HungarianState<float>& state,
+                                       FrameArena& arena);
+
+template std::vector<int> matchTightPairs<float>(
+    const ArenaVector<float>& cost, int size, HungarianState<float>& state,
+    FrameArena& arena);
+
+template std::pair<float, std::vector<int>> hungarianAlgorithmFastPath<float>(
+    const std::vector<std::vector<float>>& costMatrix, FrameArena& arena,
+    FastPathStats* stats);
+
+template std::pair<float, std::vector<int>> hungarianAlgorithmFastPath<float>(
+    const std::vector<std::vector<float>>& costMatrix, FastPathStats* stats);
+
+template std::vector<std::pair<float, std::vector<int>>>
+hungarianAlgorithmBatch<float>(
+    const std::vector<std::vector<std::vector<float>>>& costMatrices,
+    ThreadPool& pool);
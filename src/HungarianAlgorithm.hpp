@@ -1,8 +1,112 @@
 #pragma once
 
+#include <cstddef>
 #include <utility>
 #include <vector>
 
+#include "FrameArena.hpp"
+#include "ThreadPool.hpp"
+
+// Dual variables and matching of a square assignment problem, which can warm
+// start related problems whose costs are not lower, e.g. with some pairs
+// forbidden. Indices are 1-based with index 0 reserved for the solver:
+// columnMatching[j] is the row matched to column j, or 0.
+template <typename T>
+struct HungarianState {
+  std::vector<T> rowDuals;
+  std::vector<T> colDuals;
+  std::vector<int> columnMatching;
+};
+
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithm(
+    const std::vector<std::vector<T>>& costMatrix);
+
+// costMatrix padded to a size x size matrix stored row by row, the padded
+// cells cost padValue.
+template <typename T>
+ArenaVector<T> padCostMatrix(const std::vector<std::vector<T>>& costMatrix,
+                             int size, T padValue, FrameArena& arena);
+
+// Assign the unmatched rows (1-based) of the size x size problem cost, stored
+// row by row, starting from state, with one augmenting path search per row.
+// An empty state is a cold start. Otherwise the duals of state must be
+// feasible for cost: no reduced cost negative and those of the matched pairs
+// zero, which a solved state remains if costs are only raised and some of
+// its rows unmatched. The work arrays are allocated from arena.
+template <typename T>
+void augmentAssignment(const ArenaVector<T>& cost, int size,
+                       const std::vector<int>& rows, HungarianState<T>& state,
+                       FrameArena& arena);
+
+// Reduce the column duals of the size x size problem cost, stored row by row,
+// against the row duals of state, which makes the duals feasible, and match
+// the pairs of zero reduced cost greedily. The column duals and the matching
+// of state are overwritten. Returns the rows (1-based) left unmatched, which
+// augmentAssignment can finish. The work arrays are allocated from arena.
+template <typename T>
+std::vector<int> matchTightPairs(const ArenaVector<T>& cost, int size,
+                                 HungarianState<T>& state, FrameArena& arena);
+
+// Same as above, but the padded matrix and the work arrays are allocated from
+// arena, which is rewound before returning. Reusing one arena across frames
+// avoids allocating the solver scratch for every solve.
 template <typename T>
 std::pair<T, std::vector<int>> hungarianAlgorithm(
-    const std::vector<std::vector<T>>& costMatrix);
\ No newline at end of file
+    const std::vector<std::vector<T>>& costMatrix, FrameArena& arena);
+
+// Same as hungarianAlgorithm, but every row may also stay unmatched at a cost
+// of unmatchedCost, so a row is only assigned where that is cheaper. This is
+// solved by giving every row an implicit dummy column, the cost matrix is
+// neither padded nor extended. Unmatched rows are -1 in the assignment, and
+// the total cost includes unmatchedCost for each of them. unmatchedCost must
+// be finite.
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithmWithUnmatched(
+    const std::vector<std::vector<T>>& costMatrix, T unmatchedCost);
+
+// Same as above, with the scratch allocated from arena as for
+// hungarianAlgorithm.
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithmWithUnmatched(
+    const std::vector<std::vector<T>>& costMatrix, T unmatchedCost,
+    FrameArena& arena);
+
+// Counters of hungarianAlgorithmFastPath over all its solves.
+struct FastPathStats {
+  size_t numSolves = 0;
+  // Solves the greedy assignment was already optimal for.
+  size_t numGreedyOptimal = 0;
+  // Rows matched greedily and rows left to the augmenting path search.
+  size_t numGreedyRows = 0;
+  size_t numAugmentedRows = 0;
+
+  double hitRate() const {
+    return numSolves == 0 ? 0.0 : double(numGreedyOptimal) / numSolves;
+  }
+};
+
+// Same result as hungarianAlgorithm, faster on the diagonal dominant matrices
+// of consecutive frames. The rows and columns are reduced by their minima,
+// which gives feasible duals, and pairs of zero reduced cost are matched
+// greedily. A complete greedy assignment is then optimal by complementary
+// slackness, otherwise only the rows left over are augmented from these
+// duals instead of solving the whole matrix. The scratch is allocated from
+// arena. stats, if given, is updated.
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithmFastPath(
+    const std::vector<std::vector<T>>& costMatrix, FrameArena& arena,
+    FastPathStats* stats = nullptr);
+
+// Same as above, with the scratch allocated from a temporary arena.
+template <typename T>
+std::pair<T, std::vector<int>> hungarianAlgorithmFastPath(
+    const std::vector<std::vector<T>>& costMatrix,
+    FastPathStats* stats = nullptr);
+
+// Solve independent assignment problems in parallel on pool, result i belongs
+// to costMatrices[i].
+template <typename T>
+std::vector<std::pair<T, std::vector<int>>> hungarianAlgorithmBatch(
+    const std::vector<std::vector<std::vector<T>>>& costMatrices,
+    ThreadPool& pool = defaultThreadPool());
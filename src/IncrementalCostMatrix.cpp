@@ -0,0 +1,218 @@
+#include "IncrementalCostMatrix.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <unordered_map>
+
+#include "FnvHash.hpp"
+#include "TreeMatching.hpp"
+
+// FNV-1a hash of the bytes of a feature vector.
+template <typename T>
+static uint64_t hashFeatures(const std::vector<T>& features) {
+  uint64_t hash = kFnvOffsetBasis;
+  hashBytes(hash, features.data(), features.size() * sizeof(T));
+  return hash;
+}
+
+// For every feature vector of features the index of an equal one of stored,
+// each stored one used at most once, or -1 if there is none. Equal vectors at
+// the same index are paired first, the others are looked up by hash. Returns
+// whether every vector is paired with the one at its own index.
+template <typename T>
+static bool matchStoredFeatures(const std::vector<std::vector<T>>& stored,
+                                const std::vector<std::vector<T>>& features,
+                                std::vector<int>& source) {
+  source.assign(features.size(), -1);
+  std::vector<bool> used(stored.size(), false);
+  bool identity = stored.size() == features.size();
+  for (size_t i = 0; i < features.size() && i < stored.size(); ++i) {
+    if (stored[i] == features[i]) {
+      source[i] = i;
+      used[i] = true;
+    } else {
+      identity = false;
+    }
+  }
+  if (identity) return true;
+
+  std::unordered_multimap<uint64_t, int> unused;
+  for (size_t i = 0; i < stored.size(); ++i) {
+    if (!used[i]) unused.emplace(hashFeatures(stored[i]), i);
+  }
+  for (size_t i = 0; i < features.size(); ++i) {
+    if (source[i] >= 0) continue;
+    auto range = unused.equal_range(hashFeatures(features[i]));
+    for (auto it = range.first; it != range.second; ++it) {
+      if (stored[it->second] == features[i]) {
+        source[i] = it->second;
+        unused.erase(it);
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+template <typename T>
+IncrementalCostMatrix<T>::IncrementalCostMatrix(
+    const std::string& similarityType) {
+  if (similarityType == "cosine") {
+    useCosine_ = true;
+  } else if (similarityType == "euclidean") {
+    useCosine_ = false;
+  } else {
+    std::cout << "unknown similarityType " << similarityType << std::endl;
+    exit(1);
+  }
+}
+
+template <typename T>
+T IncrementalCostMatrix<T>::computeCost(size_t row, size_t col) const {
+  if (useCosine_) {
+    return -computeCosineSimilarity(rowFeatures_[row], colFeatures_[col]);
+  }
+  return -computeEuclideanSimilarity(rowFeatures_[row], colFeatures_[col]);
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::insertRow(size_t row,
+                                         const std::vector<T>& features) {
+  rowFeatures_.insert(rowFeatures_.begin() + row, features);
+  rowDirty_.insert(rowDirty_.begin() + row, true);
+  cost_.insert(cost_.begin() + row, std::vector<T>(numCols(), 0.0));
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::eraseRow(size_t row) {
+  rowFeatures_.erase(rowFeatures_.begin() + row);
+  rowDirty_.erase(rowDirty_.begin() + row);
+  cost_.erase(cost_.begin() + row);
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::updateRow(size_t row,
+                                         const std::vector<T>& features) {
+  rowFeatures_[row] = features;
+  rowDirty_[row] = true;
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::insertColumn(size_t col,
+                                            const std::vector<T>& features) {
+  colFeatures_.insert(colFeatures_.begin() + col, features);
+  colDirty_.insert(colDirty_.begin() + col, true);
+  for (std::vector<T>& costRow : cost_) {
+    costRow.insert(costRow.begin() + col, 0.0);
+  }
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::eraseColumn(size_t col) {
+  colFeatures_.erase(colFeatures_.begin() + col);
+  colDirty_.erase(colDirty_.begin() + col);
+  for (std::vector<T>& costRow : cost_) {
+    costRow.erase(costRow.begin() + col);
+  }
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::updateColumn(size_t col,
+                                            const std::vector<T>& features) {
+  colFeatures_[col] = features;
+  colDirty_[col] = true;
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::setRows(
+    const std::vector<std::vector<T>>& features) {
+  if (matchStoredFeatures(rowFeatures_, features, source_)) return;
+
+  // Move the kept rows to their new index, the others are dirty.
+  std::vector<std::vector<T>> rowFeatures(features.size());
+  std::vector<bool> rowDirty(features.size(), true);
+  std::vector<std::vector<T>> cost(features.size());
+  for (size_t i = 0; i < features.size(); ++i) {
+    int source = source_[i];
+    if (source >= 0) {
+      rowFeatures[i] = std::move(rowFeatures_[source]);
+      rowDirty[i] = rowDirty_[source];
+      cost[i] = std::move(cost_[source]);
+    } else {
+      rowFeatures[i] = features[i];
+      cost[i].assign(numCols(), 0.0);
+    }
+  }
+  rowFeatures_.swap(rowFeatures);
+  rowDirty_.swap(rowDirty);
+  cost_.swap(cost);
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::setColumns(
+    const std::vector<std::vector<T>>& features) {
+  if (matchStoredFeatures(colFeatures_, features, source_)) return;
+
+  // Move the kept columns to their new index, the others are dirty.
+  std::vector<std::vector<T>> colFeatures(features.size());
+  std::vector<bool> colDirty(features.size(), true);
+  for (size_t j = 0; j < features.size(); ++j) {
+    int source = source_[j];
+    if (source >= 0) {
+      colFeatures[j] = std::move(colFeatures_[source]);
+      colDirty[j] = colDirty_[source];
+    } else {
+      colFeatures[j] = features[j];
+    }
+  }
+  std::vector<T> costRow(features.size());
+  for (std::vector<T>& row : cost_) {
+    for (size_t j = 0; j < features.size(); ++j) {
+      costRow[j] = source_[j] >= 0 ? row[source_[j]] : 0.0;
+    }
+    row.swap(costRow);
+    costRow.resize(features.size());
+  }
+  colFeatures_.swap(colFeatures);
+  colDirty_.swap(colDirty);
+}
+
+template <typename T>
+void IncrementalCostMatrix<T>::invalidate() {
+  rowDirty_.assign(numRows(), true);
+  colDirty_.assign(numCols(), true);
+}
+
+template <typename T>
+const std::vector<std::vector<T>>& IncrementalCostMatrix<T>::costMatrix() {
+  numRecomputedCells_ = 0;
+
+  dirtyCols_.clear();
+  for (size_t j = 0; j < numCols(); ++j) {
+    if (colDirty_[j]) dirtyCols_.push_back(j);
+  }
+
+  for (size_t i = 0; i < numRows(); ++i) {
+    std::vector<T>& costRow = cost_[i];
+    if (rowDirty_[i]) {
+      // Dirty row: recompute all of its cells.
+      for (size_t j = 0; j < numCols(); ++j) {
+        costRow[j] = computeCost(i, j);
+      }
+      numRecomputedCells_ += numCols();
+      rowDirty_[i] = false;
+    } else {
+      // Clean row: only the cells of dirty columns.
+      for (size_t j : dirtyCols_) {
+        costRow[j] = computeCost(i, j);
+      }
+      numRecomputedCells_ += dirtyCols_.size();
+    }
+  }
+  colDirty_.assign(numCols(), false);
+  return cost_;
+}
+
+// Explicit instantiations for type to use.
+template class IncrementalCostMatrix<float>;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Cost matrix between the nodes of tree A (rows) and tree B (columns) that is
+// kept from frame to frame. Rows and columns whose feature vectors changed are
+// marked dirty and only their cells are recomputed, which reduces the cost of
+// an update from O(N * M * D) to O((dN * M + N * dM) * D). The cost of a cell
+// is the negative similarity of its feature vectors, same as matchTrees.
+template <typename T>
+class IncrementalCostMatrix {
+ public:
+  // similarityType: "cosine" or "euclidean"
+  explicit IncrementalCostMatrix(const std::string& similarityType = "cosine");
+
+  size_t numRows() const { return rowFeatures_.size(); }
+  size_t numCols() const { return colFeatures_.size(); }
+
+  // Edit single rows (nodes of tree A) and columns (nodes of tree B).
+  void insertRow(size_t row, const std::vector<T>& features);
+  void eraseRow(size_t row);
+  void updateRow(size_t row, const std::vector<T>& features);
+  void insertColumn(size_t col, const std::vector<T>& features);
+  void eraseColumn(size_t col);
+  void updateColumn(size_t col, const std::vector<T>& features);
+
+  // Replace the feature vectors of all rows (columns). Rows are matched with
+  // the stored rows by their feature vectors rather than by index, so rows
+  // shifted by inserting or erasing a node of a sorted tree keep their cells.
+  // Only rows without an equal stored row are marked dirty.
+  void setRows(const std::vector<std::vector<T>>& features);
+  void setColumns(const std::vector<std::vector<T>>& features);
+
+  // Mark everything dirty, e.g. after the normalization changed.
+  void invalidate();
+
+  // The cost matrix with all dirty cells recomputed.
+  const std::vector<std::vector<T>>& costMatrix();
+
+  // Number of cells recomputed by the last call of costMatrix.
+  size_t numRecomputedCells() const { return numRecomputedCells_; }
+
+ private:
+  T computeCost(size_t row, size_t col) const;
+
+  bool useCosine_ = true;
+  std::vector<std::vector<T>> rowFeatures_;
+  std::vector<std::vector<T>> colFeatures_;
+  std::vector<bool> rowDirty_;
+  std::vector<bool> colDirty_;
+  std::vector<std::vector<T>> cost_;
+  std::vector<size_t> dirtyCols_;
+  // Stored row (column) each new row (column) is taken from, -1 if none.
+  std::vector<int> source_;
+  size_t numRecomputedCells_ = 0;
+};
@@ -0,0 +1,221 @@
+#include "KBestAssignment.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+
+#include "FrameArena.hpp"
+#include "HungarianAlgorithm.hpp"
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Forbidden column of a row which stands for all padded columns, i.e. for the
+// row being unmatched.
+constexpr int kUnmatchedColumn = -1;
+
+// A subset of the assignments given by constraints, with its best assignment.
+template <typename T>
+struct AssignmentPartition {
+  T cost;
+  // Solver state of the best assignment, warm starts the partitions of it.
+  HungarianState<T> state;
+  // Rows before firstFreeRow are forced to their column in state.
+  int firstFreeRow;
+  // Excluded (row, column) pairs, 0-based.
+  std::vector<std::pair<int, int>> forbidden;
+};
+
+// Column of every row of the padded problem, 0-based.
+template <typename T>
+static std::vector<int> computeRowColumns(const HungarianState<T>& state,
+                                          int size) {
+  std::vector<int> rowColumns(size, -1);
+  for (int j = 1; j <= size; j++) {
+    rowColumns[state.columnMatching[j] - 1] = j - 1;
+  }
+  return rowColumns;
+}
+
+// Cost of the assignment of state on the original cells, false if it takes a
+// cell excluded from cost.
+template <typename T>
+static bool computeAssignmentCost(const std::vector<std::vector<T>>& costMatrix,
+                                  const ArenaVector<T>& cost, int size,
+                                  const HungarianState<T>& state, T INF,
+                                  T& totalCost) {
+  int numRows = costMatrix.size();
+  int numCols = costMatrix[0].size();
+  totalCost = 0;
+  for (int j = 1; j <= size; j++) {
+    int row = state.columnMatching[j];
+    if (cost[(row - 1) * size + j - 1] >= INF) return false;
+    if (row <= numRows && j <= numCols) totalCost += costMatrix[row - 1][j - 1];
+  }
+  return true;
+}
+
+// Solve the partition of parent which forces the rows before row to their
+// columns in parentColumns and forbids the pair of row. The parent's
+// assignment stays optimal for the other rows, so only row is augmented.
+// Returns false if the partition has no assignment.
+template <typename T>
+static bool solvePartition(const std::vector<std::vector<T>>& costMatrix,
+                           const ArenaVector<T>& paddedCost, int size,
+                           const AssignmentPartition<T>& parent,
+                           const std::vector<int>& parentColumns, int row,
+                           AssignmentPartition<T>& partition,
+                           FrameArena& arena) {
+  FrameArenaScope scope(arena);
+  const T INF = std::numeric_limits<T>::max() / 4;
+  int numCols = costMatrix[0].size();
+
+  // Constraints are applied by raising costs to INF, which keeps the duals of
+  // the parent feasible.
+  ArenaVector<T> cost(paddedCost.begin(), paddedCost.end(),
+                      ArenaAllocator<T>(arena));
+  partition.forbidden = parent.forbidden;
+  int column = parentColumns[row];
+  partition.forbidden.push_back(
+      std::make_pair(row, column < numCols ? column : kUnmatchedColumn));
+  for (const std::pair<int, int>& pair : partition.forbidden) {
+    T* costRow = &cost[pair.first * size];
+    if (pair.second != kUnmatchedColumn) {
+      costRow[pair.second] = INF;
+    } else {
+      std::fill(costRow + numCols, costRow + size, INF);
+    }
+  }
+  for (int forcedRow = 0; forcedRow < row; forcedRow++) {
+    int forcedColumn = parentColumns[forcedRow];
+    for (int j = 0; j < size; j++) {
+      if (j != forcedColumn) cost[forcedRow * size + j] = INF;
+    }
+    for (int i = 0; i < size; i++) {
+      if (i != forcedRow) cost[i * size + forcedColumn] = INF;
+    }
+  }
+
+  partition.state = parent.state;
+  partition.state.columnMatching[column + 1] = 0;
+  augmentAssignment(cost, size, std::vector<int>(1, row + 1), partition.state,
+                    arena);
+  partition.firstFreeRow = row;
+  return computeAssignmentCost(costMatrix, cost, size, partition.state, INF,
+                               partition.cost);
+}
+
+template <typename T>
+std::vector<std::pair<T, std::vector<int>>> kBestAssignments(
+    const std::vector<std::vector<T>>& costMatrix, size_t k,
+    ThreadPool& pool) {
+  std::vector<std::pair<T, std::vector<int>>> results;
+  if (k == 0) return results;
+  int numRows = costMatrix.size();
+  int numCols = (numRows > 0 ? costMatrix[0].size() : 0);
+  if (numRows == 0 || numCols == 0) {
+    results.push_back(std::make_pair(T(0), std::vector<int>(numRows, -1)));
+    return results;
+  }
+
+  // Padded as for hungarianAlgorithm. Only the original rows are partitioned,
+  // the padded rows and columns would just repeat the same assignments.
+  int size = std::max(numRows, numCols);
+  FrameArena arena((size * size + 8 * (size + 1)) * sizeof(T) + 256);
+  ArenaVector<T> paddedCost = padCostMatrix(costMatrix, size, T(0), arena);
+
+  // Min-heap of the partitions by the cost of their best assignment.
+  auto costGreater = [](const AssignmentPartition<T>& a,
+                        const AssignmentPartition<T>& b) {
+    return a.cost > b.cost;
+  };
+  std::vector<AssignmentPartition<T>> queue(1);
+  std::vector<int> allRows(size);
+  for (int i = 0; i < size; i++) allRows[i] = i + 1;
+  augmentAssignment(paddedCost, size, allRows, queue[0].state, arena);
+  computeAssignmentCost(costMatrix, paddedCost, size, queue[0].state,
+                        std::numeric_limits<T>::max() / 4, queue[0].cost);
+  queue[0].firstFreeRow = 0;
+
+  std::vector<AssignmentPartition<T>> partitions;
+  std::vector<char> solved;
+  while (!queue.empty()) {
+    std::pop_heap(queue.begin(), queue.end(), costGreater);
+    AssignmentPartition<T> best = std::move(queue.back());
+    queue.pop_back();
+
+    std::vector<int> columns = computeRowColumns(best.state, size);
+    std::vector<int> assignment(numRows, -1);
+    for (int i = 0; i < numRows; i++) {
+      if (columns[i] < numCols) assignment[i] = columns[i];
+    }
+    results.push_back(std::make_pair(best.cost, std::move(assignment)));
+    if (results.size() == k) break;
+
+    // Partition the remaining assignments of best, one partition per free
+    // row.
+    size_t numPartitions = numRows - best.firstFreeRow;
+    partitions.resize(numPartitions);
+    solved.assign(numPartitions, 0);
+    auto solve = [&](size_t p) {
+      // Scratch of the worker for the constrained cost matrix.
+      static thread_local FrameArena workerArena;
+      solved[p] = solvePartition(costMatrix, paddedCost, size, best, columns,
+                                 best.firstFreeRow + p, partitions[p],
+                                 workerArena);
+    };
+    if (numPartitions * size * size < kParallelKBestCells) {
+      for (size_t p = 0; p < numPartitions; p++) solve(p);
+    } else {
+      pool.parallelFor(0, numPartitions, solve);
+    }
+    for (size_t p = 0; p < numPartitions; p++) {
+      if (!solved[p]) continue;
+      queue.push_back(std::move(partitions[p]));
+      std::push_heap(queue.begin(), queue.end(), costGreater);
+    }
+
+    // Only the best k - results.size() partitions can still be returned.
+    size_t remaining = k - results.size();
+    if (queue.size() > remaining) {
+      auto costLess = [](const AssignmentPartition<T>& a,
+                         const AssignmentPartition<T>& b) {
+        return a.cost < b.cost;
+      };
+      std::nth_element(queue.begin(), queue.begin() + remaining, queue.end(),
+                       costLess);
+      queue.resize(remaining);
+      std::make_heap(queue.begin(), queue.end(), costGreater);
+    }
+  }
+  return results;
+}
+
+template <typename T>
+std::vector<std::pair<T, std::vector<int>>> matchTreesKBest(
+    const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB, size_t k,
+    const std::string& similarityType, ThreadPool& pool) {
+  if (similarityType != "cosine" && similarityType != "euclidean") {
+    std::cout << "unknown similarityType " << similarityType << std::endl;
+    exit(1);
+  }
+
+  // Feature vectors as matchTrees computes them.
+  TreeEmbedding<T> embeddingA, embeddingB;
+  std::vector<std::vector<T>> featuresA, featuresB;
+  generatePairFeatures(treeA, treeB, embeddingA, embeddingB, featuresA,
+                       featuresB);
+  std::vector<std::vector<T>> costMatrix = convertSimilarityMatrix2CostMatrix(
+      createSimilarityMatrix(featuresA, featuresB, similarityType));
+  return kBestAssignments(costMatrix, k, pool);
+}
+
+// Explicit instantiations for type to use.
+template std::vector<std::pair<float, std::vector<int>>>
+kBestAssignments<float>(const std::vector<std::vector<float>>& costMatrix,
+                        size_t k, ThreadPool& pool);
+
+template std::vector<std::pair<float, std::vector<int>>>
+matchTreesKBest<float>(const TreeWrapper<float>& treeA,
+                       const TreeWrapper<float>& treeB, size_t k,
+                       const std::string& similarityType, ThreadPool& pool);
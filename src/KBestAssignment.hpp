@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.hpp"
+#include "TreeNode.hpp"
+
+// Partitions of one solution are solved in parallel when they have at least
+// this many cost matrix cells in total.
+constexpr size_t kParallelKBestCells = 1 << 14;
+
+// The k assignments of lowest cost of costMatrix, by Murty's algorithm, in
+// ascending order of cost. Each result has the format of hungarianAlgorithm,
+// the first one is its optimal assignment. Fewer than k are returned if there
+// are not as many distinct assignments of the rows.
+//
+// The solution space of every assignment taken from the queue is partitioned
+// over the rows by forcing and forbidding its pairs. A partition differs from
+// its parent by raised costs and one unmatched row, so it is solved by a
+// single augmenting path search warm started from the parent's duals, instead
+// of a full solve. Only the k best partitions are kept, so memory is bounded
+// by O(k * size) plus one padded cost matrix per thread. The partitions of an
+// assignment are solved in parallel on pool.
+template <typename T>
+std::vector<std::pair<T, std::vector<int>>> kBestAssignments(
+    const std::vector<std::vector<T>>& costMatrix, size_t k,
+    ThreadPool& pool = defaultThreadPool());
+
+// The k best matchings between the nodes of two trees, with the feature
+// vectors and costs of matchTrees. The first result is the matchTrees result.
+// The trees are not modified.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+std::vector<std::pair<T, std::vector<int>>> matchTreesKBest(
+    const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB, size_t k,
+    const std::string& similarityType = "cosine",
+    ThreadPool& pool = defaultThreadPool());
@@ -0,0 +1,116 @@
+#include "KdTree.hpp"
+
+#include <algorithm>
+
+template <typename T>
+void KdTree<T>::build(const std::vector<std::vector<T>>& points) {
+  int numPoints = points.size();
+  dimension_ = numPoints > 0 ? points[0].size() : 0;
+  nodes_.clear();
+  indices_.resize(numPoints);
+  inputPoints_.resize(numPoints * dimension_);
+  for (int i = 0; i < numPoints; i++) {
+    indices_[i] = i;
+    std::copy(points[i].begin(), points[i].begin() + dimension_,
+              inputPoints_.begin() + i * dimension_);
+  }
+  if (numPoints == 0) return;
+  buildNode(0, numPoints);
+
+  // Store the coordinates in leaf order.
+  points_.resize(inputPoints_.size());
+  for (int i = 0; i < numPoints; i++) {
+    std::copy(inputPoints_.begin() + indices_[i] * dimension_,
+              inputPoints_.begin() + (indices_[i] + 1) * dimension_,
+              points_.begin() + i * dimension_);
+  }
+}
+
+template <typename T>
+int KdTree<T>::buildNode(int begin, int end) {
+  int nodeIdx = nodes_.size();
+  nodes_.push_back(Node{begin, end, -1, -1, 0, 0});
+  if (end - begin <= kLeafSize) return nodeIdx;
+
+  // Split the dimension of largest spread at its median.
+  int splitDimension = 0;
+  T largestSpread = -1;
+  for (int d = 0; d < dimension_; d++) {
+    T minValue = inputPoints_[indices_[begin] * dimension_ + d];
+    T maxValue = minValue;
+    for (int i = begin + 1; i < end; i++) {
+      T value = inputPoints_[indices_[i] * dimension_ + d];
+      minValue = std::min(minValue, value);
+      maxValue = std::max(maxValue, value);
+    }
+    if (maxValue - minValue > largestSpread) {
+      largestSpread = maxValue - minValue;
+      splitDimension = d;
+    }
+  }
+
+  int middle = begin + (end - begin) / 2;
+  std::nth_element(indices_.begin() + begin, indices_.begin() + middle,
+                   indices_.begin() + end, [&](int a, int b) {
+                     return inputPoints_[a * dimension_ + splitDimension] <
+                            inputPoints_[b * dimension_ + splitDimension];
+                   });
+  T splitValue = inputPoints_[indices_[middle] * dimension_ + splitDimension];
+
+  // nodes_ may reallocate while the children are built.
+  int left = buildNode(begin, middle);
+  int right = buildNode(middle, end);
+  Node& node = nodes_[nodeIdx];
+  node.left = left;
+  node.right = right;
+  node.splitDimension = splitDimension;
+  node.splitValue = splitValue;
+  return nodeIdx;
+}
+
+template <typename T>
+void KdTree<T>::search(int nodeIdx, const T* query, size_t k,
+                       std::vector<std::pair<T, int>>& heap) const {
+  const Node& node = nodes_[nodeIdx];
+  if (node.left < 0) {
+    for (int i = node.begin; i < node.end; i++) {
+      const T* point = &points_[i * dimension_];
+      T distance = 0;
+      for (int d = 0; d < dimension_; d++) {
+        T diff = point[d] - query[d];
+        distance += diff * diff;
+      }
+      if (heap.size() < k) {
+        heap.push_back(std::make_pair(distance, indices_[i]));
+        std::push_heap(heap.begin(), heap.end());
+      } else if (distance < heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = std::make_pair(distance, indices_[i]);
+        std::push_heap(heap.begin(), heap.end());
+      }
+    }
+    return;
+  }
+
+  // Descend the side of the query first, the other side only if it can
+  // still hold a nearer point.
+  T diff = query[node.splitDimension] - node.splitValue;
+  int nearChild = diff < 0 ? node.left : node.right;
+  int farChild = diff < 0 ? node.right : node.left;
+  search(nearChild, query, k, heap);
+  if (heap.size() < k || diff * diff < heap.front().first) {
+    search(farChild, query, k, heap);
+  }
+}
+
+template <typename T>
+void KdTree<T>::nearest(const T* query, size_t k,
+                        std::vector<std::pair<T, int>>& neighbours) const {
+  neighbours.clear();
+  if (nodes_.empty() || k == 0) return;
+  search(0, query, k, neighbours);
+  std::sort_heap(neighbours.begin(), neighbours.end());
+}
+
+// Explicit instantiations for type to use.
+template class KdTree<float>;
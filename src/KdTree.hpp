@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// k-d tree over a set of points of equal dimension for k nearest neighbour
+// queries by Euclidean distance. The points are copied into one array in the
+// order of the leaves, so a query reads them sequentially.
+template <typename T>
+class KdTree {
+ public:
+  // Points per leaf, below this a scan is cheaper than splitting further.
+  static constexpr int kLeafSize = 8;
+
+  KdTree() = default;
+  explicit KdTree(const std::vector<std::vector<T>>& points) { build(points); }
+
+  // Rebuild the tree over points, the buffers of the previous build are
+  // reused.
+  void build(const std::vector<std::vector<T>>& points);
+
+  size_t size() const { return indices_.size(); }
+
+  // The min(k, size()) points nearest to query as (squared distance, index)
+  // pairs, nearest first. neighbours is overwritten and keeps its capacity,
+  // so repeated queries do not allocate. Concurrent queries are safe.
+  void nearest(const T* query, size_t k,
+               std::vector<std::pair<T, int>>& neighbours) const;
+  void nearest(const std::vector<T>& query, size_t k,
+               std::vector<std::pair<T, int>>& neighbours) const {
+    nearest(query.data(), k, neighbours);
+  }
+
+ private:
+  struct Node {
+    // Range of the points of the node in indices_ and points_.
+    int begin;
+    int end;
+    // Children, -1 for a leaf.
+    int left;
+    int right;
+    int splitDimension;
+    T splitValue;
+  };
+
+  int buildNode(int begin, int end);
+  void search(int nodeIdx, const T* query, size_t k,
+              std::vector<std::pair<T, int>>& heap) const;
+
+  int dimension_ = 0;
+  std::vector<Node> nodes_;
+  // Original index of every point, in leaf order.
+  std::vector<int> indices_;
+  // Coordinates of the points in leaf order, dimension_ values per point.
+  std::vector<T> points_;
+  // Build scratch: coordinates in the input order.
+  std::vector<T> inputPoints_;
+};
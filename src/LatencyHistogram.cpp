@@ -0,0 +1,82 @@
+#include "LatencyHistogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Values below kSubBucketCount have a bucket each. Above, a value with its
+// highest bit at position kSubBucketBits - 1 + shift falls into one of the
+// kSubBucketCount / 2 buckets of width 2^shift of its power of two range.
+static constexpr uint64_t kSubBucketCount = uint64_t(1)
+                                            << LatencyHistogram::kSubBucketBits;
+static constexpr int kNumBuckets =
+    kSubBucketCount +
+    (64 - LatencyHistogram::kSubBucketBits) * (kSubBucketCount / 2);
+
+static int highestBit(uint64_t value) {
+  int bit = 0;
+  while (value >>= 1) bit++;
+  return bit;
+}
+
+LatencyHistogram::LatencyHistogram() : counts_(kNumBuckets, 0) {}
+
+int LatencyHistogram::bucketIndex(uint64_t nanoseconds) {
+  if (nanoseconds < kSubBucketCount) return nanoseconds;
+  int shift = highestBit(nanoseconds) - (kSubBucketBits - 1);
+  uint64_t subBucket = nanoseconds >> shift;
+  return kSubBucketCount + (shift - 1) * (kSubBucketCount / 2) +
+         (subBucket - kSubBucketCount / 2);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(int index) {
+  if (index < static_cast<int>(kSubBucketCount)) return index;
+  int offset = index - kSubBucketCount;
+  int shift = offset / (kSubBucketCount / 2) + 1;
+  uint64_t subBucket = offset % (kSubBucketCount / 2) + kSubBucketCount / 2;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(double latency) {
+  double nanoseconds = std::max(latency, 0.0) * 1000.0;
+  // Clamp to the range of the buckets.
+  uint64_t value = nanoseconds >= 1.8e19 ? UINT64_MAX
+                                         : static_cast<uint64_t>(
+                                               std::llround(nanoseconds));
+  counts_[bucketIndex(value)]++;
+  if (count_ == 0 || latency < min_) min_ = latency;
+  if (latency > max_) max_ = latency;
+  total_ += latency;
+  count_++;
+}
+
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+  if (other.count_ == 0) return;
+  for (size_t i = 0; i < counts_.size(); i++) counts_[i] += other.counts_[i];
+  if (count_ == 0 || other.min_ < min_) min_ = other.min_;
+  max_ = std::max(max_, other.max_);
+  total_ += other.total_;
+  count_ += other.count_;
+}
+
+void LatencyHistogram::reset() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  count_ = 0;
+  min_ = 0.0;
+  max_ = 0.0;
+  total_ = 0.0;
+}
+
+double LatencyHistogram::percentile(double percentile) const {
+  if (count_ == 0) return 0.0;
+  // Rank of the latency among the recorded ones, 1-based.
+  double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100.0;
+  uint64_t rank = std::max<uint64_t>(1, std::ceil(fraction * count_));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); i++) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(bucketUpperBound(i) / 1000.0, max_);
+    }
+  }
+  return max_;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Histogram of latencies in microseconds with HDR-style log-linear buckets:
+// every power of two range is split into the same number of linear buckets,
+// so a percentile is exact up to a relative error of
+// 1 / 2^(kSubBucketBits - 1) at any magnitude while the memory stays fixed.
+// Latencies are recorded with a resolution of one nanosecond. Recording is
+// O(1) and does not allocate.
+class LatencyHistogram {
+ public:
+  // Relative precision of the percentiles: 1 / 128, below 1%.
+  static constexpr int kSubBucketBits = 8;
+
+  LatencyHistogram();
+
+  void record(double latency);
+  // Add the latencies recorded by other.
+  void merge(const LatencyHistogram& other);
+  void reset();
+
+  size_t count() const { return count_; }
+  double min() const { return count_ == 0 ? 0.0 : min_; }
+  double max() const { return max_; }
+  double mean() const { return count_ == 0 ? 0.0 : total_ / count_; }
+
+  // Latency at or below which percentile percent of the recorded latencies
+  // lie, e.g. percentile(99.9). Reported as the upper bound of its bucket,
+  // but not above max().
+  double percentile(double percentile) const;
+
+ private:
+  static int bucketIndex(uint64_t nanoseconds);
+  static uint64_t bucketUpperBound(int index);
+
+  std::vector<uint64_t> counts_;
+  size_t count_ = 0;
+  double min_ = 0.0;
+  double max_ = 0.0;
+  double total_ = 0.0;
+};
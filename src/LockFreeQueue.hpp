@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Size of a cache line, used to keep producer and consumer indices apart.
+constexpr size_t kCacheLineSize = 64;
+
+// Round capacity up to a power of two so that indices can be masked.
+inline size_t roundUpToPowerOfTwo(size_t capacity) {
+  size_t size = 1;
+  while (size < capacity) size <<= 1;
+  return size;
+}
+
+// Bounded lock-free ring buffer for a single producer thread and a single
+// consumer thread. tryPush and tryPop never block, they fail if the queue is
+// full or empty respectively.
+template <typename V>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity)
+      : buffer_(roundUpToPowerOfTwo(capacity < 1 ? 1 : capacity)),
+        mask_(buffer_.size() - 1) {}
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  size_t capacity() const { return buffer_.size(); }
+
+  bool tryPush(V value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cachedHead_ == buffer_.size()) {
+      cachedHead_ = head_.load(std::memory_order_acquire);
+      if (tail - cachedHead_ == buffer_.size()) return false;
+    }
+    buffer_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(V& value) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == cachedTail_) {
+      cachedTail_ = tail_.load(std::memory_order_acquire);
+      if (head == cachedTail_) return false;
+    }
+    value = std::move(buffer_[head & mask_]);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  std::vector<V> buffer_;
+  size_t mask_;
+  // Consumer side.
+  std::atomic<size_t> head_{0};
+  size_t cachedTail_ = 0;
+  char padding_[kCacheLineSize];
+  // Producer side.
+  std::atomic<size_t> tail_{0};
+  size_t cachedHead_ = 0;
+};
+
+// Bounded lock-free ring buffer for any number of producer and consumer
+// threads (Dmitry Vyukov's bounded MPMC queue). Every cell carries a sequence
+// number telling whether it is ready to be written or read in the current lap.
+template <typename V>
+class MpmcQueue {
+ public:
+  explicit MpmcQueue(size_t capacity)
+      : cells_(roundUpToPowerOfTwo(capacity < 2 ? 2 : capacity)),
+        mask_(cells_.size() - 1) {
+    for (size_t i = 0; i < cells_.size(); ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcQueue(const MpmcQueue&) = delete;
+  MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+  size_t capacity() const { return cells_.size(); }
+
+  bool tryPush(V value) {
+    Cell* cell;
+    size_t pos = enqueuePos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) -
+                            static_cast<std::ptrdiff_t>(pos);
+      if (diff == 0) {
+        if (enqueuePos_.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Full.
+      } else {
+        pos = enqueuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool tryPop(V& value) {
+    Cell* cell;
+    size_t pos = dequeuePos_.load(std::memory_order_relaxed);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) -
+                            static_cast<std::ptrdiff_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeuePos_.compare_exchange_weak(pos, pos + 1,
+                                              std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (diff < 0) {
+        return false;  // Empty.
+      } else {
+        pos = dequeuePos_.load(std::memory_order_relaxed);
+      }
+    }
+    value = std::move(cell->value);
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence{0};
+    V value{};
+  };
+
+  std::vector<Cell> cells_;
+  size_t mask_;
+  char padding0_[kCacheLineSize];
+  std::atomic<size_t> enqueuePos_{0};
+  char padding1_[kCacheLineSize];
+  std::atomic<size_t> dequeuePos_{0};
+};
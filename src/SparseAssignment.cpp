@@ -0,0 +1,509 @@
+#include "SparseAssignment.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+
+#include "HungarianAlgorithm.hpp"
+#include "KdTree.hpp"
+#include "ThreadPool.hpp"
+
+// Rows of candidates searched per task.
+constexpr size_t kCandidateRowsPerTask = 64;
+
+// featureVector scaled to unit length, zero vectors stay zero.
+template <typename T>
+static void normalizeFeatureVector(const std::vector<T>& featureVector,
+                                   std::vector<T>& normalized) {
+  T norm = 0;
+  for (T value : featureVector) norm += value * value;
+  norm = std::sqrt(norm);
+  normalized.resize(featureVector.size());
+  for (size_t i = 0; i < featureVector.size(); i++) {
+    normalized[i] = norm == 0 ? 0 : featureVector[i] / norm;
+  }
+}
+
+template <typename T>
+CandidateGraph<T> generateNearestCandidates(
+    const std::vector<std::vector<T>>& featuresA,
+    const std::vector<std::vector<T>>& featuresB, size_t k,
+    const std::string& similarityType) {
+  T (*similarity)(const std::vector<T>&, const std::vector<T>&);
+  bool cosine = similarityType == "cosine";
+  if (cosine) {
+    similarity = computeCosineSimilarity<T>;
+  } else if (similarityType == "euclidean") {
+    similarity = computeEuclideanSimilarity<T>;
+  } else {
+    std::cout << "unknown similarityType " << similarityType << std::endl;
+    exit(1);
+  }
+
+  size_t numRows = featuresA.size();
+  size_t numCandidates = std::min(k, featuresB.size());
+  CandidateGraph<T> candidates;
+  candidates.rowStart.resize(numRows + 1);
+  for (size_t i = 0; i <= numRows; i++) {
+    candidates.rowStart[i] = i * numCandidates;
+  }
+  candidates.columns.resize(numRows * numCandidates);
+  candidates.costs.resize(numRows * numCandidates);
+  if (numCandidates == 0) return candidates;
+
+  KdTree<T> kdTree;
+  if (cosine) {
+    std::vector<std::vector<T>> normalizedB(featuresB.size());
+    for (size_t j = 0; j < featuresB.size(); j++) {
+      normalizeFeatureVector(featuresB[j], normalizedB[j]);
+    }
+    kdTree.build(normalizedB);
+  } else {
+    kdTree.build(featuresB);
+  }
+
+  auto fillRow = [&](size_t i) {
+    // Scratch of the thread, reused for all its rows.
+    static thread_local std::vector<T> query;
+    static thread_local std::vector<std::pair<T, int>> neighbours;
+    if (cosine) {
+      normalizeFeatureVector(featuresA[i], query);
+    } else {
+      query = featuresA[i];
+    }
+    kdTree.nearest(query, numCandidates, neighbours);
+    size_t start = candidates.rowStart[i];
+    for (size_t n = 0; n < numCandidates; n++) {
+      int column = neighbours[n].second;
+      candidates.columns[start + n] = column;
+      candidates.costs[start + n] =
+          -similarity(featuresA[i], featuresB[column]);
+    }
+  };
+
+  // Small inputs are not worth the scheduling overhead.
+  if (numRows * numCandidates < kParallelSimilarityCells) {
+    for (size_t i = 0; i < numRows; i++) fillRow(i);
+  } else {
+    defaultThreadPool().parallelFor(0, numRows, fillRow,
+                                    kCandidateRowsPerTask);
+  }
+  return candidates;
+}
+
+template <typename T>
+CandidateGraph<T> generateGatedCandidates(
+    const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB,
+    const std::vector<std::vector<T>>& featuresA,
+    const std::vector<std::vector<T>>& featuresB, T radius, size_t k,
+    const std::string& similarityType, SpatialGrid<T>& grid) {
+  T (*similarity)(const std::vector<T>&, const std::vector<T>&);
+  if (similarityType == "cosine") {
+    similarity = computeCosineSimilarity<T>;
+  } else if (similarityType == "euclidean") {
+    similarity = computeEuclideanSimilarity<T>;
+  } else {
+    std::cout << "unknown similarityType " << similarityType << std::endl;
+    exit(1);
+  }
+
+  size_t numRows = treeA.nodes.size();
+  grid.build(treeB, radius);
+
+  // Candidates of every row, every row queries the grid once.
+  std::vector<std::vector<std::pair<T, int>>> rowCandidates(numRows);
+  auto collectRow = [&](size_t i) {
+    static thread_local std::vector<int> neighbours;
+    const TreeNode<T>& node = treeA.nodes[i];
+    grid.query(node.posX, node.posY, radius, neighbours);
+    std::vector<std::pair<T, int>>& row = rowCandidates[i];
+    row.reserve(neighbours.size());
+    for (int column : neighbours) {
+      row.push_back(
+          std::make_pair(-similarity(featuresA[i], featuresB[column]), column));
+    }
+    if (k > 0 && k < row.size()) {
+      std::nth_element(row.begin(), row.begin() + k, row.end());
+      row.resize(k);
+    }
+  };
+
+  // Small inputs are not worth the scheduling overhead.
+  size_t numCandidates = treeB.nodes.size();
+  if (k > 0) numCandidates = std::min(numCandidates, k);
+  if (numRows * numCandidates < kParallelSimilarityCells) {
+    for (size_t i = 0; i < numRows; i++) collectRow(i);
+  } else {
+    defaultThreadPool().parallelFor(0, numRows, collectRow,
+                                    kCandidateRowsPerTask);
+  }
+
+  CandidateGraph<T> candidates;
+  candidates.rowStart.assign(numRows + 1, 0);
+  for (size_t i = 0; i < numRows; i++) {
+    candidates.rowStart[i + 1] =
+        candidates.rowStart[i] + rowCandidates[i].size();
+  }
+  candidates.columns.reserve(candidates.rowStart[numRows]);
+  candidates.costs.reserve(candidates.rowStart[numRows]);
+  for (const std::vector<std::pair<T, int>>& row : rowCandidates) {
+    for (const std::pair<T, int>& candidate : row) {
+      candidates.costs.push_back(candidate.first);
+      candidates.columns.push_back(candidate.second);
+    }
+  }
+  return candidates;
+}
+
+template <typename T>
+std::pair<T, std::vector<int>> sparseAssignment(
+    const CandidateGraph<T>& candidates, int numCols, T unmatchedCost) {
+  int numRows = candidates.numRows();
+  const T INF = std::numeric_limits<T>::max() / 4;
+
+  // The costs are shifted to be non-negative, so zero duals are feasible.
+  // Every row takes a column or stays unmatched, so the shift does not change
+  // the optimal assignment.
+  T shift = unmatchedCost;
+  for (T cost : candidates.costs) shift = std::min(shift, cost);
+  T unmatched = unmatchedCost - shift;
+
+  std::vector<T> rowDuals(numRows, 0);
+  std::vector<T> colDuals(numCols, 0);
+  std::vector<int> rowColumn(numRows, -1);
+  std::vector<int> columnRow(numCols, -1);
+
+  // Shortest path search state, reset through touchedColumns.
+  std::vector<T> distance(numCols, INF);
+  std::vector<int> previousRow(numCols, -1);
+  std::vector<char> scanned(numCols, 0);
+  std::vector<int> touchedColumns;
+  std::vector<int> scannedColumns;
+  std::vector<std::pair<int, T>> visitedRows;
+  std::vector<std::pair<T, int>> heap;
+
+  for (int startRow = 0; startRow < numRows; startRow++) {
+    // As in hungarianAlgorithmWithUnmatched the dummy columns are implicit,
+    // only the cheapest one reached so far is kept.
+    T dummyDistance = unmatched - rowDuals[startRow];
+    int dummyRow = startRow;
+
+    // Relax the candidates of row, reached at rowDistance.
+    auto relaxRow = [&](int row, T rowDistance) {
+      visitedRows.push_back(std::make_pair(row, rowDistance));
+      for (int e = candidates.rowStart[row]; e < candidates.rowStart[row + 1];
+           e++) {
+        int column = candidates.columns[e];
+        if (scanned[column]) continue;
+        T reducedCost = candidates.costs[e] - shift - rowDuals[row] -
+                        colDuals[column];
+        T newDistance = rowDistance + reducedCost;
+        if (newDistance < distance[column]) {
+          if (distance[column] == INF) touchedColumns.push_back(column);
+          distance[column] = newDistance;
+          previousRow[column] = row;
+          heap.push_back(std::make_pair(newDistance, column));
+          std::push_heap(heap.begin(), heap.end(), std::greater<>());
+        }
+      }
+    };
+    relaxRow(startRow, 0);
+
+    int freeColumn = -1;
+    T pathDistance = dummyDistance;
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end(), std::greater<>());
+      std::pair<T, int> top = heap.back();
+      heap.pop_back();
+      int column = top.second;
+      if (scanned[column] || top.first > distance[column]) continue;
+      // On a tie a real column is preferred over leaving a row unmatched.
+      if (dummyDistance < top.first) break;
+
+      scanned[column] = 1;
+      scannedColumns.push_back(column);
+      if (columnRow[column] < 0) {
+        freeColumn = column;
+        pathDistance = top.first;
+        break;
+      }
+      int row = columnRow[column];
+      if (top.first + unmatched - rowDuals[row] < dummyDistance) {
+        dummyDistance = top.first + unmatched - rowDuals[row];
+        dummyRow = row;
+      }
+      relaxRow(row, top.first);
+    }
+    if (freeColumn < 0) pathDistance = dummyDistance;
+
+    // Update the duals so that the path becomes tight.
+    for (const std::pair<int, T>& visited : visitedRows) {
+      rowDuals[visited.first] += pathDistance - visited.second;
+    }
+    for (int column : scannedColumns) {
+      colDuals[column] -= pathDistance - distance[column];
+    }
+
+    // Shift the matching along the path, ending at freeColumn or with
+    // dummyRow leaving its column.
+    int column = freeColumn;
+    if (freeColumn < 0 && dummyRow != startRow) {
+      column = rowColumn[dummyRow];
+      rowColumn[dummyRow] = -1;
+    }
+    while (column >= 0) {
+      int row = previousRow[column];
+      int nextColumn = rowColumn[row];
+      rowColumn[row] = column;
+      columnRow[column] = row;
+      if (row == startRow) break;
+      column = nextColumn;
+    }
+
+    for (int touched : touchedColumns) {
+      distance[touched] = INF;
+      scanned[touched] = 0;
+    }
+    touchedColumns.clear();
+    scannedColumns.clear();
+    visitedRows.clear();
+    heap.clear();
+  }
+
+  T totalCost = 0;
+  for (int i = 0; i < numRows; i++) {
+    if (rowColumn[i] < 0) {
+      totalCost += unmatchedCost;
+      continue;
+    }
+    for (int e = candidates.rowStart[i]; e < candidates.rowStart[i + 1]; e++) {
+      if (candidates.columns[e] == rowColumn[i]) {
+        totalCost += candidates.costs[e];
+      }
+    }
+  }
+  return std::make_pair(totalCost, rowColumn);
+}
+
+// Root of the set of element, halving the path on the way.
+static int findRoot(std::vector<int>& parent, int element) {
+  while (parent[element] != element) {
+    parent[element] = parent[parent[element]];
+    element = parent[element];
+  }
+  return element;
+}
+
+template <typename T>
+CandidateComponents findCandidateComponents(const CandidateGraph<T>& candidates,
+                                            int numCols) {
+  int numRows = candidates.numRows();
+  // Rows are the elements [0, numRows), columns follow.
+  std::vector<int> parent(numRows + numCols);
+  std::vector<int> setSize(numRows + numCols, 1);
+  for (size_t e = 0; e < parent.size(); e++) parent[e] = e;
+  for (int i = 0; i < numRows; i++) {
+    for (int e = candidates.rowStart[i]; e < candidates.rowStart[i + 1]; e++) {
+      int rootA = findRoot(parent, i);
+      int rootB = findRoot(parent, numRows + candidates.columns[e]);
+      if (rootA == rootB) continue;
+      // Union by size keeps the trees flat.
+      if (setSize[rootA] < setSize[rootB]) std::swap(rootA, rootB);
+      parent[rootB] = rootA;
+      setSize[rootA] += setSize[rootB];
+    }
+  }
+
+  // Number the components in the order of their first row, then bucket the
+  // rows and the columns by a counting sort.
+  std::vector<int> componentOfRoot(numRows + numCols, -1);
+  std::vector<int> rowComponent(numRows, -1);
+  int numComponents = 0;
+  for (int i = 0; i < numRows; i++) {
+    if (candidates.rowStart[i] == candidates.rowStart[i + 1]) continue;
+    int root = findRoot(parent, i);
+    if (componentOfRoot[root] < 0) componentOfRoot[root] = numComponents++;
+    rowComponent[i] = componentOfRoot[root];
+  }
+  std::vector<int> columnComponent(numCols, -1);
+  for (int j = 0; j < numCols; j++) {
+    columnComponent[j] = componentOfRoot[findRoot(parent, numRows + j)];
+  }
+
+  CandidateComponents components;
+  auto bucket = [numComponents](const std::vector<int>& elementComponent,
+                                std::vector<int>& start,
+                                std::vector<int>& elements) {
+    start.assign(numComponents + 1, 0);
+    for (int component : elementComponent) {
+      if (component >= 0) start[component + 1]++;
+    }
+    for (int c = 0; c < numComponents; c++) start[c + 1] += start[c];
+    elements.resize(start[numComponents]);
+    std::vector<int> next(start.begin(), start.end() - 1);
+    for (size_t e = 0; e < elementComponent.size(); e++) {
+      if (elementComponent[e] >= 0) elements[next[elementComponent[e]]++] = e;
+    }
+  };
+  bucket(rowComponent, components.componentStart, components.componentRows);
+  bucket(columnComponent, components.columnStart,
+         components.componentColumns);
+  return components;
+}
+
+template <typename T>
+std::pair<T, std::vector<int>> sparseAssignmentByComponents(
+    const CandidateGraph<T>& candidates, int numCols, T unmatchedCost,
+    ThreadPool& pool) {
+  int numRows = candidates.numRows();
+  CandidateComponents components =
+      findCandidateComponents(candidates, numCols);
+  int numComponents = components.numComponents();
+
+  // Index of every column within its component.
+  std::vector<int> localColumn(numCols, -1);
+  for (int c = 0; c < numComponents; c++) {
+    for (int n = components.columnStart[c]; n < components.columnStart[c + 1];
+         n++) {
+      localColumn[components.componentColumns[n]] =
+          n - components.columnStart[c];
+    }
+  }
+
+  // Rows without candidates stay unmatched.
+  std::vector<int> assignment(numRows, -1);
+  std::vector<T> componentCost(numComponents, 0);
+  pool.parallelFor(0, numComponents, [&](size_t c) {
+    static thread_local CandidateGraph<T> component;
+    component.rowStart.assign(1, 0);
+    component.columns.clear();
+    component.costs.clear();
+    int rowsBegin = components.componentStart[c];
+    int rowsEnd = components.componentStart[c + 1];
+    for (int n = rowsBegin; n < rowsEnd; n++) {
+      int row = components.componentRows[n];
+      for (int e = candidates.rowStart[row]; e < candidates.rowStart[row + 1];
+           e++) {
+        component.columns.push_back(localColumn[candidates.columns[e]]);
+        component.costs.push_back(candidates.costs[e]);
+      }
+      component.rowStart.push_back(component.columns.size());
+    }
+    int numComponentCols =
+        components.columnStart[c + 1] - components.columnStart[c];
+    std::pair<T, std::vector<int>> result =
+        sparseAssignment(component, numComponentCols, unmatchedCost);
+    componentCost[c] = result.first;
+    for (int n = rowsBegin; n < rowsEnd; n++) {
+      int column = result.second[n - rowsBegin];
+      if (column < 0) continue;
+      assignment[components.componentRows[n]] =
+          components.componentColumns[components.columnStart[c] + column];
+    }
+  });
+
+  T totalCost = 0;
+  for (T cost : componentCost) totalCost += cost;
+  for (int i = 0; i < numRows; i++) {
+    if (candidates.rowStart[i] == candidates.rowStart[i + 1]) {
+      totalCost += unmatchedCost;
+    }
+  }
+  return std::make_pair(totalCost, assignment);
+}
+
+template <typename T>
+std::vector<int> matchCandidates(const CandidateGraph<T>& candidates,
+                                 const std::vector<std::vector<T>>& featuresA,
+                                 const std::vector<std::vector<T>>& featuresB,
+                                 const TreeMatchingOptions<T>& options) {
+  if (options.minSimilarity != -std::numeric_limits<T>::infinity()) {
+    return sparseAssignmentByComponents(candidates, featuresB.size(),
+                                        -options.minSimilarity)
+        .second;
+  }
+
+  // An augmenting path that matches one more row adds p + 1 candidate pairs
+  // and removes p, with p < min(numRows, numCols), so it costs at most
+  // maxCost + p * (maxCost - minCost). Leaving a row unmatched costs more than
+  // any such path, so the matching has maximum cardinality on the candidates
+  // and a row only stays unmatched if no augmenting path reaches a free
+  // column.
+  T minCost = 0;
+  T maxCost = 0;
+  if (!candidates.costs.empty()) {
+    auto bounds =
+        std::minmax_element(candidates.costs.begin(), candidates.costs.end());
+    minCost = *bounds.first;
+    maxCost = *bounds.second;
+  }
+  T maxPathLength = std::min(candidates.numRows(), featuresB.size());
+  std::vector<int> matching =
+      sparseAssignmentByComponents(
+          candidates, featuresB.size(),
+          maxCost + (maxPathLength + 1) * (maxCost - minCost))
+          .second;
+  if (options.gatingRadius != std::numeric_limits<T>::infinity()) {
+    return matching;
+  }
+
+  // Match the rows left over to the columns left over.
+  std::vector<int> leftoverRows, leftoverCols;
+  std::vector<char> matchedCols(featuresB.size(), 0);
+  for (size_t i = 0; i < matching.size(); i++) {
+    if (matching[i] < 0) {
+      leftoverRows.push_back(i);
+    } else {
+      matchedCols[matching[i]] = 1;
+    }
+  }
+  for (size_t j = 0; j < matchedCols.size(); j++) {
+    if (!matchedCols[j]) leftoverCols.push_back(j);
+  }
+  if (leftoverRows.empty() || leftoverCols.empty()) return matching;
+
+  std::vector<std::vector<T>> leftoverFeaturesA, leftoverFeaturesB;
+  for (int i : leftoverRows) leftoverFeaturesA.push_back(featuresA[i]);
+  for (int j : leftoverCols) leftoverFeaturesB.push_back(featuresB[j]);
+  std::vector<std::vector<T>> costMatrix =
+      convertSimilarityMatrix2CostMatrix(createSimilarityMatrix(
+          leftoverFeaturesA, leftoverFeaturesB, options.similarityType));
+  std::vector<int> leftoverMatching = hungarianAlgorithm(costMatrix).second;
+  for (size_t i = 0; i < leftoverRows.size(); i++) {
+    if (leftoverMatching[i] >= 0) {
+      matching[leftoverRows[i]] = leftoverCols[leftoverMatching[i]];
+    }
+  }
+  return matching;
+}
+
+// Explicit instantiations for type to use.
+template CandidateGraph<float> generateNearestCandidates<float>(
+    const std::vector<std::vector<float>>& featuresA,
+    const std::vector<std::vector<float>>& featuresB, size_t k,
+    const std::string& similarityType);
+
+template CandidateGraph<float> generateGatedCandidates<float>(
+    const TreeWrapper<float>& treeA, const TreeWrapper<float>& treeB,
+    const std::vector<std::vector<float>>& featuresA,
+    const std::vector<std::vector<float>>& featuresB, float radius, size_t k,
+    const std::string& similarityType, SpatialGrid<float>& grid);
+
+template std::pair<float, std::vector<int>> sparseAssignment<float>(
+    const CandidateGraph<float>& candidates, int numCols, float unmatchedCost);
+
+template CandidateComponents findCandidateComponents<float>(
+    const CandidateGraph<float>& candidates, int numCols);
+
+template std::pair<float, std::vector<int>> sparseAssignmentByComponents<float>(
+    const CandidateGraph<float>& candidates, int numCols, float unmatchedCost,
+    ThreadPool& pool);
+
+template std::vector<int> matchCandidates<float>(
+    const CandidateGraph<float>& candidates,
+    const std::vector<std::vector<float>>& featuresA,
+    const std::vector<std::vector<float>>& featuresB,
+    const TreeMatchingOptions<float>& options);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "SpatialGrid.hpp"
+#include "ThreadPool.hpp"
+#include "TreeMatching.hpp"
+
+// Sparse cost matrix: the candidate columns of every row with their costs.
+// The candidates of row i are columns[rowStart[i]] ... columns[rowStart[i + 1]
+// - 1], a column at most once per row.
+template <typename T>
+struct CandidateGraph {
+  std::vector<int> rowStart;
+  std::vector<int> columns;
+  std::vector<T> costs;
+
+  size_t numRows() const { return rowStart.empty() ? 0 : rowStart.size() - 1; }
+  size_t numCandidates() const { return columns.size(); }
+};
+
+// The k nearest nodes of treeB in feature space for every node of treeA, with
+// the costs of matchTrees (negative similarity). The neighbours are found by a
+// k-d tree over featuresB, for "cosine" over the normalized feature vectors
+// since their Euclidean order is the cosine order. Rows are searched in
+// parallel on the default thread pool.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+CandidateGraph<T> generateNearestCandidates(
+    const std::vector<std::vector<T>>& featuresA,
+    const std::vector<std::vector<T>>& featuresB, size_t k,
+    const std::string& similarityType = "cosine");
+
+// The nodes of treeB within radius of every node of treeA by position (posX,
+// posY), with the costs of matchTrees. Physically implausible pairs are never
+// compared by features. With k > 0 only the k most similar of them are kept.
+// grid is rebuilt over treeB, passing the same grid every frame reuses its
+// buckets.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+CandidateGraph<T> generateGatedCandidates(
+    const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB,
+    const std::vector<std::vector<T>>& featuresA,
+    const std::vector<std::vector<T>>& featuresB, T radius, size_t k,
+    const std::string& similarityType, SpatialGrid<T>& grid);
+
+// Minimum cost assignment restricted to the pairs of candidates, where every
+// row may also stay unmatched at a cost of unmatchedCost, which must be
+// finite. Solved by shortest augmenting paths with a heap over the candidate
+// edges, so the work depends on the number of candidates instead of numRows *
+// numCols. The result has the format of hungarianAlgorithmWithUnmatched.
+template <typename T>
+std::pair<T, std::vector<int>> sparseAssignment(
+    const CandidateGraph<T>& candidates, int numCols, T unmatchedCost);
+
+// Connected components of the bipartite graph of candidates, rows and columns
+// without candidates are left out. componentRows[componentStart[c]] ...
+// componentRows[componentStart[c + 1] - 1] are the rows of component c, and
+// likewise the columns.
+struct CandidateComponents {
+  std::vector<int> componentStart;
+  std::vector<int> componentRows;
+  std::vector<int> columnStart;
+  std::vector<int> componentColumns;
+
+  size_t numComponents() const {
+    return componentStart.empty() ? 0 : componentStart.size() - 1;
+  }
+};
+
+// Components of candidates found by union-find over the candidate edges.
+template <typename T>
+CandidateComponents findCandidateComponents(const CandidateGraph<T>& candidates,
+                                            int numCols);
+
+// Same result as sparseAssignment, but every connected component of
+// candidates is solved as an assignment problem of its own, the components in
+// parallel on pool. Gated candidates usually fall apart into many small
+// components.
+template <typename T>
+std::pair<T, std::vector<int>> sparseAssignmentByComponents(
+    const CandidateGraph<T>& candidates, int numCols, T unmatchedCost,
+    ThreadPool& pool = defaultThreadPool());
+
+// Matching of the nodes with feature vectors featuresA to those with
+// featuresB restricted to candidates. With options.minSimilarity set, nodes
+// without a candidate that similar stay unmatched. Otherwise rows left without
+// a candidate are matched to the columns left over by a dense solve, like
+// matchFeatureVectors would match them, unless options.gatingRadius is set:
+// gated candidates are the only plausible pairs.
+template <typename T>
+std::vector<int> matchCandidates(const CandidateGraph<T>& candidates,
+                                 const std::vector<std::vector<T>>& featuresA,
+                                 const std::vector<std::vector<T>>& featuresB,
+                                 const TreeMatchingOptions<T>& options);
@@ -0,0 +1,114 @@
+#include "SpatialGrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Cell of coordinate, the offset from the grid origin, clamped to
+// [0, numCells - 1]. The clamp is done in floating point, before the
+// conversion to int, which is undefined for far away and non-finite
+// coordinates. NaN goes to cell 0.
+template <typename T>
+static int clampedCell(T offset, T cellSize, int numCells) {
+  T cell = std::floor(offset / cellSize);
+  if (!(cell > 0)) return 0;
+  if (cell >= numCells - 1) return numCells - 1;
+  return static_cast<int>(cell);
+}
+
+template <typename T>
+int SpatialGrid<T>::cellX(T x) const {
+  return clampedCell(x - minX_, cellSize_, numCellsX_);
+}
+
+template <typename T>
+int SpatialGrid<T>::cellY(T y) const {
+  return clampedCell(y - minY_, cellSize_, numCellsY_);
+}
+
+template <typename T>
+void SpatialGrid<T>::build(const TreeWrapper<T>& tree, T cellSize) {
+  int numNodes = tree.nodes.size();
+  cellNodes_.resize(numNodes);
+  posX_.resize(numNodes);
+  posY_.resize(numNodes);
+  nodeCell_.resize(numNodes);
+  if (numNodes == 0) {
+    numCellsX_ = 0;
+    numCellsY_ = 0;
+    cellStart_.assign(1, 0);
+    return;
+  }
+
+  T maxX = tree.nodes[0].posX;
+  T maxY = tree.nodes[0].posY;
+  minX_ = maxX;
+  minY_ = maxY;
+  for (const TreeNode<T>& node : tree.nodes) {
+    minX_ = std::min(minX_, node.posX);
+    minY_ = std::min(minY_, node.posY);
+    maxX = std::max(maxX, node.posX);
+    maxY = std::max(maxY, node.posY);
+  }
+
+  // Coarsen the cells until the grid is at most kMaxCellsPerNode cells per
+  // node, sparse trees would waste memory and time on empty cells otherwise.
+  double maxCells = static_cast<double>(kMaxCellsPerNode) * numNodes;
+  cellSize_ = cellSize > 0 ? cellSize : 1;
+  while ((std::floor((maxX - minX_) / cellSize_) + 1) *
+             (std::floor((maxY - minY_) / cellSize_) + 1) >
+         maxCells) {
+    cellSize_ *= 2;
+  }
+  numCellsX_ = static_cast<int>(std::floor((maxX - minX_) / cellSize_)) + 1;
+  numCellsY_ = static_cast<int>(std::floor((maxY - minY_) / cellSize_)) + 1;
+
+  // Counting sort of the nodes by cell.
+  cellStart_.assign(numCellsX_ * numCellsY_ + 1, 0);
+  for (int i = 0; i < numNodes; i++) {
+    const TreeNode<T>& node = tree.nodes[i];
+    nodeCell_[i] = cellY(node.posY) * numCellsX_ + cellX(node.posX);
+    cellStart_[nodeCell_[i] + 1]++;
+  }
+  for (size_t c = 1; c < cellStart_.size(); c++) {
+    cellStart_[c] += cellStart_[c - 1];
+  }
+  // Place the nodes from the back, which leaves cellStart_ at the starts.
+  for (int i = numNodes - 1; i >= 0; i--) {
+    int slot = --cellStart_[nodeCell_[i] + 1];
+    cellNodes_[slot] = i;
+    posX_[slot] = tree.nodes[i].posX;
+    posY_[slot] = tree.nodes[i].posY;
+  }
+  // cellStart_[c + 1] now is the start of cell c, shift it into place.
+  for (size_t c = 0; c + 1 < cellStart_.size(); c++) {
+    cellStart_[c] = cellStart_[c + 1];
+  }
+  cellStart_.back() = numNodes;
+}
+
+template <typename T>
+void SpatialGrid<T>::query(T x, T y, T radius,
+                           std::vector<int>& neighbours) const {
+  neighbours.clear();
+  if (numCellsX_ == 0 || radius < 0) return;
+  int beginX = cellX(x - radius);
+  int endX = cellX(x + radius);
+  int beginY = cellY(y - radius);
+  int endY = cellY(y + radius);
+  T radiusSquared = radius * radius;
+  for (int cy = beginY; cy <= endY; cy++) {
+    // The cells of a grid row are consecutive.
+    int begin = cellStart_[cy * numCellsX_ + beginX];
+    int end = cellStart_[cy * numCellsX_ + endX + 1];
+    for (int slot = begin; slot < end; slot++) {
+      T dx = posX_[slot] - x;
+      T dy = posY_[slot] - y;
+      if (dx * dx + dy * dy <= radiusSquared) {
+        neighbours.push_back(cellNodes_[slot]);
+      }
+    }
+  }
+}
+
+// Explicit instantiations for type to use.
+template class SpatialGrid<float>;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "TreeNode.hpp"
+
+// Uniform grid over the positions (posX, posY) of the nodes of a tree for
+// radius queries. The nodes are bucketed by a counting sort, so a build is
+// O(number of nodes + number of cells), and a rebuild reuses the buckets of
+// the previous one without allocating once they are large enough.
+template <typename T>
+class SpatialGrid {
+ public:
+  // Cells per node at most, a larger grid gets coarser cells instead.
+  static constexpr size_t kMaxCellsPerNode = 4;
+
+  SpatialGrid() = default;
+
+  // Rebuild the grid over the nodes of tree with square cells of cellSize.
+  // A radius query scans the cells within radius, so the query radius is a
+  // good cell size.
+  void build(const TreeWrapper<T>& tree, T cellSize);
+
+  size_t size() const { return cellNodes_.size(); }
+
+  // Indices of the nodes within radius of (x, y), in no particular order.
+  // neighbours is overwritten and keeps its capacity. Concurrent queries are
+  // safe.
+  void query(T x, T y, T radius, std::vector<int>& neighbours) const;
+
+ private:
+  int cellX(T x) const;
+  int cellY(T y) const;
+
+  T minX_ = 0;
+  T minY_ = 0;
+  T cellSize_ = 1;
+  int numCellsX_ = 0;
+  int numCellsY_ = 0;
+  // The nodes of cell c are cellNodes_[cellStart_[c]] ...
+  // cellNodes_[cellStart_[c + 1] - 1], cells in row-major order.
+  std::vector<int> cellStart_;
+  std::vector<int> cellNodes_;
+  // Positions of the nodes in the order of cellNodes_.
+  std::vector<T> posX_;
+  std::vector<T> posY_;
+  // Build scratch: cell of every node.
+  std::vector<int> nodeCell_;
+};
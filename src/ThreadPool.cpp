@@ -0,0 +1,177 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+// Pool and index of the worker running on the current thread.
+static thread_local const ThreadPool* currentPool = nullptr;
+static thread_local int currentWorkerIdx = -1;
+
+static std::mutex defaultPoolMutex;
+static std::unique_ptr<ThreadPool> defaultPool;
+static size_t defaultPoolSize = 0;
+
+constexpr int ThreadPool::kNoAffinity;
+
+ThreadPool::ThreadPool(size_t numThreads) {
+  if (numThreads == 0) {
+    numThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < numThreads; ++i) {
+    queues_.emplace_back(new WorkerQueue());
+  }
+  for (size_t i = 0; i < numThreads; ++i) {
+    workers_.emplace_back(&ThreadPool::runWorker, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stop_ = true;
+  }
+  sleepCondition_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+int ThreadPool::currentWorker() const {
+  return currentPool == this ? currentWorkerIdx : -1;
+}
+
+void ThreadPool::submit(Task task, int affinity) {
+  size_t queueIdx;
+  if (affinity >= 0) {
+    queueIdx = static_cast<size_t>(affinity) % queues_.size();
+  } else if (currentWorker() >= 0) {
+    queueIdx = static_cast<size_t>(currentWorker());
+  } else {
+    queueIdx = nextQueue_.fetch_add(1) % queues_.size();
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queues_[queueIdx]->mutex);
+    queues_[queueIdx]->tasks.push_back(std::move(task));
+  }
+  {
+    // Increment under the sleep mutex so that a worker checking for work
+    // before going to sleep cannot miss the notification.
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    numPending_++;
+  }
+  sleepCondition_.notify_one();
+}
+
+bool ThreadPool::popTask(size_t workerIdx, Task& task) {
+  if (numPending_.load() == 0) return false;
+
+  size_t numQueues = queues_.size();
+  for (size_t k = 0; k < numQueues; ++k) {
+    size_t queueIdx = (workerIdx + k) % numQueues;
+    WorkerQueue& queue = *queues_[queueIdx];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) continue;
+    if (k == 0) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    numPending_--;
+    return true;
+  }
+  return false;
+}
+
+bool ThreadPool::runPendingTask() {
+  int worker = currentWorker();
+  size_t startIdx = worker >= 0 ? static_cast<size_t>(worker)
+                                : nextQueue_.load() % queues_.size();
+  Task task;
+  if (!popTask(startIdx, task)) return false;
+  task();
+  return true;
+}
+
+void ThreadPool::runWorker(size_t workerIdx) {
+  currentPool = this;
+  currentWorkerIdx = static_cast<int>(workerIdx);
+
+  Task task;
+  while (true) {
+    if (popTask(workerIdx, task)) {
+      task();
+      task = nullptr;
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    sleepCondition_.wait(lock,
+                         [this] { return stop_ || numPending_.load() > 0; });
+    if (stop_ && numPending_.load() == 0) return;
+  }
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end,
+                             const std::function<void(size_t)>& body,
+                             size_t grainSize) {
+  if (begin >= end) return;
+  size_t numIndices = end - begin;
+  grainSize = std::max<size_t>(grainSize, 1);
+  // A few chunks per worker balance uneven work without much overhead.
+  size_t numChunks = std::min((numIndices + grainSize - 1) / grainSize,
+                              4 * (numThreads() + 1));
+  if (numChunks <= 1) {
+    for (size_t i = begin; i < end; ++i) {
+      body(i);
+    }
+    return;
+  }
+  size_t chunkSize = (numIndices + numChunks - 1) / numChunks;
+  numChunks = (numIndices + chunkSize - 1) / chunkSize;
+
+  // Shared with the helper tasks, which may start after the loop is done.
+  struct LoopState {
+    std::atomic<size_t> nextChunk{0};
+    std::atomic<size_t> numDone{0};
+  };
+  auto state = std::make_shared<LoopState>();
+  auto runChunks = [state, begin, end, chunkSize, numChunks, &body]() {
+    size_t chunk;
+    while ((chunk = state->nextChunk.fetch_add(1)) < numChunks) {
+      size_t chunkBegin = begin + chunk * chunkSize;
+      size_t chunkEnd = std::min(end, chunkBegin + chunkSize);
+      for (size_t i = chunkBegin; i < chunkEnd; ++i) {
+        body(i);
+      }
+      state->numDone++;
+    }
+  };
+
+  // body stays valid until all chunks are done, helpers starting later only
+  // find no chunk left and do not touch it.
+  size_t numHelpers = std::min(numThreads(), numChunks - 1);
+  for (size_t h = 0; h < numHelpers; ++h) {
+    submit(runChunks, static_cast<int>(h));
+  }
+  runChunks();
+
+  // Chunks taken by other threads may still run, help with other tasks
+  // meanwhile.
+  while (state->numDone.load() < numChunks) {
+    if (!runPendingTask()) std::this_thread::yield();
+  }
+}
+
+ThreadPool& defaultThreadPool() {
+  std::lock_guard<std::mutex> lock(defaultPoolMutex);
+  if (!defaultPool) defaultPool.reset(new ThreadPool(defaultPoolSize));
+  return *defaultPool;
+}
+
+bool setDefaultThreadPoolSize(size_t numThreads) {
+  std::lock_guard<std::mutex> lock(defaultPoolMutex);
+  if (defaultPool) return false;
+  defaultPoolSize = numThreads;
+  return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing task scheduler shared by the matching subsystems, so that
+// parallel similarity matrices, batch solves and batch matches do not each
+// start their own threads.
+//
+// Every worker owns a deque of tasks. A worker runs the newest task of its
+// own deque first and steals the oldest task of another deque when its own
+// one is empty. Tasks may be submitted with an affinity hint, the index of
+// the worker whose deque receives the task, e.g. to keep consecutive tiles
+// of a matrix on the same core.
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  // Submit to the deque of the calling worker, or round robin if the caller
+  // is not a worker of this pool.
+  static constexpr int kNoAffinity = -1;
+
+  // numThreads = 0 uses one worker per hardware thread.
+  explicit ThreadPool(size_t numThreads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t numThreads() const { return workers_.size(); }
+
+  // Index of the calling worker, -1 if the caller is not a worker of this
+  // pool.
+  int currentWorker() const;
+
+  // affinity: index of the preferred worker (taken modulo numThreads) or
+  // kNoAffinity.
+  void submit(Task task, int affinity = kNoAffinity);
+
+  // Run one pending task on the calling thread. Returns false if there was
+  // none.
+  bool runPendingTask();
+
+  // Call body(i) for every i in [begin, end) and return once all calls are
+  // done. The range is split into chunks of at least grainSize indices, the
+  // calling thread processes chunks as well, so nested calls from a worker
+  // do not deadlock.
+  void parallelFor(size_t begin, size_t end,
+                   const std::function<void(size_t)>& body,
+                   size_t grainSize = 1);
+
+ private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void runWorker(size_t workerIdx);
+  // Pop from the back of the own deque, then steal from the front of the
+  // others, starting at the next worker.
+  bool popTask(size_t workerIdx, Task& task);
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  std::vector<std::thread> workers_;
+  std::atomic<size_t> nextQueue_{0};
+  // Number of submitted tasks that no worker has taken yet.
+  std::atomic<size_t> numPending_{0};
+  std::mutex sleepMutex_;
+  std::condition_variable sleepCondition_;
+  bool stop_ = false;
+};
+
+// Pool shared by the library functions that run in parallel. It is created
+// on first use with the size set by setDefaultThreadPoolSize, or one worker
+// per hardware thread.
+ThreadPool& defaultThreadPool();
+
+// Number of workers of the default pool, only effective before its first
+// use. Returns false if the default pool already exists.
+bool setDefaultThreadPoolSize(size_t numThreads);
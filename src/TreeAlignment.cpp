@@ -0,0 +1,211 @@
+#include "TreeAlignment.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Nodes reachable from the root, every node after its descendants.
+template <typename T>
+static std::vector<int> computePostorder(const TreeWrapper<T>& tree) {
+  std::vector<int> order;
+  if (tree.nodes.empty()) return order;
+  order.reserve(tree.nodes.size());
+  std::vector<int> stack(1, 0);
+  while (!stack.empty()) {
+    int idx = stack.back();
+    stack.pop_back();
+    order.push_back(idx);
+    for (int child : tree.nodes[idx].children) stack.push_back(child);
+  }
+  // Reversed preorder.
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+// Cost of removing the whole subtree of every node.
+template <typename T>
+static std::vector<T> computeSubtreeCosts(const TreeWrapper<T>& tree,
+                                          const std::vector<int>& postorder,
+                                          const std::vector<T>& nodeCosts) {
+  std::vector<T> subtreeCosts(tree.nodes.size(), 0);
+  for (int idx : postorder) {
+    T cost = nodeCosts[idx];
+    for (int child : tree.nodes[idx].children) cost += subtreeCosts[child];
+    subtreeCosts[idx] = cost;
+  }
+  return subtreeCosts;
+}
+
+// Sequence alignment of the children of two nodes, given the alignment costs
+// of all their children pairs in alignCosts (numB columns). seq is filled with
+// the (childrenA.size() + 1) x (childrenB.size() + 1) table, where seq[i][j] is
+// the cost of aligning the first i children of A with the first j of B.
+template <typename T>
+static T alignChildren(const std::vector<int>& childrenA,
+                       const std::vector<int>& childrenB,
+                       const std::vector<T>& alignCosts, size_t numB,
+                       const std::vector<T>& subtreeDeleteCosts,
+                       const std::vector<T>& subtreeInsertCosts,
+                       std::vector<T>& seq) {
+  size_t rows = childrenA.size() + 1;
+  size_t cols = childrenB.size() + 1;
+  seq.resize(rows * cols);
+
+  seq[0] = 0;
+  for (size_t j = 1; j < cols; ++j) {
+    seq[j] = seq[j - 1] + subtreeInsertCosts[childrenB[j - 1]];
+  }
+  for (size_t i = 1; i < rows; ++i) {
+    int childA = childrenA[i - 1];
+    const T* prevRow = &seq[(i - 1) * cols];
+    T* row = &seq[i * cols];
+    row[0] = prevRow[0] + subtreeDeleteCosts[childA];
+    for (size_t j = 1; j < cols; ++j) {
+      int childB = childrenB[j - 1];
+      T aligned = prevRow[j - 1] + alignCosts[childA * numB + childB];
+      T deleted = prevRow[j] + subtreeDeleteCosts[childA];
+      T inserted = row[j - 1] + subtreeInsertCosts[childB];
+      row[j] = std::min(aligned, std::min(deleted, inserted));
+    }
+  }
+  return seq[rows * cols - 1];
+}
+
+template <typename T>
+TreeAlignmentResult<T> alignTrees(const TreeWrapper<T>& treeA,
+                                  const TreeWrapper<T>& treeB,
+                                  const std::vector<T>& relabelCosts,
+                                  const std::vector<T>& deleteCosts,
+                                  const std::vector<T>& insertCosts) {
+  size_t numA = treeA.nodes.size();
+  size_t numB = treeB.nodes.size();
+  TreeAlignmentResult<T> result;
+  result.matching.assign(numA, -1);
+
+  std::vector<int> postorderA = computePostorder(treeA);
+  std::vector<int> postorderB = computePostorder(treeB);
+  std::vector<T> subtreeDeleteCosts =
+      computeSubtreeCosts(treeA, postorderA, deleteCosts);
+  std::vector<T> subtreeInsertCosts =
+      computeSubtreeCosts(treeB, postorderB, insertCosts);
+  if (numA == 0 || numB == 0) {
+    if (numA > 0) result.cost += subtreeDeleteCosts[0];
+    if (numB > 0) result.cost += subtreeInsertCosts[0];
+    return result;
+  }
+
+  // alignCosts[a * numB + b] is the cost of aligning the subtrees of a and b
+  // with a aligned to b. Both trees are visited in postorder, so the costs of
+  // all children pairs are known when a pair is reached.
+  std::vector<T> alignCosts(numA * numB, 0);
+  std::vector<T> seq;
+  for (int a : postorderA) {
+    const std::vector<int>& childrenA = treeA.nodes[a].children;
+    for (int b : postorderB) {
+      alignCosts[a * numB + b] =
+          relabelCosts[a * numB + b] +
+          alignChildren(childrenA, treeB.nodes[b].children, alignCosts, numB,
+                        subtreeDeleteCosts, subtreeInsertCosts, seq);
+    }
+  }
+  result.cost = alignCosts[0];
+
+  // Trace back the aligned pairs from the roots, the sequence table of a pair
+  // is recomputed instead of keeping all of them.
+  std::vector<std::pair<int, int>> stack(1, std::make_pair(0, 0));
+  while (!stack.empty()) {
+    int a = stack.back().first;
+    int b = stack.back().second;
+    stack.pop_back();
+    result.matching[a] = b;
+
+    const std::vector<int>& childrenA = treeA.nodes[a].children;
+    const std::vector<int>& childrenB = treeB.nodes[b].children;
+    alignChildren(childrenA, childrenB, alignCosts, numB, subtreeDeleteCosts,
+                  subtreeInsertCosts, seq);
+    size_t cols = childrenB.size() + 1;
+    size_t i = childrenA.size();
+    size_t j = childrenB.size();
+    while (i > 0 && j > 0) {
+      int childA = childrenA[i - 1];
+      int childB = childrenB[j - 1];
+      // Same expressions as in alignChildren, so the chosen one compares
+      // equal.
+      T current = seq[i * cols + j];
+      if (current ==
+          seq[(i - 1) * cols + j - 1] + alignCosts[childA * numB + childB]) {
+        stack.push_back(std::make_pair(childA, childB));
+        --i;
+        --j;
+      } else if (current ==
+                 seq[(i - 1) * cols + j] + subtreeDeleteCosts[childA]) {
+        --i;
+      } else {
+        --j;
+      }
+    }
+  }
+  return result;
+}
+
+template <typename T>
+std::vector<T> createRelabelCosts(const std::vector<std::vector<T>>& featuresA,
+                                  const std::vector<std::vector<T>>& featuresB,
+                                  const std::string& similarityType) {
+  bool cosine = similarityType == "cosine";
+  if (!cosine && similarityType != "euclidean") {
+    std::cout << "unknown similarityType " << similarityType << std::endl;
+    exit(1);
+  }
+
+  size_t numB = featuresB.size();
+  std::vector<T> relabelCosts(featuresA.size() * numB);
+  for (size_t i = 0; i < featuresA.size(); ++i) {
+    T* row = &relabelCosts[i * numB];
+    for (size_t j = 0; j < numB; ++j) {
+      row[j] = cosine
+                   ? 1 - computeCosineSimilarity(featuresA[i], featuresB[j])
+                   : -computeEuclideanSimilarity(featuresA[i], featuresB[j]);
+    }
+  }
+  return relabelCosts;
+}
+
+template <typename T>
+std::vector<int> matchTreesAlignment(const TreeWrapper<T>& treeA,
+                                     const TreeWrapper<T>& treeB,
+                                     const std::string& similarityType,
+                                     T indelCost) {
+  // Feature vectors as matchTrees computes them.
+  TreeEmbedding<T> embeddingA, embeddingB;
+  std::vector<std::vector<T>> featuresA, featuresB;
+  generatePairFeatures(treeA, treeB, embeddingA, embeddingB, featuresA,
+                       featuresB);
+  std::vector<T> relabelCosts =
+      createRelabelCosts(featuresA, featuresB, similarityType);
+
+  std::vector<T> deleteCosts(treeA.nodes.size(), indelCost);
+  std::vector<T> insertCosts(treeB.nodes.size(), indelCost);
+  return alignTrees(treeA, treeB, relabelCosts, deleteCosts, insertCosts)
+      .matching;
+}
+
+// Explicit instantiations for type to use.
+template TreeAlignmentResult<float> alignTrees<float>(
+    const TreeWrapper<float>& treeA, const TreeWrapper<float>& treeB,
+    const std::vector<float>& relabelCosts,
+    const std::vector<float>& deleteCosts,
+    const std::vector<float>& insertCosts);
+
+template std::vector<float> createRelabelCosts<float>(
+    const std::vector<std::vector<float>>& featuresA,
+    const std::vector<std::vector<float>>& featuresB,
+    const std::string& similarityType);
+
+template std::vector<int> matchTreesAlignment<float>(
+    const TreeWrapper<float>& treeA, const TreeWrapper<float>& treeB,
+    const std::string& similarityType, float indelCost);
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "TreeNode.hpp"
+
+template <typename T>
+struct TreeAlignmentResult {
+  // Total cost of the alignment.
+  T cost = 0;
+  // matching[i] is the node of treeB aligned with node i of treeA or -1.
+  std::vector<int> matching;
+};
+
+// Ordered top-down alignment of two trees by dynamic programming. The roots
+// are aligned with each other, and the children of two aligned nodes are
+// aligned as ordered sequences: a child is either aligned with a child of the
+// other node, or its whole subtree is deleted (treeA) or inserted (treeB). The
+// order of the children is taken as is, so both trees should be sorted with
+// sortTree, which gives them a canonical angular order.
+//
+// relabelCosts[i * numB + j] is the cost of aligning node i of treeA with
+// node j of treeB, deleteCosts[i] the cost of leaving node i of treeA
+// unaligned and insertCosts[j] the cost of leaving node j of treeB unaligned.
+// The memoization tables are flat arrays of numA * numB entries, time and
+// memory are O(numA * numB).
+template <typename T>
+TreeAlignmentResult<T> alignTrees(const TreeWrapper<T>& treeA,
+                                  const TreeWrapper<T>& treeB,
+                                  const std::vector<T>& relabelCosts,
+                                  const std::vector<T>& deleteCosts,
+                                  const std::vector<T>& insertCosts);
+
+// relabelCosts for alignTrees from the node feature vectors of both trees:
+// 1 - cosine similarity for "cosine", the Euclidean distance for "euclidean".
+template <typename T>
+std::vector<T> createRelabelCosts(
+    const std::vector<std::vector<T>>& featuresA,
+    const std::vector<std::vector<T>>& featuresB,
+    const std::string& similarityType = "cosine");
+
+// Structure-preserving alternative to matchTrees: the trees are aligned by
+// alignTrees with relabel costs from the feature vectors matchTrees uses and
+// indelCost for every unaligned node. The result has the format of
+// matchTrees; if node i is matched to node j, the parent of i is matched to
+// the parent of j. The trees are not modified.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+std::vector<int> matchTreesAlignment(
+    const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB,
+    const std::string& similarityType = "cosine", T indelCost = 1);
@@ -0,0 +1,230 @@
+#include "TreeGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Level of every node of tree, nodes not reachable from the root are -1.
+template <typename T>
+static std::vector<int> computeLevels(const TreeWrapper<T>& tree) {
+  std::vector<int> levels(tree.nodes.size(), -1);
+  if (tree.nodes.empty()) return levels;
+  std::vector<int> queue(1, 0);
+  levels[0] = 0;
+  for (size_t q = 0; q < queue.size(); q++) {
+    for (int child : tree.nodes[queue[q]].children) {
+      levels[child] = levels[queue[q]] + 1;
+      queue.push_back(child);
+    }
+  }
+  return levels;
+}
+
+template <typename T>
+void updateNodeAttributes(TreeWrapper<T>& tree) {
+  std::vector<int> levels = computeLevels(tree);
+  for (size_t i = 0; i < tree.nodes.size(); i++) {
+    TreeNode<T>& node = tree.nodes[i];
+    node.offset = std::sqrt(node.posX * node.posX + node.posY * node.posY);
+    node.angle = node.offset == 0 ? 0 : std::atan2(node.posY, node.posX);
+    // Same types as the test trees: 0 for the root, then alternating.
+    node.type = i == 0 ? 0 : (levels[i] % 2 != 0 ? 1 : 2);
+  }
+}
+
+template <typename T>
+TreeGenerator<T>::TreeGenerator(const TreeGeneratorOptions& options)
+    : options_(options), rng_(options.seed) {}
+
+template <typename T>
+double TreeGenerator<T>::uniform(double minValue, double maxValue) {
+  // 32 random bits scaled to [0, 1), exact in double.
+  double unit = rng_() * (1.0 / 4294967296.0);
+  return minValue + unit * (maxValue - minValue);
+}
+
+template <typename T>
+int TreeGenerator<T>::uniformInt(int minValue, int maxValue) {
+  if (maxValue <= minValue) return minValue;
+  uint64_t range = uint64_t(maxValue - minValue) + 1;
+  // Multiply-shift maps the 32 random bits onto the range, the bias is
+  // negligible for the small ranges used here.
+  return minValue + static_cast<int>((uint64_t(rng_()) * range) >> 32);
+}
+
+template <typename T>
+int TreeGenerator<T>::drawCount(double rate, int numElements) {
+  double expected = rate * numElements;
+  int count = static_cast<int>(std::floor(expected));
+  if (uniform(0, 1) < expected - count) count++;
+  return count;
+}
+
+template <typename T>
+TreeWrapper<T> TreeGenerator<T>::generateTree() {
+  TreeWrapper<T> tree;
+  tree.timestamp = options_.firstTimestamp;
+  int numNodes = std::max(options_.numNodes, 1);
+  tree.nodes.resize(1);
+  std::vector<int> levels(1, 0);
+
+  // Expand the nodes breadth first. Without room left in the tree, because
+  // of minBranching 0, single leaves are added to random nodes above
+  // maxDepth.
+  size_t next = 0;
+  while (static_cast<int>(tree.nodes.size()) < numNodes) {
+    int parent;
+    int numChildren;
+    if (next < tree.nodes.size()) {
+      parent = next++;
+      if (levels[parent] >= options_.maxDepth) continue;
+      numChildren =
+          uniformInt(options_.minBranching, options_.maxBranching);
+    } else {
+      std::vector<int> expandable;
+      for (size_t i = 0; i < tree.nodes.size(); i++) {
+        if (levels[i] < options_.maxDepth) expandable.push_back(i);
+      }
+      if (expandable.empty()) break;
+      parent = expandable[uniformInt(0, expandable.size() - 1)];
+      numChildren = 1;
+    }
+    numChildren = std::min<int>(numChildren, numNodes - tree.nodes.size());
+    for (int c = 0; c < numChildren; c++) {
+      int child = tree.nodes.size();
+      tree.nodes.emplace_back();
+      tree.nodes[child].parent = parent;
+      tree.nodes[parent].children.push_back(child);
+      levels.push_back(levels[parent] + 1);
+    }
+  }
+
+  // Parents precede their children, so positions are set in index order.
+  for (TreeNode<T>& node : tree.nodes) {
+    int numChildren = node.children.size();
+    if (numChildren == 0) continue;
+    double spacing =
+        uniform(options_.minChildSpacing, options_.maxChildSpacing);
+    double startX = node.posX - spacing * (numChildren - 1) / 2;
+    for (int c = 0; c < numChildren; c++) {
+      TreeNode<T>& child = tree.nodes[node.children[c]];
+      child.posX = startX + c * spacing;
+      child.posY = node.posY + uniform(options_.minLevelDistance,
+                                       options_.maxLevelDistance);
+    }
+  }
+  updateNodeAttributes(tree);
+  return tree;
+}
+
+template <typename T>
+TreeWrapper<T> TreeGenerator<T>::jitterTree(const TreeWrapper<T>& tree) {
+  TreeWrapper<T> jittered = tree;
+  const double deg2rad = M_PI / 180.0;
+  for (size_t i = 0; i < jittered.nodes.size(); i++) {
+    TreeNode<T>& node = jittered.nodes[i];
+    if (node.parent < 0) {
+      node.posX = 0;
+      node.posY = 0;
+      continue;
+    }
+    // Jitter relative to the edge to the parent, as in the input tree.
+    const TreeNode<T>& original = tree.nodes[i];
+    const TreeNode<T>& parent = tree.nodes[original.parent];
+    double vecX = original.posX - parent.posX;
+    double vecY = original.posY - parent.posY;
+    double distance = std::sqrt(vecX * vecX + vecY * vecY) *
+                      uniform(-options_.jitterScale, options_.jitterScale);
+    double angle = std::atan2(vecY, vecX) +
+                   uniform(-options_.angleJitterDegrees,
+                           options_.angleJitterDegrees) *
+                       deg2rad;
+    node.posX = original.posX + distance * std::cos(angle);
+    node.posY = original.posY + distance * std::sin(angle);
+  }
+  updateNodeAttributes(jittered);
+  return jittered;
+}
+
+template <typename T>
+void TreeGenerator<T>::insertAndDeleteNodes(TreeWrapper<T>& tree) {
+  if (tree.nodes.empty()) return;
+
+  // Both counts refer to the size before the frame, so equal rates keep the
+  // expected size.
+  int numDeletions = drawCount(options_.deletionRate, tree.nodes.size());
+  int numInsertions = drawCount(options_.insertionRate, tree.nodes.size());
+
+  // Delete leaves, never the root.
+  std::vector<char> deleted(tree.nodes.size(), 0);
+  for (int d = 0; d < numDeletions; d++) {
+    std::vector<int> leaves;
+    for (size_t i = 1; i < tree.nodes.size(); i++) {
+      if (!deleted[i] && tree.nodes[i].children.empty()) leaves.push_back(i);
+    }
+    if (leaves.empty()) break;
+    int leaf = leaves[uniformInt(0, leaves.size() - 1)];
+    deleted[leaf] = 1;
+    std::vector<int>& siblings = tree.nodes[tree.nodes[leaf].parent].children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), leaf));
+  }
+  if (numDeletions > 0) {
+    std::vector<int> newIndex(tree.nodes.size(), -1);
+    int numKept = 0;
+    for (size_t i = 0; i < tree.nodes.size(); i++) {
+      if (!deleted[i]) newIndex[i] = numKept++;
+    }
+    for (size_t i = 0; i < tree.nodes.size(); i++) {
+      if (deleted[i]) continue;
+      TreeNode<T>& node = tree.nodes[i];
+      if (node.parent >= 0) node.parent = newIndex[node.parent];
+      for (int& child : node.children) child = newIndex[child];
+      if (newIndex[i] != static_cast<int>(i)) {
+        tree.nodes[newIndex[i]] = std::move(node);
+      }
+    }
+    tree.nodes.resize(numKept);
+  }
+
+  // Insert leaves below random nodes above maxDepth.
+  std::vector<int> levels = computeLevels(tree);
+  for (int n = 0; n < numInsertions; n++) {
+    std::vector<int> expandable;
+    for (size_t i = 0; i < tree.nodes.size(); i++) {
+      if (levels[i] >= 0 && levels[i] < options_.maxDepth) {
+        expandable.push_back(i);
+      }
+    }
+    if (expandable.empty()) break;
+    int parent = expandable[uniformInt(0, expandable.size() - 1)];
+    int child = tree.nodes.size();
+    tree.nodes.emplace_back();
+    TreeNode<T>& node = tree.nodes[child];
+    node.parent = parent;
+    node.posX = tree.nodes[parent].posX +
+                uniform(-options_.maxChildSpacing, options_.maxChildSpacing);
+    node.posY = tree.nodes[parent].posY + uniform(options_.minLevelDistance,
+                                                  options_.maxLevelDistance);
+    tree.nodes[parent].children.push_back(child);
+    levels.push_back(levels[parent] + 1);
+  }
+  updateNodeAttributes(tree);
+}
+
+template <typename T>
+std::list<TreeWrapper<T>> TreeGenerator<T>::generateSequence(int numFrames) {
+  std::list<TreeWrapper<T>> frames;
+  TreeWrapper<T> tree = generateTree();
+  for (int f = 0; f < numFrames; f++) {
+    if (f > 0) insertAndDeleteNodes(tree);
+    frames.push_back(jitterTree(tree));
+    frames.back().timestamp =
+        options_.firstTimestamp + f * options_.frameInterval;
+  }
+  return frames;
+}
+
+// Explicit instantiations for type to use.
+template void updateNodeAttributes<float>(TreeWrapper<float>& tree);
+
+template class TreeGenerator<float>;
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <random>
+
+#include "TreeNode.hpp"
+
+// Options of TreeGenerator. Positions follow the layout of the test trees:
+// children are spread horizontally around their parent and placed below it.
+struct TreeGeneratorOptions {
+  // Number of nodes of a generated tree, fewer if maxDepth does not leave
+  // room for them.
+  int numNodes = 100;
+  // Number of levels below the root.
+  int maxDepth = 8;
+  // Children per node, drawn uniformly from [minBranching, maxBranching].
+  // Nodes are expanded breadth first until numNodes nodes exist.
+  int minBranching = 1;
+  int maxBranching = 4;
+  // Horizontal distance between siblings, drawn once per parent.
+  float minChildSpacing = 4.0f;
+  float maxChildSpacing = 24.0f;
+  // Vertical distance of a child from its parent.
+  float minLevelDistance = 5.0f;
+  float maxLevelDistance = 30.0f;
+
+  // Jitter of a frame: every node but the root is moved by up to
+  // jitterScale times the distance to its parent, in a direction up to
+  // angleJitterDegrees away from the parent-to-node direction.
+  float jitterScale = 0.3f;
+  float angleJitterDegrees = 60.0f;
+  // Expected fraction of the nodes inserted as new leaves and of the leaves
+  // deleted between two frames of a sequence.
+  float insertionRate = 0.0f;
+  float deletionRate = 0.0f;
+  // Timestamp of the first frame and increment between frames.
+  uint64_t firstTimestamp = 0;
+  uint64_t frameInterval = 1;
+
+  uint32_t seed = 1;
+};
+
+// Seeded generator of synthetic trees and tree sequences for benchmarks and
+// tests. The random numbers are derived from std::mt19937 directly instead of
+// the std distributions, whose output is implementation defined, so the same
+// seed gives the same tree structure with any standard library. The node
+// angles and the jittered positions go through std::atan2, std::cos and
+// std::sin, which are not correctly rounded, so the trees are bit-identical
+// across runs only on the same platform and math library. The generated trees
+// can be saved by saveTreesToJson or saveTreesToRecording.
+template <typename T>
+class TreeGenerator {
+ public:
+  explicit TreeGenerator(
+      const TreeGeneratorOptions& options = TreeGeneratorOptions());
+
+  // New random tree, nodes numbered in breadth first order.
+  TreeWrapper<T> generateTree();
+
+  // tree as observed in another frame: positions jittered, root fixed at
+  // the origin.
+  TreeWrapper<T> jitterTree(const TreeWrapper<T>& tree);
+
+  // Insert and delete leaves of tree according to the insertion and deletion
+  // rates. Deleting nodes renumbers the nodes after them.
+  void insertAndDeleteNodes(TreeWrapper<T>& tree);
+
+  // numFrames frames of one tree evolving by insertAndDeleteNodes, each
+  // frame jittered independently.
+  std::list<TreeWrapper<T>> generateSequence(int numFrames);
+
+ private:
+  // Uniform in [minValue, maxValue).
+  double uniform(double minValue, double maxValue);
+  // Uniform in [minValue, maxValue].
+  int uniformInt(int minValue, int maxValue);
+  // Number of events of rate per element, rounded stochastically so that
+  // the expected number is rate * numElements.
+  int drawCount(double rate, int numElements);
+
+  TreeGeneratorOptions options_;
+  std::mt19937 rng_;
+};
+
+// Set offset, angle and type of every node from its position and level.
+template <typename T>
+void updateNodeAttributes(TreeWrapper<T>& tree);
@@ -1,7 +1,10 @@
 #include "TreeLoader.hpp"
 
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::ordered_json;
@@ -43,7 +46,14 @@ void from_json(const json& j, TreeWrapper<T>& tree) {
 //------------------------------------------------------------------------------
 // Save a single tree (wrapped in TreeWrapper) to a JSON file.
 template <typename T>
-bool saveTreeToJson(const TreeWrapper<T>& tree, const std::string& filename) {
+bool saveTreeToJson(const TreeWrapper<T>& tree, const std::string& filename,
+                    bool compact) {
+  if (compact) {
+    std::ofstream outFile(filename);
+    if (!outFile) return false;
+    return writeTreeToJson(outFile, tree);
+  }
+
   try {
     json j = tree;  // Automatically converts TreeWrapper<T> to JSON.
 
@@ -80,7 +90,16 @@ bool loadTreeFromJson(TreeWrapper<T>& tree, const std::string& filename) {
 // Save multiple trees (wrapped in TreeWrapper) to a JSON file.
 template <typename T>
 bool saveTreesToJson(const std::list<TreeWrapper<T>>& trees,
-                     const std::string& filename) {
+                     const std::string& filename, bool compact) {
+  if (compact) {
+    TreeJsonWriter<T> writer;
+    if (!writer.open(filename)) return false;
+    for (const auto& tree : trees) {
+      if (!writer.write(tree)) return false;
+    }
+    return writer.close();
+  }
+
   try {
     json j;
     j["trees"] = json::array();
@@ -114,7 +133,7 @@ bool loadTreesFromJson(std::list<TreeWrapper<T>>& trees,
     if (j.contains("trees") && j["trees"].is_array()) {
       for (const auto& treeJson : j["trees"]) {
         TreeWrapper<T> tree = treeJson.get<TreeWrapper<T>>();
-        trees.push_back(tree);
+        trees.push_back(std::move(tree));
       }
       return true;  // Success
     }
@@ -124,13 +143,149 @@ bool loadTreesFromJson(std::list<TreeWrapper<T>>& trees,
   }
 }
 
+//------------------------------------------------------------------------------
+// Write a floating point value as a json number. Non-finite values are written
+// as null, same as nlohmann::json does.
+template <typename T>
+void writeJsonNumber(std::ostream& os, T value, int precision) {
+  if (!std::isfinite(value)) {
+    os << "null";
+    return;
+  }
+  if (precision < 0) precision = std::numeric_limits<T>::max_digits10;
+  char buf[64];
+  int len = std::snprintf(buf, sizeof(buf), "%.*g", precision,
+                          static_cast<double>(value));
+  os.write(buf, len);
+}
+
+//------------------------------------------------------------------------------
+// Write a single tree as compact json with the same keys as to_json.
+template <typename T>
+bool writeTreeToJson(std::ostream& os, const TreeWrapper<T>& tree,
+                     int precision) {
+  os << "{\"timestamp\":" << tree.timestamp << ",\"nodes\":[";
+  for (size_t i = 0; i < tree.nodes.size(); ++i) {
+    const TreeNode<T>& node = tree.nodes[i];
+    if (i > 0) os << ',';
+    os << "{\"posX\":";
+    writeJsonNumber(os, node.posX, precision);
+    os << ",\"posY\":";
+    writeJsonNumber(os, node.posY, precision);
+    os << ",\"offset\":";
+    writeJsonNumber(os, node.offset, precision);
+    os << ",\"angle\":";
+    writeJsonNumber(os, node.angle, precision);
+    os << ",\"type\":" << node.type << ",\"children\":[";
+    for (size_t k = 0; k < node.children.size(); ++k) {
+      if (k > 0) os << ',';
+      os << node.children[k];
+    }
+    os << "],\"parent\":" << node.parent << '}';
+  }
+  os << "]}";
+  return static_cast<bool>(os);
+}
+
+//------------------------------------------------------------------------------
+// TreeJsonWriter writes {"trees":[ on open, one tree per line on write, and
+// closes the array and the object on close.
+template <typename T>
+TreeJsonWriter<T>::TreeJsonWriter(int precision, size_t bufferSize)
+    : buffer_(bufferSize), precision_(precision) {}
+
+template <typename T>
+TreeJsonWriter<T>::~TreeJsonWriter() {
+  close();
+}
+
+template <typename T>
+bool TreeJsonWriter<T>::open(const std::string& filename) {
+  if (isOpen()) close();
+
+  // The buffer must be installed before the file is opened to take effect.
+  if (!buffer_.empty()) {
+    outFile_.rdbuf()->pubsetbuf(buffer_.data(), buffer_.size());
+  }
+  outFile_.open(filename);
+  if (!outFile_) return false;
+
+  numTrees_ = 0;
+  outFile_ << "{\"trees\":[";
+  return static_cast<bool>(outFile_);
+}
+
+template <typename T>
+bool TreeJsonWriter<T>::write(const TreeWrapper<T>& tree) {
+  if (!isOpen()) return false;
+  outFile_ << (numTrees_ == 0 ? "\n" : ",\n");
+  if (!writeTreeToJson(outFile_, tree, precision_)) return false;
+  numTrees_++;
+  return true;
+}
+
+template <typename T>
+bool TreeJsonWriter<T>::close() {
+  if (!isOpen()) return false;
+  outFile_ << "\n]}\n";
+  bool ok = static_cast<bool>(outFile_);
+  outFile_.close();
+  return ok && !outFile_.fail();
+}
+
+//------------------------------------------------------------------------------
+// Save multiple trees (wrapped in TreeWrapper) to a binary recording.
+template <typename T>
+bool saveTreesToRecording(const std::list<TreeWrapper<T>>& trees,
+                          const std::string& filename,
+                          const TreeRecordingOptions& options) {
+  TreeRecordingWriter<T> writer(options);
+  if (!writer.open(filename)) return false;
+  for (const auto& tree : trees) {
+    if (!writer.write(tree)) return false;
+  }
+  return writer.close();
+}
+
+//------------------------------------------------------------------------------
+// Load multiple trees (wrapped in TreeWrapper) from a binary recording.
+template <typename T>
+bool loadTreesFromRecording(std::list<TreeWrapper<T>>& trees,
+                            const std::string& filename) {
+  TreeRecordingReader<T> reader;
+  if (!reader.open(filename)) return false;
+  return reader.readAll(trees);
+}
+
+//------------------------------------------------------------------------------
+// Load a single tree (wrapped in TreeWrapper) from a binary recording.
+template <typename T>
+bool loadTreeFromRecording(TreeWrapper<T>& tree, const std::string& filename,
+                           uint64_t timestamp) {
+  TreeRecordingReader<T> reader;
+  if (!reader.open(filename)) return false;
+  return reader.seek(timestamp, tree);
+}
+
 //------------------------------------------------------------------------------
 // Explicit instantiations for type float.
 template bool saveTreeToJson<float>(const TreeWrapper<float>& tree,
-                                    const std::string& filename);
+                                    const std::string& filename, bool compact);
 template bool loadTreeFromJson<float>(TreeWrapper<float>& tree,
                                       const std::string& filename);
 template bool saveTreesToJson<float>(const std::list<TreeWrapper<float>>& trees,
-                                     const std::string& filename);
+                                     const std::string& filename, bool compact);
 template bool loadTreesFromJson<float>(std::list<TreeWrapper<float>>& trees,
                                        const std::string& filename);
+template bool writeTreeToJson<float>(std::ostream& os,
+                                     const TreeWrapper<float>& tree,
+                                     int precision);
+template class TreeJsonWriter<float>;
+template bool saveTreesToRecording<float>(
+    const std::list<TreeWrapper<float>>& trees, const std::string& filename,
+    const TreeRecordingOptions& options);
+template bool loadTreesFromRecording<float>(
+    std::list<TreeWrapper<float>>& trees, const std::string& filename);
+template bool loadTreeFromRecording<float>(TreeWrapper<float>& tree,
+                                           const std::string& filename,
+                                           uint64_t timestamp);
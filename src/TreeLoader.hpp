@@ -1,18 +1,79 @@
+#pragma once
+
+#include <fstream>
 #include <list>
+#include <ostream>
 #include <string>
+#include <vector>
 
 #include "TreeNode.hpp"
+#include "TreeRecording.hpp"
 
+// compact: write json without indentation and line breaks. The compact output
+// is streamed directly to the file without building a json document first.
 template <typename T>
-bool saveTreeToJson(const TreeWrapper<T>& tree, const std::string& filename);
+bool saveTreeToJson(const TreeWrapper<T>& tree, const std::string& filename,
+                    bool compact = false);
 
 template <typename T>
 bool loadTreeFromJson(TreeWrapper<T>& tree, const std::string& filename);
 
+// compact: see saveTreeToJson.
 template <typename T>
 bool saveTreesToJson(const std::list<TreeWrapper<T>>& trees,
-                     const std::string& filename);
+                     const std::string& filename, bool compact = false);
 
 template <typename T>
 bool loadTreesFromJson(std::list<TreeWrapper<T>>& trees,
-                       const std::string& filename);
\ No newline at end of file
+                       const std::string& filename);
+
+// Save trees to a compressed binary recording, see TreeRecording.hpp.
+template <typename T>
+bool saveTreesToRecording(
+    const std::list<TreeWrapper<T>>& trees, const std::string& filename,
+    const TreeRecordingOptions& options = TreeRecordingOptions());
+
+template <typename T>
+bool loadTreesFromRecording(std::list<TreeWrapper<T>>& trees,
+                            const std::string& filename);
+
+// Load the first tree of the recording whose timestamp is not less than
+// timestamp, only the block containing the tree is decoded.
+template <typename T>
+bool loadTreeFromRecording(TreeWrapper<T>& tree, const std::string& filename,
+                           uint64_t timestamp);
+
+// Serialize a single tree as compact json directly to the output stream.
+// precision: significant digits of floating point values, a negative value
+// keeps enough digits to round-trip the value exactly.
+template <typename T>
+bool writeTreeToJson(std::ostream& os, const TreeWrapper<T>& tree,
+                     int precision = -1);
+
+// Writer that records trees one by one into a json file readable by
+// loadTreesFromJson, e.g. while trees are produced by a live run. Each tree is
+// serialized directly to a buffered file stream as soon as it is written, so
+// neither a json document nor the list of trees is kept in memory.
+template <typename T>
+class TreeJsonWriter {
+ public:
+  explicit TreeJsonWriter(int precision = -1, size_t bufferSize = 1 << 16);
+  ~TreeJsonWriter();
+
+  TreeJsonWriter(const TreeJsonWriter&) = delete;
+  TreeJsonWriter& operator=(const TreeJsonWriter&) = delete;
+
+  bool open(const std::string& filename);
+  bool write(const TreeWrapper<T>& tree);
+  // Terminate the json document and close the file.
+  bool close();
+
+  bool isOpen() const { return outFile_.is_open(); }
+  size_t numTrees() const { return numTrees_; }
+
+ private:
+  std::ofstream outFile_;
+  std::vector<char> buffer_;
+  int precision_ = -1;
+  size_t numTrees_ = 0;
+};
@@ -0,0 +1,110 @@
+#include "TreeMatcher.hpp"
+
+#include <cstring>
+#include <iterator>
+
+#include "FnvHash.hpp"
+#include "HungarianAlgorithm.hpp"
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Add the bytes of value to hash.
+template <typename V>
+static void hashValue(uint64_t& hash, V value) {
+  hashBytes(hash, &value, sizeof(value));
+}
+
+template <typename T>
+uint64_t hashTree(const TreeWrapper<T>& tree) {
+  uint64_t hash = kFnvOffsetBasis;
+  hashValue(hash, tree.timestamp);
+  hashValue(hash, tree.nodes.size());
+  for (const TreeNode<T>& node : tree.nodes) {
+    hashValue(hash, node.posX);
+    hashValue(hash, node.posY);
+    hashValue(hash, node.offset);
+    hashValue(hash, node.angle);
+    hashValue(hash, node.type);
+    hashValue(hash, node.parent);
+    hashValue(hash, node.children.size());
+    hashBytes(hash, node.children.data(), node.children.size() * sizeof(int));
+  }
+  return hash;
+}
+
+template <typename T>
+TreeMatcher<T>::TreeMatcher(const std::string& similarityType,
+                            size_t cacheCapacity,
+                            FeatureNormalizer<T>* normalizer)
+    : costMatrix_(similarityType),
+      cacheCapacity_(cacheCapacity < 2 ? 2 : cacheCapacity),
+      normalizer_(normalizer) {}
+
+template <typename T>
+const typename TreeMatcher<T>::Embedding& TreeMatcher<T>::embed(
+    const TreeWrapper<T>& tree) {
+  uint64_t key = hashTree(tree);
+
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    // Move the entry to the front of the LRU list.
+    entries_.splice(entries_.begin(), entries_, it->second);
+    const CacheEntry& entry = entries_.front();
+    if (entry.timestamp == tree.timestamp &&
+        entry.numNodes == tree.nodes.size()) {
+      cacheHits_++;
+      return entry.embedding;
+    }
+    // A different tree with the same hash, its entry is overwritten below.
+  } else if (entries_.size() >= cacheCapacity_) {
+    // Recycle the least recently used entry to keep its buffers.
+    index_.erase(entries_.back().key);
+    entries_.splice(entries_.begin(), entries_, std::prev(entries_.end()));
+  } else {
+    entries_.emplace_front();
+  }
+  cacheMisses_++;
+
+  CacheEntry& entry = entries_.front();
+  entry.key = key;
+  entry.timestamp = tree.timestamp;
+  entry.numNodes = tree.nodes.size();
+  index_[key] = entries_.begin();
+
+  Embedding& embedding = entry.embedding;
+  generateTreePreservingEmbedding(tree, embedding.tpe);
+  if (normalizer_ != nullptr) {
+    normalizer_->generateFeatureVectors(tree, embedding.tpe,
+                                        embedding.features);
+  } else {
+    embedding.features = generateFeatureVectors(tree, embedding.tpe);
+  }
+  return embedding;
+}
+
+template <typename T>
+std::vector<int> TreeMatcher<T>::match(const TreeWrapper<T>& treeA,
+                                       const TreeWrapper<T>& treeB) {
+  // Embedding treeB may evict treeA's entry only if the capacity is 1, which
+  // the constructor prevents.
+  const Embedding& embeddingA = embed(treeA);
+  const Embedding& embeddingB = embed(treeB);
+  costMatrix_.setRows(embeddingA.features);
+  costMatrix_.setColumns(embeddingB.features);
+  // Consecutive frames mostly give diagonal dominant cost matrices, which
+  // the fast path solves without the full solver.
+  return hungarianAlgorithmFastPath(costMatrix_.costMatrix(), arena_,
+                                    &fastPathStats_)
+      .second;
+}
+
+template <typename T>
+void TreeMatcher<T>::clearCache() {
+  entries_.clear();
+  index_.clear();
+}
+
+// Explicit instantiations for type to use.
+template uint64_t hashTree<float>(const TreeWrapper<float>& tree);
+
+template class TreeMatcher<float>;
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FeatureNormalizer.hpp"
+#include "FrameArena.hpp"
+#include "HungarianAlgorithm.hpp"
+#include "IncrementalCostMatrix.hpp"
+#include "TreeNode.hpp"
+
+// Hash of the timestamp and of the content of a tree, TPE fields are ignored.
+template <typename T>
+uint64_t hashTree(const TreeWrapper<T>& tree);
+
+// Matches trees like matchTrees, but keeps the TPE and the feature vectors of
+// the most recently matched trees in a LRU cache keyed on the tree hash. In a
+// tracking loop each tree is matched twice, as treeB at frame t and as treeA
+// at frame t + 1, and is embedded only once. The cost matrix is kept between
+// calls, only the rows and columns whose feature vectors changed since the
+// previous match are recomputed. The input trees are not modified.
+template <typename T>
+class TreeMatcher {
+ public:
+  struct Embedding {
+    // TPE of the tree, kept beside it instead of in a copy of the tree.
+    TreeEmbedding<T> tpe;
+    std::vector<std::vector<T>> features;
+  };
+
+  // similarityType: "cosine" or "euclidean"
+  // cacheCapacity: maximum number of cached trees.
+  // normalizer: optional normalizer shared across frames, by default every
+  // tree is normalized by its own bounds like matchTrees does. Cached feature
+  // vectors keep the normalization of the time they were generated.
+  explicit TreeMatcher(const std::string& similarityType = "cosine",
+                       size_t cacheCapacity = 4,
+                       FeatureNormalizer<T>* normalizer = nullptr);
+
+  std::vector<int> match(const TreeWrapper<T>& treeA,
+                         const TreeWrapper<T>& treeB);
+
+  // Embedding of tree, generated on a cache miss. The reference stays valid
+  // until the entry is evicted.
+  const Embedding& embed(const TreeWrapper<T>& tree);
+
+  void clearCache();
+
+  size_t cacheHits() const { return cacheHits_; }
+  size_t cacheMisses() const { return cacheMisses_; }
+  // Solves of match that the greedy fast path alone was optimal for.
+  const FastPathStats& fastPathStats() const { return fastPathStats_; }
+
+ private:
+  struct CacheEntry {
+    uint64_t key = 0;
+    // Checked on a hit, so that a hash collision is taken as a miss.
+    uint64_t timestamp = 0;
+    size_t numNodes = 0;
+    Embedding embedding;
+  };
+
+  IncrementalCostMatrix<T> costMatrix_;
+  // Scratch memory of the solver, reused by every match.
+  FrameArena arena_;
+  size_t cacheCapacity_;
+  FeatureNormalizer<T>* normalizer_;
+  // Most recently used entry first.
+  std::list<CacheEntry> entries_;
+  std::unordered_map<uint64_t, typename std::list<CacheEntry>::iterator>
+      index_;
+  size_t cacheHits_ = 0;
+  size_t cacheMisses_ = 0;
+  FastPathStats fastPathStats_;
+};
@@ -4,10 +4,10 @@
 #include <cmath>
 #include <iostream>
 #include <limits>
-#include <queue>
 #include <utility>
 
 #include "HungarianAlgorithm.hpp"
+#include "SparseAssignment.hpp"
 #include "TreePreservingEmbedding.hpp"
 
 template <typename T>
@@ -20,6 +20,12 @@ void clockwiseRotate90Degrees(TreeWrapper<T>& tree) {
   });
 }
 
+template <typename T>
+TreeWrapper<T> clockwiseRotate90Degrees(TreeWrapper<T>&& tree) {
+  clockwiseRotate90Degrees(tree);
+  return std::move(tree);
+}
+
 // Compute angle of the vector from (x1, y1) to (x2, y2), and normalize the
 // angle to range [-90, 270].
 template <typename T>
@@ -30,56 +36,36 @@ T computeAngle(T x1, T y1, T x2, T y2) {
   return angle;
 }
 
-/*
- * This function builds a new tree (sortedTree) from the original tree such
- * that:
- * 1. For each node in the original tree, its children are re-ordered by the
- * angle (computed from parent's (posX,posY) to child's (posX,posY)) in
- * ascending order.
- * 2. Each node in sortedTree has its parent and children fields updated so that
- *    they refer to indices within sortedTree.
- * 3. The vector sortedIndices holds the mapping of new indices to original
- * indices. That is, sortedTree[newIdx] originally came from tree[
- * sortedIndices[newIdx]].
- *
- * The algorithm uses a breadth-first traversal. We also maintain an auxiliary
- * vector (oldToNew) mapping each original index to its new index in sortedTree.
- */
+// Compute the order of the nodes in the sorted tree: sortedIndices[newIdx] is
+// the original index of the node at newIdx and oldToNew the inverse mapping,
+// -1 for nodes not reachable from the root. The children of a node get
+// consecutive new indices in order of their angle.
 template <typename T>
-void sortTree(const TreeWrapper<T>& tree, TreeWrapper<T>& sortedTree,
-              std::vector<int>& sortedIndices) {
-  sortedTree.timestamp = tree.timestamp;
-  sortedTree.nodes.clear();
+void computeSortedOrder(const TreeWrapper<T>& tree,
+                        std::vector<int>& sortedIndices,
+                        ArenaVector<int>& oldToNew, FrameArena& arena) {
+  int numNodes = static_cast<int>(tree.nodes.size());
+  oldToNew.assign(numNodes, -1);
   sortedIndices.clear();
-  if (tree.nodes.empty()) return;
-
-  // This vector maps an original node index to its new index in sortedTree.
-  std::vector<int> oldToNew(tree.nodes.size(), -1);
-
-  // Process the root separately.
-  TreeNode<T> newRoot = tree.nodes[0];
-  newRoot.parent = -1;       // root's parent is set to -1.
-  newRoot.children.clear();  // children will be populated later.
-  sortedTree.nodes.push_back(newRoot);
-  sortedIndices.push_back(0);
+  sortedIndices.reserve(numNodes);
+  sortedIndices.push_back(0);  // assume tree[0] is the root.
   oldToNew[0] = 0;
 
-  // Queue for processing nodes in BFS order (using original indices).
-  std::queue<int> q;
-  q.push(0);  // assume tree[0] is the root.
+  // children stores pair of child index and angle of vector from parent to
+  // child, reused for all nodes.
+  ArenaVector<std::pair<int, float>> children{
+      ArenaAllocator<std::pair<int, float>>(arena)};
 
-  // Process nodes in BFS order.
-  while (!q.empty()) {
-    int curIdx = q.front();
-    q.pop();
+  // Process nodes in BFS order, sortedIndices doubles as the queue since
+  // nodes are numbered in the order they are visited.
+  for (size_t head = 0; head < sortedIndices.size(); ++head) {
+    int curIdx = sortedIndices[head];
 
     const TreeNode<T>& curNode = tree.nodes[curIdx];
     int numChildren = curNode.children.size();
     if (numChildren == 0) continue;
 
-    // children stores pair of child index and angle of vector from parent to
-    // child.
-    std::vector<std::pair<int, float>> children;
+    children.clear();
     for (int i = 0; i < numChildren; ++i) {
       int childIdx = curNode.children[i];
       const TreeNode<T>& childNode = tree.nodes[childIdx];
@@ -95,38 +81,133 @@ void sortTree(const TreeWrapper<T>& tree, TreeWrapper<T>& sortedTree,
                 return child1.second < child2.second;
               });
 
-    // Put sorted children to queue.
-    std::for_each(
-        children.begin(), children.end(),
-        [&q](const std::pair<int, float>& child) { q.push(child.first); });
+    // Number the sorted children and put them to the queue.
+    for (const std::pair<int, float>& child : children) {
+      oldToNew[child.first] = static_cast<int>(sortedIndices.size());
+      sortedIndices.push_back(child.first);
+    }
+  }
+}
 
-    // Look up the parent's index in sortedTree.
-    int curNewIdx = oldToNew[curIdx];
+// Set the children of node to their new indices, ordered like in the sorted
+// tree.
+template <typename T>
+void remapChildIndices(TreeNode<T>& node, const ArenaVector<int>& oldToNew) {
+  for (int& child : node.children) {
+    child = oldToNew[child];
+  }
+  std::sort(node.children.begin(), node.children.end());
+}
 
-    // Update sortedTree and sortedIndices.
-    for (const std::pair<int, float>& childPair : children) {
-      int childIdx = childPair.first;
-      TreeNode<T> newChild = tree.nodes[childIdx];
+// Set the parents of a sorted tree from the children of its nodes.
+template <typename T>
+void assignParentIndices(TreeWrapper<T>& sortedTree) {
+  sortedTree.nodes[0].parent = -1;  // root's parent is set to -1.
+  for (size_t i = 0; i < sortedTree.nodes.size(); ++i) {
+    for (int child : sortedTree.nodes[i].children) {
+      sortedTree.nodes[child].parent = static_cast<int>(i);
+    }
+  }
+}
 
-      // Update the parent to the parent's new index.
-      newChild.parent = curNewIdx;
-      newChild.children.clear();  // Will add its children indices later.
+/*
+ * This function builds a new tree (sortedTree) from the original tree such
+ * that:
+ * 1. For each node in the original tree, its children are re-ordered by the
+ * angle (computed from parent's (posX,posY) to child's (posX,posY)) in
+ * ascending order.
+ * 2. Each node in sortedTree has its parent and children fields updated so that
+ *    they refer to indices within sortedTree.
+ * 3. The vector sortedIndices holds the mapping of new indices to original
+ * indices. That is, sortedTree[newIdx] originally came from tree[
+ * sortedIndices[newIdx]].
+ *
+ * The algorithm uses a breadth-first traversal. We also maintain an auxiliary
+ * vector (oldToNew) mapping each original index to its new index in sortedTree.
+ */
+template <typename T>
+void sortTree(const TreeWrapper<T>& tree, TreeWrapper<T>& sortedTree,
+              std::vector<int>& sortedIndices, FrameArena& arena) {
+  sortedTree.timestamp = tree.timestamp;
+  sortedIndices.clear();
+  if (tree.nodes.empty()) {
+    sortedTree.nodes.clear();
+    return;
+  }
+  FrameArenaScope scope(arena);
+
+  ArenaVector<int> oldToNew{ArenaAllocator<int>(arena)};
+  computeSortedOrder(tree, sortedIndices, oldToNew, arena);
+
+  // Nodes of sortedTree are overwritten in place, so that they keep the
+  // capacity of their children vectors if sortedTree is reused.
+  int numSortedNodes = sortedIndices.size();
+  sortedTree.nodes.resize(numSortedNodes);
+  for (int newIdx = 0; newIdx < numSortedNodes; ++newIdx) {
+    const TreeNode<T>& node = tree.nodes[sortedIndices[newIdx]];
+    TreeNode<T>& newNode = sortedTree.nodes[newIdx];
+    assignNodeAttributes(newNode, node);
+    newNode.children.assign(node.children.begin(), node.children.end());
+    remapChildIndices(newNode, oldToNew);
+  }
+  assignParentIndices(sortedTree);
+}
+
+template <typename T>
+void sortTreeInPlace(TreeWrapper<T>& tree, std::vector<int>& sortedIndices,
+                     FrameArena& arena) {
+  sortedIndices.clear();
+  if (tree.nodes.empty()) return;
+  FrameArenaScope scope(arena);
+  int numNodes = static_cast<int>(tree.nodes.size());
+
+  ArenaVector<int> oldToNew{ArenaAllocator<int>(arena)};
+  computeSortedOrder(tree, sortedIndices, oldToNew, arena);
+  int numSortedNodes = sortedIndices.size();
+
+  // Unreachable nodes go behind the sorted ones, to be dropped at the end.
+  ArenaVector<int> newPosition(oldToNew.begin(), oldToNew.end(),
+                               ArenaAllocator<int>(arena));
+  int nextUnreachable = numSortedNodes;
+  for (int& position : newPosition) {
+    if (position < 0) position = nextUnreachable++;
+  }
 
-      // The new node's index is the current size of sortedTree.
-      int childNewIdx = static_cast<int>(sortedTree.nodes.size());
-      sortedTree.nodes.push_back(newChild);
-      sortedIndices.push_back(childIdx);
-      oldToNew[childIdx] = childNewIdx;
+  for (int oldIdx = 0; oldIdx < numNodes; ++oldIdx) {
+    if (oldToNew[oldIdx] >= 0) remapChildIndices(tree.nodes[oldIdx], oldToNew);
+  }
 
-      // Append the new child index to children vector.
-      sortedTree.nodes[curNewIdx].children.push_back(childNewIdx);
+  // Apply the permutation cycle by cycle, swapping moves the children
+  // vectors instead of copying them.
+  for (int i = 0; i < numNodes; ++i) {
+    while (newPosition[i] != i) {
+      int target = newPosition[i];
+      std::swap(tree.nodes[i], tree.nodes[target]);
+      std::swap(newPosition[i], newPosition[target]);
     }
   }
+  tree.nodes.resize(numSortedNodes);
+  assignParentIndices(tree);
+}
+
+template <typename T>
+TreeWrapper<T> sortTree(TreeWrapper<T>&& tree, std::vector<int>& sortedIndices,
+                        FrameArena& arena) {
+  sortTreeInPlace(tree, sortedIndices, arena);
+  return std::move(tree);
+}
+
+template <typename T>
+void sortTree(const TreeWrapper<T>& tree, TreeWrapper<T>& sortedTree,
+              std::vector<int>& sortedIndices) {
+  // Room for the index map and the children of one node.
+  FrameArena arena(4 * sizeof(int) * tree.nodes.size() + 256);
+  sortTree(tree, sortedTree, sortedIndices, arena);
 }
 
 template <typename T>
 void printTree(const TreeWrapper<T>& tree, const std::string& treeName) {
-  if (!kDebug) return;
+  if (!kDebug || !debugOutputEnabled()) return;
   std::cout << treeName << " at timestamp " << tree.timestamp << std::endl;
   for (size_t i = 0; i < tree.nodes.size(); ++i) {
     std::cout << "  Node " << i << ": pos=(" << tree.nodes[i].posX << ", "
@@ -141,77 +222,45 @@ void printTree(const TreeWrapper<T>& tree, const std::string& treeName) {
 // Function to generate final normalized feature vectors for each node.
 // The final feature vector is constructed as follows:
 // [TPE embedding x, TPE embedding y,
+//  normalized tpeRadius,
+//  sin(tpeAngle), cos(tpeAngle),
 //  normalized posX, normalized posY,
 //  normalized offset,
-//  sin(angle), cos(angle),
-//  one-hot encoding for type (3 dimensions)]
+//  angle / 2pi, type]
+// The normalization parameters are determined from the nodes of the tree.
 template <typename T>
 std::vector<std::vector<T>> generateFeatureVectors(const TreeWrapper<T>& tree) {
-  // Determine normalization parameters for tpeRadius.
-  T tpeRadiusMin = std::numeric_limits<T>::max();
-  T tpeRadiusMax = std::numeric_limits<T>::lowest();
-  // Determine normalization parameters for posX, posY and offset.
-  T posXMin = std::numeric_limits<T>::max();
-  T posXMax = std::numeric_limits<T>::lowest();
-  T posYMin = std::numeric_limits<T>::max();
-  T posYMax = std::numeric_limits<T>::lowest();
-  T offsetMax = 0.0;
-
+  // Determine normalization parameters for tpeRadius, posX, posY and offset.
+  FeatureBounds<T> bounds;
   for (const auto& node : tree.nodes) {
-    if (node.tpeRadius < tpeRadiusMin) tpeRadiusMin = node.tpeRadius;
-    if (node.tpeRadius > tpeRadiusMax) tpeRadiusMax = node.tpeRadius;
-
-    if (node.posX < posXMin) posXMin = node.posX;
-    if (node.posX > posXMax) posXMax = node.posX;
-    if (node.posY < posYMin) posYMin = node.posY;
-    if (node.posY > posYMax) posYMax = node.posY;
-    if (node.offset > offsetMax) offsetMax = node.offset;
+    bounds.update(node);
   }
 
   // Allocate a vector to hold the final feature vectors.
-  std::vector<std::vector<T>> finalFeatures;
-  finalFeatures.reserve(tree.nodes.size());
+  std::vector<std::vector<T>> finalFeatures(tree.nodes.size());
 
   // For each node compute the final feature vector.
-  // The order is: [TPE_x, TPE_y, norm_posX, norm_posY, norm_offset, sin(angle),
-  // cos(angle), one-hot type]
-  for (const auto& node : tree.nodes) {
-    std::vector<T> featureVector;
-
-    // Append precomputed TPE embedding.
-    featureVector.push_back(node.tpeX);
-    featureVector.push_back(node.tpeY);
-
-    // Normalize tpeRadius using min-max scaling.
-    T normRadius =
-        (tpeRadiusMax - tpeRadiusMin == 0)
-            ? 0.5
-            : (node.tpeRadius - tpeRadiusMin) / (tpeRadiusMax - tpeRadiusMin);
-    featureVector.push_back(normRadius);
-
-    // Convert tpe angle to sine and cosine components.
-    featureVector.push_back(std::sin(node.tpeAngle));
-    featureVector.push_back(std::cos(node.tpeAngle));
-
-    // Normalize original position using min-max scaling.
-    T normPosX = (posXMax - posXMin == 0)
-                     ? 0.5
-                     : (node.posX - posXMin) / (posXMax - posXMin);
-    T normPosY = (posYMax - posYMin == 0)
-                     ? 0.5
-                     : (node.posY - posYMin) / (posYMax - posYMin);
-    featureVector.push_back(normPosX);
-    featureVector.push_back(normPosY);
-
-    // Normalize offset by dividing by the maximum offset.
-    T normOffset = (offsetMax == 0) ? 0.0 : node.offset / offsetMax;
-    featureVector.push_back(normOffset);
-
-    featureVector.push_back(node.angle / (2 * M_PI));
-
-    featureVector.push_back(node.type);
-
-    finalFeatures.push_back(featureVector);
+  for (size_t i = 0; i < tree.nodes.size(); ++i) {
+    finalFeatures[i].reserve(kFeatureDimension);
+    computeFeatureVector(tree.nodes[i], bounds, finalFeatures[i]);
+  }
+
+  return finalFeatures;
+}
+
+template <typename T>
+std::vector<std::vector<T>> generateFeatureVectors(
+    const TreeWrapper<T>& tree, const TreeEmbedding<T>& embedding) {
+  FeatureBounds<T> bounds;
+  for (size_t i = 0; i < tree.nodes.size(); ++i) {
+    bounds.update(tree.nodes[i], embedding.tpeRadius[i]);
+  }
+
+  std::vector<std::vector<T>> finalFeatures(tree.nodes.size());
+  for (size_t i = 0; i < tree.nodes.size(); ++i) {
+    finalFeatures[i].reserve(kFeatureDimension);
+    computeFeatureVector(tree.nodes[i], embedding, i, bounds,
+                         finalFeatures[i]);
   }
 
   return finalFeatures;
@@ -220,7 +269,7 @@ std::vector<std::vector<T>> generateFeatureVectors(const TreeWrapper<T>& tree) {
 template <typename T>
 void printFeatureVectors(const std::vector<std::vector<T>>& featureVectors,
                          const std::string& treeName) {
-  if (!kDebug) return;
+  if (!kDebug || !debugOutputEnabled()) return;
   std::cout << "Feature vectors for Tree " << treeName << std::endl;
   for (size_t i = 0; i < featureVectors.size(); ++i) {
     std::cout << "  Node " << i + 1 << " final feature vector: ";
@@ -268,23 +317,35 @@ T computeEuclideanSimilarity(const std::vector<T>& vectorA,
 template <typename T>
 std::vector<std::vector<T>> createSimilarityMatrix(
     const std::vector<std::vector<T>>& featuresA,
-    const std::vector<std::vector<T>>& featuresB,
-    const std::string& metric = "euclidean") {
+    const std::vector<std::vector<T>>& featuresB, const std::string& metric) {
   size_t numNodesA = featuresA.size();
   size_t numNodesB = featuresB.size();
   std::vector<std::vector<T>> similarityMatrix(numNodesA,
                                                std::vector<T>(numNodesB, 0.0));
 
-  for (size_t i = 0; i < numNodesA; i++) {
+  bool euclidean = metric == "euclidean";
+  bool cosine = metric == "cosine";
+  auto fillRow = [&](size_t i) {
     for (size_t j = 0; j < numNodesB; j++) {
-      if (metric == "euclidean") {
+      if (euclidean) {
         similarityMatrix[i][j] =
             computeEuclideanSimilarity(featuresA[i], featuresB[j]);
-      } else if (metric == "cosine") {
+      } else if (cosine) {
         similarityMatrix[i][j] =
             computeCosineSimilarity(featuresA[i], featuresB[j]);
       }
     }
+  };
+
+  // Small matrices are not worth the scheduling overhead.
+  if (numNodesA * numNodesB < kParallelSimilarityCells) {
+    for (size_t i = 0; i < numNodesA; i++) {
+      fillRow(i);
+    }
+  } else {
+    size_t rowsPerTask =
+        std::max<size_t>(1, kParallelSimilarityCells / 4 / numNodesB);
+    defaultThreadPool().parallelFor(0, numNodesA, fillRow, rowsPerTask);
   }
   return similarityMatrix;
 }
@@ -292,7 +353,7 @@ std::vector<std::vector<T>> createSimilarityMatrix(
 template <typename T>
 void printSimilarityMatrix(const std::vector<std::vector<T>>& similarityMatrix,
                            const std::string& similarityType) {
-  if (!kDebug) return;
+  if (!kDebug || !debugOutputEnabled()) return;
   std::cout << "Similarity Matrix (" << similarityType << ")" << std::endl;
   for (const auto& row : similarityMatrix) {
     for (T sim : row) {
@@ -328,7 +389,7 @@ std::vector<std::vector<T>> convertSimilarityMatrix2CostMatrix(
 template <typename T>
 void printCostMatrix(const std::vector<std::vector<T>>& costMatrix,
                      const std::string& costType) {
-  if (!kDebug) return;
+  if (!kDebug || !debugOutputEnabled()) return;
   std::cout << "Cost Matrix (" << costType << ")" << std::endl;
   for (const auto& row : costMatrix) {
     for (T sim : row) {
@@ -338,25 +399,15 @@ void printCostMatrix(const std::vector<std::vector<T>>& costMatrix,
   }
 }
 
+// Solve the maximum matching between the nodes of two trees given their
+// feature vectors. arena: scratch of the solver, nullptr to allocate it per
+// call. stats: counters of the fast path, nullptr if not needed.
 template <typename T>
-std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
-                            const std::string& similarityType) {
-  // Generate TPE of treeA.
-  generateTreePreservingEmbedding(treeA);
-  printTreePreservingEmbedding(treeA, "treeA");
-
-  // Generate TPE of treeB.
-  generateTreePreservingEmbedding(treeB);
-  printTreePreservingEmbedding(treeB, "treeB");
-
-  // Generate feature vectors for treeA.
-  std::vector<std::vector<T>> featureVectorsA = generateFeatureVectors(treeA);
-  printFeatureVectors(featureVectorsA, "treeA");
-
-  // Generate feature vectors for treeB.
-  std::vector<std::vector<T>> featureVectorsB = generateFeatureVectors(treeB);
-  printFeatureVectors(featureVectorsB, "treeB");
-
+static std::vector<int> matchFeatureVectorsDense(
+    const std::vector<std::vector<T>>& featureVectorsA,
+    const std::vector<std::vector<T>>& featureVectorsB,
+    const std::string& similarityType, FrameArena* arena,
+    FastPathStats* stats) {
   std::pair<T, std::vector<int>> maxMatching;
   if (similarityType == "cosine") {
     // Calculate the similarity matrix for tree A and tree B by using cosine
@@ -372,7 +423,10 @@ std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
 
     // Run Hungarian Algorithm on the cosine cost matrix to get best maximum
     // match.
-    maxMatching = hungarianAlgorithm(costMatrixCosine);
+    maxMatching =
+        arena != nullptr
+            ? hungarianAlgorithmFastPath(costMatrixCosine, *arena, stats)
+            : hungarianAlgorithmFastPath(costMatrixCosine, stats);
   } else if (similarityType == "euclidean") {
     // Calculate the similarity matrix for tree A and tree B by using euclidean
     // similarity.
@@ -387,7 +441,10 @@ std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
 
     // Run Hungarian Algorithm on the euclidean cost matrix to get best maximum
     // match.
-    maxMatching = hungarianAlgorithm(costMatrixEuclidean);
+    maxMatching =
+        arena != nullptr
+            ? hungarianAlgorithmFastPath(costMatrixEuclidean, *arena, stats)
+            : hungarianAlgorithmFastPath(costMatrixEuclidean, stats);
   } else {
     std::cout << "unknown similarityType " << similarityType << std::endl;
     exit(1);
@@ -396,10 +453,214 @@ std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
   return maxMatching.second;
 }
 
+template <typename T>
+std::vector<int> matchFeatureVectors(
+    const std::vector<std::vector<T>>& featureVectorsA,
+    const std::vector<std::vector<T>>& featureVectorsB,
+    const std::string& similarityType) {
+  return matchFeatureVectorsDense<T>(featureVectorsA, featureVectorsB,
+                                     similarityType, nullptr, nullptr);
+}
+
+// Same as matchFeatureVectors with options. arena: scratch of the dense
+// solvers, nullptr to allocate it per call.
+template <typename T>
+static std::vector<int> matchFeatureVectorsWithOptions(
+    const std::vector<std::vector<T>>& featureVectorsA,
+    const std::vector<std::vector<T>>& featureVectorsB,
+    const TreeMatchingOptions<T>& options, FrameArena* arena) {
+  // Restricted to the nearest candidates the cost matrix stays sparse.
+  if (options.candidateK > 0 &&
+      options.candidateK < featureVectorsB.size()) {
+    CandidateGraph<T> candidates =
+        generateNearestCandidates(featureVectorsA, featureVectorsB,
+                                  options.candidateK, options.similarityType);
+    return matchCandidates(candidates, featureVectorsA, featureVectorsB,
+                           options);
+  }
+
+  // Without a threshold every node is matched as far as possible.
+  if (options.minSimilarity == -std::numeric_limits<T>::infinity()) {
+    return matchFeatureVectorsDense(featureVectorsA, featureVectorsB,
+                                    options.similarityType, arena,
+                                    options.fastPathStats);
+  }
+  if (options.similarityType != "cosine" &&
+      options.similarityType != "euclidean") {
+    std::cout << "unknown similarityType " << options.similarityType
+              << std::endl;
+    exit(1);
+  }
+
+  std::vector<std::vector<T>> similarityMatrix = createSimilarityMatrix(
+      featureVectorsA, featureVectorsB, options.similarityType);
+  printSimilarityMatrix(similarityMatrix, options.similarityType);
+
+  std::vector<std::vector<T>> costMatrix =
+      convertSimilarityMatrix2CostMatrix(similarityMatrix);
+  printCostMatrix(costMatrix, options.similarityType);
+
+  // Leaving a node unmatched costs as much as matching it to a node of
+  // minSimilarity, so no pair below minSimilarity is matched.
+  if (arena != nullptr) {
+    return hungarianAlgorithmWithUnmatched(costMatrix, -options.minSimilarity,
+                                           *arena)
+        .second;
+  }
+  return hungarianAlgorithmWithUnmatched(costMatrix, -options.minSimilarity)
+      .second;
+}
+
+template <typename T>
+std::vector<int> matchFeatureVectors(
+    const std::vector<std::vector<T>>& featureVectorsA,
+    const std::vector<std::vector<T>>& featureVectorsB,
+    const TreeMatchingOptions<T>& options) {
+  return matchFeatureVectorsWithOptions(featureVectorsA, featureVectorsB,
+                                        options, nullptr);
+}
+
+template <typename T>
+std::vector<int> matchFeatureVectors(
+    const std::vector<std::vector<T>>& featureVectorsA,
+    const std::vector<std::vector<T>>& featureVectorsB,
+    const TreeMatchingOptions<T>& options, FrameArena& arena) {
+  return matchFeatureVectorsWithOptions(featureVectorsA, featureVectorsB,
+                                        options, &arena);
+}
+
+// Generate the TPE of treeA and treeB and their feature vectors, the steps
+// that precede matching in every matchTrees overload. normalizer: shared
+// normalization of both trees, nullptr to normalize each tree by its own
+// bounds.
+template <typename T>
+static void generatePairFeatures(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+                                 FeatureNormalizer<T>* normalizer,
+                                 std::vector<std::vector<T>>& featureVectorsA,
+                                 std::vector<std::vector<T>>& featureVectorsB) {
+  // Generate TPE of treeA.
+  generateTreePreservingEmbedding(treeA);
+  printTreePreservingEmbedding(treeA, "treeA");
+
+  // Generate TPE of treeB.
+  generateTreePreservingEmbedding(treeB);
+  printTreePreservingEmbedding(treeB, "treeB");
+
+  if (normalizer != nullptr) {
+    // Both trees with the same snapshot of the shared normalization.
+    normalizer->generateFeatureVectors(treeA, treeB, featureVectorsA,
+                                       featureVectorsB);
+  } else {
+    featureVectorsA = generateFeatureVectors(treeA);
+    featureVectorsB = generateFeatureVectors(treeB);
+  }
+  printFeatureVectors(featureVectorsA, "treeA");
+  printFeatureVectors(featureVectorsB, "treeB");
+}
+
+template <typename T>
+void generatePairFeatures(const TreeWrapper<T>& treeA,
+                          const TreeWrapper<T>& treeB,
+                          TreeEmbedding<T>& embeddingA,
+                          TreeEmbedding<T>& embeddingB,
+                          std::vector<std::vector<T>>& featureVectorsA,
+                          std::vector<std::vector<T>>& featureVectorsB) {
+  generateTreePreservingEmbedding(treeA, embeddingA);
+  generateTreePreservingEmbedding(treeB, embeddingB);
+
+  featureVectorsA = generateFeatureVectors(treeA, embeddingA);
+  printFeatureVectors(featureVectorsA, "treeA");
+  featureVectorsB = generateFeatureVectors(treeB, embeddingB);
+  printFeatureVectors(featureVectorsB, "treeB");
+}
+
+template <typename T>
+std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+                            const std::string& similarityType) {
+  std::vector<std::vector<T>> featureVectorsA, featureVectorsB;
+  generatePairFeatures<T>(treeA, treeB, nullptr, featureVectorsA,
+                          featureVectorsB);
+  return matchFeatureVectors(featureVectorsA, featureVectorsB, similarityType);
+}
+
+// Same as matchTrees with options. arena: scratch of the dense solvers,
+// nullptr to allocate it per call.
+template <typename T>
+static std::vector<int> matchTreesWithOptions(
+    TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+    const TreeMatchingOptions<T>& options, FrameArena* arena) {
+  std::vector<std::vector<T>> featureVectorsA, featureVectorsB;
+  generatePairFeatures<T>(treeA, treeB, nullptr, featureVectorsA,
+                          featureVectorsB);
+
+  if (options.gatingRadius != std::numeric_limits<T>::infinity()) {
+    // The grid keeps its buckets from call to call.
+    static thread_local SpatialGrid<T> grid;
+    CandidateGraph<T> candidates = generateGatedCandidates(
+        treeA, treeB, featureVectorsA, featureVectorsB, options.gatingRadius,
+        options.candidateK, options.similarityType, grid);
+    return matchCandidates(candidates, featureVectorsA, featureVectorsB,
+                           options);
+  }
+  return matchFeatureVectorsWithOptions(featureVectorsA, featureVectorsB,
+                                        options, arena);
+}
+
+template <typename T>
+std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+                            const TreeMatchingOptions<T>& options) {
+  return matchTreesWithOptions(treeA, treeB, options, nullptr);
+}
+
+template <typename T>
+std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+                            const TreeMatchingOptions<T>& options,
+                            FrameArena& arena) {
+  return matchTreesWithOptions(treeA, treeB, options, &arena);
+}
+
+template <typename T>
+std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+                            FeatureNormalizer<T>& normalizer,
+                            const std::string& similarityType) {
+  std::vector<std::vector<T>> featureVectorsA, featureVectorsB;
+  generatePairFeatures(treeA, treeB, &normalizer, featureVectorsA,
+                       featureVectorsB);
+  return matchFeatureVectors(featureVectorsA, featureVectorsB, similarityType);
+}
+
+template <typename T>
+std::vector<int> matchTrees(const TreeWrapper<T>& treeA,
+                            const TreeWrapper<T>& treeB,
+                            TreeEmbedding<T>& embeddingA,
+                            TreeEmbedding<T>& embeddingB,
+                            const std::string& similarityType) {
+  std::vector<std::vector<T>> featureVectorsA, featureVectorsB;
+  generatePairFeatures(treeA, treeB, embeddingA, embeddingB, featureVectorsA,
+                       featureVectorsB);
+  return matchFeatureVectors(featureVectorsA, featureVectorsB, similarityType);
+}
+
+template <typename T>
+std::vector<std::vector<int>> matchTreesBatch(
+    std::vector<TreeWrapper<T>>& treesA, std::vector<TreeWrapper<T>>& treesB,
+    const std::string& similarityType, ThreadPool& pool) {
+  size_t numPairs = std::min(treesA.size(), treesB.size());
+  std::vector<std::vector<int>> matchings(numPairs);
+  pool.parallelFor(0, numPairs, [&](size_t i) {
+    // The debugging info of concurrent pairs would interleave.
+    bool debugOutput = debugOutputEnabled();
+    debugOutputEnabled() = false;
+    matchings[i] = matchTrees(treesA[i], treesB[i], similarityType);
+    debugOutputEnabled() = debugOutput;
+  });
+  return matchings;
+}
+
 void printMatching(const std::vector<int>& matchRes,
                    const std::string& treeNameA, const std::string& treeNameB,
                    uint64_t timestampA, uint64_t timestampB) {
-  if (!kDebug) return;
+  if (!kDebug || !debugOutputEnabled()) return;
   std::cout << "Maximum matching between " << treeNameA << "("
             << std::to_string(timestampA) << ") and " << treeNameB << ")"
             << std::to_string(timestampB) << "):" << std::endl;
@@ -412,18 +673,43 @@ void printMatching(const std::vector<int>& matchRes,
 
 template void clockwiseRotate90Degrees<float>(TreeWrapper<float>& tree);
 
+template TreeWrapper<float> clockwiseRotate90Degrees<float>(
+    TreeWrapper<float>&& tree);
+
 template float computeAngle<float>(float x1, float y1, float x2, float y2);
 
 template void sortTree<float>(const TreeWrapper<float>& tree,
                               TreeWrapper<float>& sortedTree,
                               std::vector<int>& sortedIndices);
 
+template void sortTree<float>(const TreeWrapper<float>& tree,
+                              TreeWrapper<float>& sortedTree,
+                              std::vector<int>& sortedIndices,
+                              FrameArena& arena);
+
+template void sortTreeInPlace<float>(TreeWrapper<float>& tree,
+                                     std::vector<int>& sortedIndices,
+                                     FrameArena& arena);
+
+template TreeWrapper<float> sortTree<float>(TreeWrapper<float>&& tree,
+                                            std::vector<int>& sortedIndices,
+                                            FrameArena& arena);
+
 template void printTree<float>(const TreeWrapper<float>& tree,
                                const std::string& treeName);
 
 template std::vector<std::vector<float>> generateFeatureVectors<float>(
     const TreeWrapper<float>& tree);
 
+template std::vector<std::vector<float>> generateFeatureVectors<float>(
+    const TreeWrapper<float>& tree, const TreeEmbedding<float>& embedding);
+
+template void generatePairFeatures<float>(
+    const TreeWrapper<float>& treeA, const TreeWrapper<float>& treeB,
+    TreeEmbedding<float>& embeddingA, TreeEmbedding<float>& embeddingB,
+    std::vector<std::vector<float>>& featureVectorsA,
+    std::vector<std::vector<float>>& featureVectorsB);
+
 template void printFeatureVectors<float>(
     const std::vector<std::vector<float>>& featureVectors,
     const std::string& treeName);
@@ -437,7 +723,7 @@ template float computeEuclideanSimilarity<float>(
 template std::vector<std::vector<float>> createSimilarityMatrix<float>(
     const std::vector<std::vector<float>>& featuresA,
     const std::vector<std::vector<float>>& featuresB,
-    const std::string& metric = "euclidean");
+    const std::string& metric);
 
 template void printSimilarityMatrix<float>(
     const std::vector<std::vector<float>>& similarityMatrix,
@@ -450,6 +736,43 @@ template void printCostMatrix<float>(
     const std::vector<std::vector<float>>& costMatrix,
     const std::string& costType);
 
+template std::vector<int> matchFeatureVectors<float>(
+    const std::vector<std::vector<float>>& featureVectorsA,
+    const std::vector<std::vector<float>>& featureVectorsB,
+    const std::string& similarityType);
+
+template std::vector<int> matchFeatureVectors<float>(
+    const std::vector<std::vector<float>>& featureVectorsA,
+    const std::vector<std::vector<float>>& featureVectorsB,
+    const TreeMatchingOptions<float>& options);
+
+template std::vector<int> matchFeatureVectors<float>(
+    const std::vector<std::vector<float>>& featureVectorsA,
+    const std::vector<std::vector<float>>& featureVectorsB,
+    const TreeMatchingOptions<float>& options, FrameArena& arena);
+
+template std::vector<int> matchTrees<float>(
+    TreeWrapper<float>& treeA, TreeWrapper<float>& treeB,
+    const TreeMatchingOptions<float>& options);
+
+template std::vector<int> matchTrees<float>(
+    TreeWrapper<float>& treeA, TreeWrapper<float>& treeB,
+    const TreeMatchingOptions<float>& options, FrameArena& arena);
+
 template std::vector<int> matchTrees<float>(TreeWrapper<float>& treeA,
                                             TreeWrapper<float>& treeB,
-                                            const std::string& similarityType);
\ No newline at end of file
+                                            const std::string& similarityType);
+
+template std::vector<int> matchTrees<float>(
+    TreeWrapper<float>& treeA, TreeWrapper<float>& treeB,
+    FeatureNormalizer<float>& normalizer, const std::string& similarityType);
+
+template std::vector<int> matchTrees<float>(
+    const TreeWrapper<float>& treeA, const TreeWrapper<float>& treeB,
+    TreeEmbedding<float>& embeddingA, TreeEmbedding<float>& embeddingB,
+    const std::string& similarityType);
+
+template std::vector<std::vector<int>> matchTreesBatch<float>(
+    std::vector<TreeWrapper<float>>& treesA,
+    std::vector<TreeWrapper<float>>& treesB, const std::string& similarityType,
+    ThreadPool& pool);
@@ -1,24 +1,193 @@
 #pragma once
 
+#include <limits>
 #include <string>
 
+#include "FeatureNormalizer.hpp"
+#include "FrameArena.hpp"
+#include "HungarianAlgorithm.hpp"
+#include "ThreadPool.hpp"
 #include "TreeNode.hpp"
 
+// Similarity matrices with at least this many cells are computed in parallel
+// on the default thread pool.
+constexpr size_t kParallelSimilarityCells = 1 << 14;
+
+// Options of matchTrees and matchFeatureVectors.
+template <typename T>
+struct TreeMatchingOptions {
+  // "cosine" or "euclidean"
+  std::string similarityType = "cosine";
+  // A node stays unmatched rather than being matched to a node less similar
+  // than minSimilarity. With -infinity as many nodes as possible are matched.
+  T minSimilarity = -std::numeric_limits<T>::infinity();
+  // Only the candidateK nodes of treeB nearest in feature space are
+  // considered for a node of treeA, which avoids the dense cost matrix on
+  // large trees. Larger values are more accurate, 0 considers all pairs.
+  size_t candidateK = 0;
+  // matchTrees only compares nodes at most gatingRadius apart by position
+  // (posX, posY), farther nodes are never matched. With candidateK set, the
+  // candidateK most similar nodes within the radius are considered.
+  T gatingRadius = std::numeric_limits<T>::infinity();
+  // If set, the counters of hungarianAlgorithmFastPath are added to it for
+  // every match solved densely, i.e. without minSimilarity, candidateK and
+  // gatingRadius, so that callers can watch the hit rate of the greedy fast
+  // path. Not synchronized, use one per thread.
+  FastPathStats* fastPathStats = nullptr;
+};
+
 template <typename T>
 void clockwiseRotate90Degrees(TreeWrapper<T>& tree);
 
+// Same as above, rotates tree in place and returns it without copying.
+template <typename T>
+TreeWrapper<T> clockwiseRotate90Degrees(TreeWrapper<T>&& tree);
+
 template <typename T>
 void sortTree(const TreeWrapper<T>& tree, TreeWrapper<T>& sorted,
               std::vector<int>& sortedIndices);
 
+// Same as above, but the scratch data of the traversal is allocated from
+// arena, which is rewound before returning.
+template <typename T>
+void sortTree(const TreeWrapper<T>& tree, TreeWrapper<T>& sorted,
+              std::vector<int>& sortedIndices, FrameArena& arena);
+
+// Sort tree in place: the nodes are moved to their sorted positions instead
+// of being copied, nodes not reachable from the root are dropped.
+template <typename T>
+void sortTreeInPlace(TreeWrapper<T>& tree, std::vector<int>& sortedIndices,
+                     FrameArena& arena);
+
+// Sort a tree that is not needed anymore and return it without copying, e.g.
+// sortTree(clockwiseRotate90Degrees(std::move(tree)), sortedIndices, arena).
+// The scratch data is allocated from the caller's arena, as for
+// sortTreeInPlace.
+template <typename T>
+TreeWrapper<T> sortTree(TreeWrapper<T>&& tree, std::vector<int>& sortedIndices,
+                        FrameArena& arena);
+
 template <typename T>
 void printTree(const TreeWrapper<T>& tree, const std::string& treeName);
 
+// Feature vectors of the nodes of a tree whose TPE has been generated,
+// normalized by the bounds of the tree.
+template <typename T>
+std::vector<std::vector<T>> generateFeatureVectors(const TreeWrapper<T>& tree);
+
+// Same as above, with the TPE of the tree kept in embedding.
+template <typename T>
+std::vector<std::vector<T>> generateFeatureVectors(
+    const TreeWrapper<T>& tree, const TreeEmbedding<T>& embedding);
+
+// Generate the TPE of treeA and treeB into embeddingA and embeddingB and the
+// feature vectors of both trees, as matchTrees does before matching. The
+// trees are not modified.
+template <typename T>
+void generatePairFeatures(const TreeWrapper<T>& treeA,
+                          const TreeWrapper<T>& treeB,
+                          TreeEmbedding<T>& embeddingA,
+                          TreeEmbedding<T>& embeddingB,
+                          std::vector<std::vector<T>>& featureVectorsA,
+                          std::vector<std::vector<T>>& featureVectorsB);
+
+// Cosine similarity of two feature vectors.
+template <typename T>
+T computeCosineSimilarity(const std::vector<T>& vectorA,
+                          const std::vector<T>& vectorB);
+
+// Negative Euclidean distance of two feature vectors.
+template <typename T>
+T computeEuclideanSimilarity(const std::vector<T>& vectorA,
+                             const std::vector<T>& vectorB);
+
+// Similarity matrix between two sets of feature vectors, rows correspond to
+// nodes of tree A and columns to nodes of tree B.
+// metric: "cosine" or "euclidean"
+template <typename T>
+std::vector<std::vector<T>> createSimilarityMatrix(
+    const std::vector<std::vector<T>>& featuresA,
+    const std::vector<std::vector<T>>& featuresB,
+    const std::string& metric = "euclidean");
+
+// cost[i][j] = -similarityMatrix[i][j]
+template <typename T>
+std::vector<std::vector<T>> convertSimilarityMatrix2CostMatrix(
+    const std::vector<std::vector<T>>& similarityMatrix);
+
+// Maximum matching between two sets of node feature vectors.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+std::vector<int> matchFeatureVectors(
+    const std::vector<std::vector<T>>& featureVectorsA,
+    const std::vector<std::vector<T>>& featureVectorsB,
+    const std::string& similarityType = "cosine");
+
+// Same as above, with the options given in options.
+template <typename T>
+std::vector<int> matchFeatureVectors(
+    const std::vector<std::vector<T>>& featureVectorsA,
+    const std::vector<std::vector<T>>& featureVectorsB,
+    const TreeMatchingOptions<T>& options);
+
+// Same as above, but the scratch of the dense solvers is allocated from
+// arena, which is rewound before returning. A caller can reuse one arena for
+// every frame, so that solving does not allocate its scratch per call.
+template <typename T>
+std::vector<int> matchFeatureVectors(
+    const std::vector<std::vector<T>>& featureVectorsA,
+    const std::vector<std::vector<T>>& featureVectorsB,
+    const TreeMatchingOptions<T>& options, FrameArena& arena);
+
 // similarityType: "cosine" or "euclidean"
 template <typename T>
 std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
                             const std::string& similarityType = "cosine");
 
+// Same as above, with the options given in options. Nodes without a
+// counterpart at least options.minSimilarity similar, or within
+// options.gatingRadius, are -1 in the result.
+template <typename T>
+std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+                            const TreeMatchingOptions<T>& options);
+
+// Same as above, with the scratch of the solver allocated from arena as for
+// matchFeatureVectors, e.g. with the arena the trees were sorted with.
+template <typename T>
+std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+                            const TreeMatchingOptions<T>& options,
+                            FrameArena& arena);
+
+// Same as above, but the feature vectors of both trees are normalized by
+// normalizer, which keeps the normalization stable over a sequence of frames.
+// Both trees are normalized with the same bounds, see
+// FeatureNormalizer::generateFeatureVectors.
+template <typename T>
+std::vector<int> matchTrees(TreeWrapper<T>& treeA, TreeWrapper<T>& treeB,
+                            FeatureNormalizer<T>& normalizer,
+                            const std::string& similarityType = "cosine");
+
+// Same as matchTrees, but the trees are not modified: their TPE is written to
+// embeddingA and embeddingB, so several threads can match against the same
+// tree.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+std::vector<int> matchTrees(const TreeWrapper<T>& treeA,
+                            const TreeWrapper<T>& treeB,
+                            TreeEmbedding<T>& embeddingA,
+                            TreeEmbedding<T>& embeddingB,
+                            const std::string& similarityType = "cosine");
+
+// Match treesA[i] with treesB[i] for every pair in parallel on pool. A tree
+// must not appear in two pairs, since matching writes its TPE. The debugging
+// info of kDebug is not printed for the pairs.
+// similarityType: "cosine" or "euclidean"
+template <typename T>
+std::vector<std::vector<int>> matchTreesBatch(
+    std::vector<TreeWrapper<T>>& treesA, std::vector<TreeWrapper<T>>& treesB,
+    const std::string& similarityType = "cosine",
+    ThreadPool& pool = defaultThreadPool());
+
 void printMatching(const std::vector<int>& matching,
                    const std::string& treeNameA, const std::string& treeNameB,
                    uint64_t timestampA = 0, uint64_t timestampB = 0);
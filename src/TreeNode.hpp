@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -11,6 +12,8 @@ struct TreeNode {
   T tpeRadius = 0.0;
   T tpeMinAngle = 0.0, tpeMaxAngle = 0.0;
   T tpeAngle = 0.0;
+  // Level of the node used by the TPE radius.
+  int tpeLevel = 0;
 
   // Original position in Cartesian coordinates.
   T posX = 0.0, posY = 0.0;
@@ -36,5 +39,73 @@ struct TreeWrapper {
   std::vector<TreeNode<T>> nodes;
 };
 
-// Toggle for debugging info output.
-constexpr bool kDebug = true;
\ No newline at end of file
+// TPE of a tree kept beside the tree instead of in its nodes, entry i belongs
+// to node i. Lets read-only trees be embedded, e.g. by several threads.
+template <typename T>
+struct TreeEmbedding {
+  std::vector<T> tpeX, tpeY;
+  std::vector<T> tpeRadius;
+  std::vector<T> tpeMinAngle, tpeMaxAngle;
+  std::vector<T> tpeAngle;
+  std::vector<int> tpeLevel;
+
+  size_t size() const { return tpeX.size(); }
+
+  // Resize to numNodes zero entries, keeping the capacity.
+  void reset(size_t numNodes) {
+    tpeX.assign(numNodes, 0);
+    tpeY.assign(numNodes, 0);
+    tpeRadius.assign(numNodes, 0);
+    tpeMinAngle.assign(numNodes, 0);
+    tpeMaxAngle.assign(numNodes, 0);
+    tpeAngle.assign(numNodes, 0);
+    tpeLevel.assign(numNodes, 0);
+  }
+};
+
+// Copy every attribute of src to dst except the children, so that dst keeps
+// the capacity of its children vector when node slots are reused.
+template <typename T>
+void assignNodeAttributes(TreeNode<T>& dst, const TreeNode<T>& src) {
+  dst.tpeX = src.tpeX;
+  dst.tpeY = src.tpeY;
+  dst.tpeRadius = src.tpeRadius;
+  dst.tpeMinAngle = src.tpeMinAngle;
+  dst.tpeMaxAngle = src.tpeMaxAngle;
+  dst.tpeAngle = src.tpeAngle;
+  dst.tpeLevel = src.tpeLevel;
+  dst.posX = src.posX;
+  dst.posY = src.posY;
+  dst.offset = src.offset;
+  dst.angle = src.angle;
+  dst.type = src.type;
+  dst.parent = src.parent;
+}
+
+// Resize tree to numNodes default nodes. Nodes already present keep the
+// capacity of their children vectors.
+template <typename T>
+void resetTreeNodes(TreeWrapper<T>& tree, size_t numNodes) {
+  tree.timestamp = 0;
+  tree.nodes.resize(numNodes);
+  const TreeNode<T> defaultNode;
+  for (TreeNode<T>& node : tree.nodes) {
+    assignNodeAttributes(node, defaultNode);
+    node.children.clear();
+  }
+}
+
+// Toggle for debugging info output, set by the TREE_MATCHING_DEBUG option of
+// the build. Benchmarks need it off.
+#ifndef TREE_MATCHING_DEBUG
+#define TREE_MATCHING_DEBUG 1
+#endif
+constexpr bool kDebug = TREE_MATCHING_DEBUG;
+
+// Whether the calling thread prints the debugging info enabled by kDebug.
+// Turned off for matching on pool threads, where the output of concurrent
+// calls would interleave.
+inline bool& debugOutputEnabled() {
+  static thread_local bool enabled = true;
+  return enabled;
+}
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include "TreePreservingEmbedding.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <limits>
 #include <queue>
+#include <utility>
 
 // Helper function to get the node level by following parent pointers.
 template <typename T>
@@ -26,6 +28,38 @@ int getTreeNodeLevel(const TreeWrapper<T>& tree, int index) {
   return level;
 }
 
+// Divide the TPE angle range of the node at parentIdx equally among its
+// children, and assign each child its tpeMinAngle, tpeMaxAngle and tpeAngle.
+template <typename T>
+void assignChildrenAngles(TreeWrapper<T>& tree, int parentIdx) {
+  const TreeNode<T>& parentNode = tree.nodes[parentIdx];
+  int numChildren = parentNode.children.size();
+
+  // Parent's allocated angle range.
+  T parentMin = parentNode.tpeMinAngle;
+  T parentMax = parentNode.tpeMaxAngle;
+  T parentRange = parentMax - parentMin;
+
+  for (int i = 0; i < numChildren; i++) {
+    TreeNode<T>& child = tree.nodes[parentNode.children[i]];
+    // Compute child's angle range.
+    child.tpeMinAngle = parentMin + (parentRange * i) / numChildren;
+    child.tpeMaxAngle = parentMin + (parentRange * (i + 1)) / numChildren;
+    // Choose the midpoint of the child's angle range as its tpeAngle.
+    child.tpeAngle = (child.tpeMinAngle + child.tpeMaxAngle) / 2.0;
+  }
+}
+
+// Set the TPE radius of a node from its level and calculate its Cartesian
+// coordinates: note conversion from degrees to radians.
+template <typename T>
+void assignRadiusAndCoordinates(TreeNode<T>& node, int maxLevel) {
+  node.tpeRadius = node.tpeLevel / maxLevel;
+  T angleRad = node.tpeAngle * M_PI / 180.0;
+  node.tpeX = node.tpeRadius * std::cos(angleRad);
+  node.tpeY = node.tpeRadius * std::sin(angleRad);
+}
+
 // Function to generate TPE(Topology Tree Preserving Embedding) for nodes in the
 // tree.
 
@@ -52,6 +86,7 @@ void generateTreePreservingEmbedding(TreeWrapper<T>& tree) {
   int maxLevel = 0;
   for (int i = 0; i < tree.nodes.size(); ++i) {
     int level = getTreeNodeLevel(tree, i);
+    tree.nodes[i].tpeLevel = level;
     if (level > maxLevel) maxLevel = level;
   }
 
@@ -78,42 +113,230 @@ void generateTreePreservingEmbedding(TreeWrapper<T>& tree) {
     int curIdx = q.front();
     q.pop();
 
-    TreeNode<T>& parentNode = tree.nodes[curIdx];
-    int numChildren = parentNode.children.size();
-    if (numChildren == 0) continue;  // Leaf node, no children to process.
+    const TreeNode<T>& parentNode = tree.nodes[curIdx];
+    if (parentNode.children.empty()) continue;  // Leaf node, no children.
+
+    // Divide the parent's angle range equally among its children.
+    assignChildrenAngles(tree, curIdx);
+    for (int childIdx : parentNode.children) {
+      assignRadiusAndCoordinates(tree.nodes[childIdx], maxLevel);
+
+      // Push the child index onto the queue to process its children.
+      q.push(childIdx);
+    }
+  }
+}
 
-    // Parent's allocated angle range.
-    T parentMin = parentNode.tpeMinAngle;
-    T parentMax = parentNode.tpeMaxAngle;
-    T parentRange = parentMax - parentMin;
+// Same traversal and arithmetic as above, with the TPE written to embedding
+// instead of the nodes.
+template <typename T>
+void generateTreePreservingEmbedding(const TreeWrapper<T>& tree,
+                                     TreeEmbedding<T>& embedding) {
+  int numNodes = tree.nodes.size();
+  embedding.reset(numNodes);
+  if (numNodes == 0) return;
+
+  // Get maximum level of the tree.
+  int maxLevel = 0;
+  for (int i = 0; i < numNodes; ++i) {
+    int level = getTreeNodeLevel(tree, i);
+    embedding.tpeLevel[i] = level;
+    if (level > maxLevel) maxLevel = level;
+  }
+
+  // The root gets the full angle range and is placed at the center.
+  embedding.tpeMinAngle[0] = 0.0;
+  embedding.tpeMaxAngle[0] = 360.0;
+  embedding.tpeAngle[0] = 0.0;
+  embedding.tpeRadius[0] = 0.0;
+  embedding.tpeX[0] =
+      embedding.tpeRadius[0] * std::cos(embedding.tpeAngle[0] * M_PI / 180.0);
+  embedding.tpeY[0] =
+      embedding.tpeRadius[0] * std::sin(embedding.tpeAngle[0] * M_PI / 180.0);
+
+  // BFS traversal, every node is queued once.
+  std::vector<int> q;
+  q.reserve(numNodes);
+  q.push_back(0);
+  for (size_t head = 0; head < q.size(); ++head) {
+    int curIdx = q[head];
+    const TreeNode<T>& parentNode = tree.nodes[curIdx];
+    int numChildren = parentNode.children.size();
 
     // Divide the parent's angle range equally among its children.
+    T parentMin = embedding.tpeMinAngle[curIdx];
+    T parentRange = embedding.tpeMaxAngle[curIdx] - parentMin;
     for (int i = 0; i < numChildren; i++) {
       int childIdx = parentNode.children[i];
-      TreeNode<T>& child = tree.nodes[childIdx];
-      // Compute child's angle range.
-      child.tpeMinAngle = parentMin + (parentRange * i) / numChildren;
-      child.tpeMaxAngle = parentMin + (parentRange * (i + 1)) / numChildren;
-      // Choose the midpoint of the child's angle range as its tpeAngle.
-      child.tpeAngle = (child.tpeMinAngle + child.tpeMaxAngle) / 2.0;
-      // Set the child's radius.
-      child.tpeRadius = getTreeNodeLevel(tree, childIdx) / maxLevel;
-      // Calculate Cartesian coordinates: note conversion from degrees to
-      // radians.
-      T angleRad = child.tpeAngle * M_PI / 180.0;
-      child.tpeX = child.tpeRadius * std::cos(angleRad);
-      child.tpeY = child.tpeRadius * std::sin(angleRad);
+      embedding.tpeMinAngle[childIdx] =
+          parentMin + (parentRange * i) / numChildren;
+      embedding.tpeMaxAngle[childIdx] =
+          parentMin + (parentRange * (i + 1)) / numChildren;
+      embedding.tpeAngle[childIdx] = (embedding.tpeMinAngle[childIdx] +
+                                      embedding.tpeMaxAngle[childIdx]) /
+                                     2.0;
 
-      // Push the child index onto the queue to process its children.
-      q.push(childIdx);
+      embedding.tpeRadius[childIdx] = embedding.tpeLevel[childIdx] / maxLevel;
+      T angleRad = embedding.tpeAngle[childIdx] * M_PI / 180.0;
+      embedding.tpeX[childIdx] =
+          embedding.tpeRadius[childIdx] * std::cos(angleRad);
+      embedding.tpeY[childIdx] =
+          embedding.tpeRadius[childIdx] * std::sin(angleRad);
+
+      q.push_back(childIdx);
     }
   }
 }
 
+template <typename T>
+TreeWrapper<T> generateTreePreservingEmbedding(TreeWrapper<T>&& tree) {
+  generateTreePreservingEmbedding(tree);
+  return std::move(tree);
+}
+
+// Whether any TPE field of two nodes differs.
+template <typename T>
+bool isTreePreservingEmbeddingChanged(const TreeNode<T>& nodeA,
+                                      const TreeNode<T>& nodeB) {
+  return nodeA.tpeX != nodeB.tpeX || nodeA.tpeY != nodeB.tpeY ||
+         nodeA.tpeRadius != nodeB.tpeRadius ||
+         nodeA.tpeMinAngle != nodeB.tpeMinAngle ||
+         nodeA.tpeMaxAngle != nodeB.tpeMaxAngle ||
+         nodeA.tpeAngle != nodeB.tpeAngle || nodeA.tpeLevel != nodeB.tpeLevel;
+}
+
+// -------------------------------------------------------------------------
+// Function: updateTreePreservingEmbedding
+//
+// Incremental version of generateTreePreservingEmbedding for local edits.
+// The angle range of a node only depends on its parent's range and on its
+// index among its siblings, and its level only depends on its ancestors. So
+// for every dirty node, only the angle ranges of the node and its siblings
+// and the levels of their subtrees are recomputed, starting from the parent.
+// The radius depends on the maximum level of the whole tree, if that changes
+// the radius and coordinates of all nodes are updated.
+template <typename T>
+std::vector<int> updateTreePreservingEmbedding(
+    TreeWrapper<T>& tree, const std::vector<int>& dirtyNodes) {
+  std::vector<int> changedNodes;
+  int numNodes = tree.nodes.size();
+  if (numNodes == 0) return changedNodes;
+
+  // Keep a copy of the TPE fields to report the nodes that changed.
+  std::vector<TreeNode<T>> oldTpe(numNodes);
+  auto saveTpe = [&](int idx) {
+    TreeNode<T>& saved = oldTpe[idx];
+    const TreeNode<T>& node = tree.nodes[idx];
+    saved.tpeX = node.tpeX;
+    saved.tpeY = node.tpeY;
+    saved.tpeRadius = node.tpeRadius;
+    saved.tpeMinAngle = node.tpeMinAngle;
+    saved.tpeMaxAngle = node.tpeMaxAngle;
+    saved.tpeAngle = node.tpeAngle;
+    saved.tpeLevel = node.tpeLevel;
+  };
+
+  // Editing the root affects the whole tree.
+  bool rootDirty = false;
+  for (int idx : dirtyNodes) {
+    if (idx == 0 || tree.nodes[idx].parent < 0) rootDirty = true;
+  }
+  if (rootDirty) {
+    for (int i = 0; i < numNodes; ++i) saveTpe(i);
+    generateTreePreservingEmbedding(tree);
+    for (int i = 0; i < numNodes; ++i) {
+      if (isTreePreservingEmbeddingChanged(oldTpe[i], tree.nodes[i])) {
+        changedNodes.push_back(i);
+      }
+    }
+    return changedNodes;
+  }
+
+  int oldMaxLevel = 0;
+  for (const TreeNode<T>& node : tree.nodes) {
+    if (node.tpeLevel > oldMaxLevel) oldMaxLevel = node.tpeLevel;
+  }
+
+  // The parents of the dirty nodes are the roots of the recomputed regions.
+  // Skip parents which are inside the region of another parent.
+  std::vector<bool> isRegionRoot(numNodes, false);
+  for (int idx : dirtyNodes) {
+    isRegionRoot[tree.nodes[idx].parent] = true;
+  }
+  std::vector<int> regionRoots;
+  for (int idx = 0; idx < numNodes; ++idx) {
+    if (!isRegionRoot[idx]) continue;
+    bool covered = false;
+    for (int p = tree.nodes[idx].parent; p != -1; p = tree.nodes[p].parent) {
+      if (isRegionRoot[p]) {
+        covered = true;
+        break;
+      }
+    }
+    if (!covered) regionRoots.push_back(idx);
+  }
+
+  // Recompute angle ranges and levels of the regions in BFS order.
+  std::vector<int> regionNodes;
+  std::queue<int> q;
+  for (int rootIdx : regionRoots) {
+    q.push(rootIdx);
+    while (!q.empty()) {
+      int curIdx = q.front();
+      q.pop();
+
+      const TreeNode<T>& parentNode = tree.nodes[curIdx];
+      if (parentNode.children.empty()) continue;
+
+      for (int childIdx : parentNode.children) saveTpe(childIdx);
+      assignChildrenAngles(tree, curIdx);
+      for (int childIdx : parentNode.children) {
+        TreeNode<T>& child = tree.nodes[childIdx];
+        // Same level as getTreeNodeLevel: one level deeper than the parent if
+        // the child is not at the parent's position.
+        T dist = std::sqrt(std::pow(child.posX - parentNode.posX, 2) +
+                           std::pow(child.posY - parentNode.posY, 2));
+        T delta = 0.1;
+        child.tpeLevel = parentNode.tpeLevel + (dist > delta ? 1 : 0);
+        regionNodes.push_back(childIdx);
+        q.push(childIdx);
+      }
+    }
+  }
+
+  int maxLevel = 0;
+  for (const TreeNode<T>& node : tree.nodes) {
+    if (node.tpeLevel > maxLevel) maxLevel = node.tpeLevel;
+  }
+
+  if (maxLevel == oldMaxLevel) {
+    for (int idx : regionNodes) {
+      assignRadiusAndCoordinates(tree.nodes[idx], maxLevel);
+      if (isTreePreservingEmbeddingChanged(oldTpe[idx], tree.nodes[idx])) {
+        changedNodes.push_back(idx);
+      }
+    }
+    std::sort(changedNodes.begin(), changedNodes.end());
+    return changedNodes;
+  }
+
+  // The maximum level changed, update the radius of every node but the root.
+  std::vector<bool> inRegion(numNodes, false);
+  for (int idx : regionNodes) inRegion[idx] = true;
+  for (int idx = 0; idx < numNodes; ++idx) {
+    if (!inRegion[idx]) saveTpe(idx);
+    if (idx != 0) assignRadiusAndCoordinates(tree.nodes[idx], maxLevel);
+    if (isTreePreservingEmbeddingChanged(oldTpe[idx], tree.nodes[idx])) {
+      changedNodes.push_back(idx);
+    }
+  }
+  return changedNodes;
+}
+
 template <typename T>
 void printTreePreservingEmbedding(const TreeWrapper<T>& tree,
                                   const std::string& treeName) {
-  if (!kDebug) return;
+  if (!kDebug || !debugOutputEnabled()) return;
   std::cout << "TPE of Tree: " << treeName << " Timestamp: " << tree.timestamp
             << std::endl;
   for (size_t i = 0; i < tree.nodes.size(); i++) {
@@ -132,5 +355,14 @@ template int getTreeNodeLevel<float>(const TreeWrapper<float>& tree, int index);
 
 template void generateTreePreservingEmbedding<float>(TreeWrapper<float>& tree);
 
+template void generateTreePreservingEmbedding<float>(
+    const TreeWrapper<float>& tree, TreeEmbedding<float>& embedding);
+
+template TreeWrapper<float> generateTreePreservingEmbedding<float>(
+    TreeWrapper<float>&& tree);
+
+template std::vector<int> updateTreePreservingEmbedding<float>(
+    TreeWrapper<float>& tree, const std::vector<int>& dirtyNodes);
+
 template void printTreePreservingEmbedding<float>(
     const TreeWrapper<float>& tree, const std::string& treeName);
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "TreeNode.hpp"
 
@@ -10,6 +11,24 @@ int getTreeNodeLevel(const TreeWrapper<T>& tree, int index);
 template <typename T>
 void generateTreePreservingEmbedding(TreeWrapper<T>& tree);
 
+// Same as above, but tree is not modified, its TPE is written to embedding.
+template <typename T>
+void generateTreePreservingEmbedding(const TreeWrapper<T>& tree,
+                                     TreeEmbedding<T>& embedding);
+
+// Same as above, embeds tree in place and returns it without copying.
+template <typename T>
+TreeWrapper<T> generateTreePreservingEmbedding(TreeWrapper<T>&& tree);
+
+// Update the TPE of a tree whose TPE has been generated after local edits.
+// dirtyNodes are the nodes which were added, moved or whose children changed
+// (for a removed node, its parent). Only the angular sectors of the dirty
+// nodes and their siblings and their subtrees are recomputed. Returns the
+// sorted indices of the nodes whose TPE changed.
+template <typename T>
+std::vector<int> updateTreePreservingEmbedding(
+    TreeWrapper<T>& tree, const std::vector<int>& dirtyNodes);
+
 template <typename T>
 void printTreePreservingEmbedding(const TreeWrapper<T>& tree,
                                   const std::string& treeName);
\ No newline at end of file
@@ -0,0 +1,485 @@
+#include "TreeRecording.hpp"
+
+#include <zstd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// File layout (all integers little endian):
+//   header: "TREC", u32 version, f64 positionStep, f64 angleStep,
+//           u32 framesPerBlock
+//   blocks: u32 rawSize, u32 compressedSize, zstd compressed frames
+//   index:  per block u64 firstTimestamp, u64 lastTimestamp, u64 fileOffset,
+//           u32 numFrames
+//   footer: u64 indexOffset, u32 numBlocks, "TIDX"
+constexpr char kRecordingMagic[4] = {'T', 'R', 'E', 'C'};
+constexpr char kRecordingIndexMagic[4] = {'T', 'I', 'D', 'X'};
+constexpr uint32_t kRecordingVersion = 1;
+constexpr int kRecordingFooterSize = 16;
+// Number of quantized values per node: posX, posY, offset, angle.
+constexpr int kQuantizedPerNode = 4;
+
+//------------------------------------------------------------------------------
+// Little endian fixed size integers.
+static void appendFixed(std::vector<uint8_t>& buf, uint64_t value,
+                        int numBytes) {
+  for (int i = 0; i < numBytes; ++i) {
+    buf.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+static uint64_t readFixed(const uint8_t* data, int numBytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < numBytes; ++i) {
+    value |= static_cast<uint64_t>(data[i]) << (8 * i);
+  }
+  return value;
+}
+
+static void appendDouble(std::vector<uint8_t>& buf, double value) {
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  appendFixed(buf, bits, 8);
+}
+
+static double readDouble(const uint8_t* data) {
+  uint64_t bits = readFixed(data, 8);
+  double value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+//------------------------------------------------------------------------------
+// Variable length integers, signed values are zigzag encoded so that small
+// negative deltas stay small.
+static void appendVarint(std::vector<uint8_t>& buf, uint64_t value) {
+  while (value >= 0x80) {
+    buf.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  buf.push_back(static_cast<uint8_t>(value));
+}
+
+static void appendSignedVarint(std::vector<uint8_t>& buf, int64_t value) {
+  appendVarint(buf, (static_cast<uint64_t>(value) << 1) ^
+                        static_cast<uint64_t>(value >> 63));
+}
+
+static bool readVarint(const uint8_t*& data, const uint8_t* end,
+                       uint64_t& value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && data < end; shift += 7) {
+    uint8_t byte = *data++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return true;
+  }
+  return false;
+}
+
+static bool readSignedVarint(const uint8_t*& data, const uint8_t* end,
+                             int64_t& value) {
+  uint64_t zigzag;
+  if (!readVarint(data, end, zigzag)) return false;
+  value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+  return true;
+}
+
+//------------------------------------------------------------------------------
+template <typename T>
+bool isSameTopology(const TreeWrapper<T>& treeA, const TreeWrapper<T>& treeB) {
+  if (treeA.nodes.size() != treeB.nodes.size()) return false;
+  for (size_t i = 0; i < treeA.nodes.size(); ++i) {
+    const TreeNode<T>& nodeA = treeA.nodes[i];
+    const TreeNode<T>& nodeB = treeB.nodes[i];
+    if (nodeA.type != nodeB.type || nodeA.parent != nodeB.parent ||
+        nodeA.children != nodeB.children) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+void quantizeTree(const TreeWrapper<T>& tree,
+                  const TreeRecordingOptions& options,
+                  std::vector<int64_t>& quantized) {
+  quantized.resize(tree.nodes.size() * kQuantizedPerNode);
+  for (size_t i = 0; i < tree.nodes.size(); ++i) {
+    const TreeNode<T>& node = tree.nodes[i];
+    int64_t* q = &quantized[i * kQuantizedPerNode];
+    q[0] = std::llround(node.posX / options.positionStep);
+    q[1] = std::llround(node.posY / options.positionStep);
+    q[2] = std::llround(node.offset / options.positionStep);
+    q[3] = std::llround(node.angle / options.angleStep);
+  }
+}
+
+// Encode tree against the previous frame of the block. For the first frame of
+// a block prevTree is empty and the frame is encoded as it is.
+template <typename T>
+void encodeRecordingFrame(const TreeWrapper<T>& tree,
+                          const TreeWrapper<T>& prevTree,
+                          const std::vector<int64_t>& quantized,
+                          const std::vector<int64_t>& prevQuantized,
+                          std::vector<uint8_t>& buf) {
+  appendSignedVarint(buf, static_cast<int64_t>(tree.timestamp -
+                                               prevTree.timestamp));
+  appendVarint(buf, tree.nodes.size());
+
+  bool sameTopology = isSameTopology(tree, prevTree);
+  buf.push_back(sameTopology ? 1 : 0);
+  if (!sameTopology) {
+    for (size_t i = 0; i < tree.nodes.size(); ++i) {
+      const TreeNode<T>& node = tree.nodes[i];
+      appendSignedVarint(buf, node.type);
+      appendSignedVarint(buf, node.parent);
+      appendVarint(buf, node.children.size());
+      // Children are mostly consecutive indices, store their differences.
+      int64_t last = static_cast<int64_t>(i);
+      for (int child : node.children) {
+        appendSignedVarint(buf, child - last);
+        last = child;
+      }
+    }
+  }
+
+  for (size_t k = 0; k < quantized.size(); ++k) {
+    int64_t prev = k < prevQuantized.size() ? prevQuantized[k] : 0;
+    appendSignedVarint(buf, quantized[k] - prev);
+  }
+}
+
+template <typename T>
+bool decodeRecordingFrame(const uint8_t*& data, const uint8_t* end,
+                          const TreeRecordingOptions& options,
+                          const TreeWrapper<T>& prevTree,
+                          const std::vector<int64_t>& prevQuantized,
+                          TreeWrapper<T>& tree,
+                          std::vector<int64_t>& quantized) {
+  int64_t timestampDelta;
+  uint64_t numNodes;
+  if (!readSignedVarint(data, end, timestampDelta)) return false;
+  if (!readVarint(data, end, numNodes)) return false;
+  if (data >= end || numNodes > static_cast<uint64_t>(end - data)) {
+    return false;
+  }
+  bool sameTopology = *data++ != 0;
+
+  tree.timestamp = prevTree.timestamp + static_cast<uint64_t>(timestampDelta);
+  if (sameTopology) {
+    if (numNodes != prevTree.nodes.size()) return false;
+    tree.nodes = prevTree.nodes;
+  } else {
+    tree.nodes.resize(numNodes);
+    for (size_t i = 0; i < numNodes; ++i) {
+      TreeNode<T>& node = tree.nodes[i];
+      int64_t type, parent, child;
+      uint64_t numChildren;
+      if (!readSignedVarint(data, end, type)) return false;
+      if (!readSignedVarint(data, end, parent)) return false;
+      if (!readVarint(data, end, numChildren)) return false;
+      if (numChildren > numNodes) return false;
+      // Reject indices out of range, a corrupt recording must not produce a
+      // tree that is indexed out of bounds later.
+      if (parent < -1 || parent >= static_cast<int64_t>(numNodes)) {
+        return false;
+      }
+      node.type = static_cast<int>(type);
+      node.parent = static_cast<int>(parent);
+      node.children.resize(numChildren);
+      int64_t last = static_cast<int64_t>(i);
+      for (uint64_t c = 0; c < numChildren; ++c) {
+        if (!readSignedVarint(data, end, child)) return false;
+        // Checked before adding, so that last + child cannot overflow.
+        if (child < -last || child >= static_cast<int64_t>(numNodes) - last) {
+          return false;
+        }
+        last += child;
+        node.children[c] = static_cast<int>(last);
+      }
+    }
+  }
+
+  quantized.resize(numNodes * kQuantizedPerNode);
+  for (size_t k = 0; k < quantized.size(); ++k) {
+    int64_t delta;
+    if (!readSignedVarint(data, end, delta)) return false;
+    int64_t prev = k < prevQuantized.size() ? prevQuantized[k] : 0;
+    quantized[k] = prev + delta;
+  }
+  for (size_t i = 0; i < numNodes; ++i) {
+    TreeNode<T>& node = tree.nodes[i];
+    const int64_t* q = &quantized[i * kQuantizedPerNode];
+    node.posX = static_cast<T>(q[0] * options.positionStep);
+    node.posY = static_cast<T>(q[1] * options.positionStep);
+    node.offset = static_cast<T>(q[2] * options.positionStep);
+    node.angle = static_cast<T>(q[3] * options.angleStep);
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// TreeRecordingWriter
+template <typename T>
+TreeRecordingWriter<T>::TreeRecordingWriter(const TreeRecordingOptions& options)
+    : options_(options) {
+  if (options_.framesPerBlock < 1) options_.framesPerBlock = 1;
+}
+
+template <typename T>
+TreeRecordingWriter<T>::~TreeRecordingWriter() {
+  close();
+}
+
+template <typename T>
+bool TreeRecordingWriter<T>::open(const std::string& filename) {
+  if (isOpen()) close();
+
+  outFile_.open(filename, std::ios::binary);
+  if (!outFile_) return false;
+
+  blocks_.clear();
+  currentBlock_ = BlockInfo();
+  rawBlock_.clear();
+
+  std::vector<uint8_t> header(kRecordingMagic, kRecordingMagic + 4);
+  appendFixed(header, kRecordingVersion, 4);
+  appendDouble(header, options_.positionStep);
+  appendDouble(header, options_.angleStep);
+  appendFixed(header, options_.framesPerBlock, 4);
+  outFile_.write(reinterpret_cast<const char*>(header.data()), header.size());
+  return static_cast<bool>(outFile_);
+}
+
+template <typename T>
+bool TreeRecordingWriter<T>::write(const TreeWrapper<T>& tree) {
+  if (!isOpen()) return false;
+
+  // Every block starts with a frame encoded without a predecessor.
+  if (currentBlock_.numFrames == 0) {
+    prevTree_.timestamp = 0;
+    prevTree_.nodes.clear();
+    prevQuantized_.clear();
+    currentBlock_.firstTimestamp = tree.timestamp;
+  }
+
+  quantizeTree(tree, options_, quantized_);
+  encodeRecordingFrame(tree, prevTree_, quantized_, prevQuantized_, rawBlock_);
+  prevTree_ = tree;
+  prevQuantized_.swap(quantized_);
+
+  currentBlock_.lastTimestamp = tree.timestamp;
+  currentBlock_.numFrames++;
+  if (currentBlock_.numFrames >=
+      static_cast<uint32_t>(options_.framesPerBlock)) {
+    return flushBlock();
+  }
+  return true;
+}
+
+template <typename T>
+bool TreeRecordingWriter<T>::flushBlock() {
+  if (currentBlock_.numFrames == 0) return true;
+
+  compressedBlock_.resize(ZSTD_compressBound(rawBlock_.size()));
+  size_t compressedSize =
+      ZSTD_compress(compressedBlock_.data(), compressedBlock_.size(),
+                    rawBlock_.data(), rawBlock_.size(),
+                    options_.compressionLevel);
+  if (ZSTD_isError(compressedSize)) return false;
+
+  currentBlock_.fileOffset = static_cast<uint64_t>(outFile_.tellp());
+  std::vector<uint8_t> sizes;
+  appendFixed(sizes, rawBlock_.size(), 4);
+  appendFixed(sizes, compressedSize, 4);
+  outFile_.write(reinterpret_cast<const char*>(sizes.data()), sizes.size());
+  outFile_.write(reinterpret_cast<const char*>(compressedBlock_.data()),
+                 compressedSize);
+
+  blocks_.push_back(currentBlock_);
+  currentBlock_ = BlockInfo();
+  rawBlock_.clear();
+  return static_cast<bool>(outFile_);
+}
+
+template <typename T>
+bool TreeRecordingWriter<T>::close() {
+  if (!isOpen()) return false;
+
+  bool ok = flushBlock();
+
+  uint64_t indexOffset = static_cast<uint64_t>(outFile_.tellp());
+  std::vector<uint8_t> index;
+  for (const BlockInfo& block : blocks_) {
+    appendFixed(index, block.firstTimestamp, 8);
+    appendFixed(index, block.lastTimestamp, 8);
+    appendFixed(index, block.fileOffset, 8);
+    appendFixed(index, block.numFrames, 4);
+  }
+  appendFixed(index, indexOffset, 8);
+  appendFixed(index, blocks_.size(), 4);
+  index.insert(index.end(), kRecordingIndexMagic, kRecordingIndexMagic + 4);
+  outFile_.write(reinterpret_cast<const char*>(index.data()), index.size());
+
+  ok = ok && static_cast<bool>(outFile_);
+  outFile_.close();
+  return ok && !outFile_.fail();
+}
+
+//------------------------------------------------------------------------------
+// TreeRecordingReader
+template <typename T>
+bool TreeRecordingReader<T>::open(const std::string& filename) {
+  close();
+
+  inFile_.open(filename, std::ios::binary);
+  if (!inFile_) return false;
+
+  uint8_t header[28];
+  if (!inFile_.read(reinterpret_cast<char*>(header), sizeof(header))) {
+    return false;
+  }
+  if (std::memcmp(header, kRecordingMagic, 4) != 0 ||
+      readFixed(header + 4, 4) != kRecordingVersion) {
+    return false;
+  }
+  options_.positionStep = readDouble(header + 8);
+  options_.angleStep = readDouble(header + 16);
+  options_.framesPerBlock = static_cast<int>(readFixed(header + 24, 4));
+
+  uint8_t footer[kRecordingFooterSize];
+  inFile_.seekg(-kRecordingFooterSize, std::ios::end);
+  if (!inFile_.read(reinterpret_cast<char*>(footer), sizeof(footer))) {
+    return false;
+  }
+  if (std::memcmp(footer + 12, kRecordingIndexMagic, 4) != 0) return false;
+  uint64_t indexOffset = readFixed(footer, 8);
+  uint64_t numBlocks = readFixed(footer + 8, 4);
+
+  const int kEntrySize = 28;
+  std::vector<uint8_t> index(numBlocks * kEntrySize);
+  inFile_.seekg(indexOffset);
+  if (!inFile_.read(reinterpret_cast<char*>(index.data()), index.size())) {
+    return false;
+  }
+
+  blocks_.resize(numBlocks);
+  numFrames_ = 0;
+  for (size_t b = 0; b < numBlocks; ++b) {
+    const uint8_t* entry = &index[b * kEntrySize];
+    BlockInfo& block = blocks_[b];
+    block.firstTimestamp = readFixed(entry, 8);
+    block.lastTimestamp = readFixed(entry + 8, 8);
+    block.fileOffset = readFixed(entry + 16, 8);
+    block.numFrames = static_cast<uint32_t>(readFixed(entry + 24, 4));
+    block.firstFrame = numFrames_;
+    numFrames_ += block.numFrames;
+  }
+  return true;
+}
+
+template <typename T>
+void TreeRecordingReader<T>::close() {
+  if (inFile_.is_open()) inFile_.close();
+  inFile_.clear();
+  blocks_.clear();
+  numFrames_ = 0;
+  cachedBlock_ = -1;
+  cachedFrames_.clear();
+}
+
+template <typename T>
+bool TreeRecordingReader<T>::decodeBlock(size_t blockIdx) {
+  if (cachedBlock_ == static_cast<int>(blockIdx)) return true;
+  cachedBlock_ = -1;
+
+  const BlockInfo& block = blocks_[blockIdx];
+  uint8_t sizes[8];
+  inFile_.clear();
+  inFile_.seekg(block.fileOffset);
+  if (!inFile_.read(reinterpret_cast<char*>(sizes), sizeof(sizes))) {
+    return false;
+  }
+  size_t rawSize = readFixed(sizes, 4);
+  size_t compressedSize = readFixed(sizes + 4, 4);
+
+  std::vector<uint8_t> compressed(compressedSize);
+  if (!inFile_.read(reinterpret_cast<char*>(compressed.data()),
+                    compressedSize)) {
+    return false;
+  }
+  std::vector<uint8_t> raw(rawSize);
+  size_t decodedSize = ZSTD_decompress(raw.data(), raw.size(),
+                                       compressed.data(), compressedSize);
+  if (ZSTD_isError(decodedSize) || decodedSize != rawSize) return false;
+
+  const uint8_t* data = raw.data();
+  const uint8_t* end = data + raw.size();
+  TreeWrapper<T> emptyTree;
+  std::vector<int64_t> prevQuantized, quantized;
+  cachedFrames_.resize(block.numFrames);
+  for (size_t k = 0; k < block.numFrames; ++k) {
+    const TreeWrapper<T>& prevTree = k == 0 ? emptyTree : cachedFrames_[k - 1];
+    if (!decodeRecordingFrame(data, end, options_, prevTree, prevQuantized,
+                              cachedFrames_[k], quantized)) {
+      return false;
+    }
+    prevQuantized.swap(quantized);
+  }
+
+  cachedBlock_ = static_cast<int>(blockIdx);
+  return true;
+}
+
+template <typename T>
+bool TreeRecordingReader<T>::readFrame(size_t index, TreeWrapper<T>& tree) {
+  if (index >= numFrames_) return false;
+
+  // Find the block containing the frame.
+  auto it = std::upper_bound(
+      blocks_.begin(), blocks_.end(), index,
+      [](size_t idx, const BlockInfo& block) { return idx < block.firstFrame; });
+  size_t blockIdx = std::distance(blocks_.begin(), it) - 1;
+  if (!decodeBlock(blockIdx)) return false;
+
+  tree = cachedFrames_[index - blocks_[blockIdx].firstFrame];
+  return true;
+}
+
+template <typename T>
+bool TreeRecordingReader<T>::seek(uint64_t timestamp, TreeWrapper<T>& tree) {
+  // First block which may contain a frame at or after timestamp.
+  auto it = std::lower_bound(blocks_.begin(), blocks_.end(), timestamp,
+                             [](const BlockInfo& block, uint64_t ts) {
+                               return block.lastTimestamp < ts;
+                             });
+  if (it == blocks_.end()) return false;
+
+  size_t blockIdx = std::distance(blocks_.begin(), it);
+  if (!decodeBlock(blockIdx)) return false;
+
+  for (const TreeWrapper<T>& frame : cachedFrames_) {
+    if (frame.timestamp >= timestamp) {
+      tree = frame;
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+bool TreeRecordingReader<T>::readAll(std::list<TreeWrapper<T>>& trees) {
+  trees.clear();
+  for (size_t b = 0; b < blocks_.size(); ++b) {
+    if (!decodeBlock(b)) return false;
+    for (const TreeWrapper<T>& frame : cachedFrames_) {
+      trees.push_back(frame);
+    }
+  }
+  return true;
+}
+
+// Explicit instantiations for type to use.
+template class TreeRecordingWriter<float>;
+template class TreeRecordingReader<float>;
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "TreeNode.hpp"
+
+// Binary recording of a sequence of trees.
+//
+// Frames are grouped into blocks. The first frame of a block is stored as it
+// is, every following frame is delta-encoded against its predecessor: node
+// positions are quantized and stored as varint differences, and the topology
+// (type, parent, children) is only stored when it differs from the previous
+// frame. Each block is compressed with zstd, and an index of the blocks with
+// their timestamp range is appended at the end of the file, so any frame can be
+// read by decoding a single block.
+//
+// Positions are quantized, so the recording is lossy up to half a quantization
+// step. TPE fields are not recorded, same as the json format.
+struct TreeRecordingOptions {
+  // Quantization step of posX, posY and offset.
+  double positionStep = 1e-3;
+  // Quantization step of angle in radians.
+  double angleStep = 1e-5;
+  // Number of frames per compressed block, i.e. the maximum number of frames
+  // to decode for a random access.
+  int framesPerBlock = 64;
+  // zstd compression level.
+  int compressionLevel = 3;
+};
+
+template <typename T>
+class TreeRecordingWriter {
+ public:
+  explicit TreeRecordingWriter(
+      const TreeRecordingOptions& options = TreeRecordingOptions());
+  ~TreeRecordingWriter();
+
+  TreeRecordingWriter(const TreeRecordingWriter&) = delete;
+  TreeRecordingWriter& operator=(const TreeRecordingWriter&) = delete;
+
+  bool open(const std::string& filename);
+  // Timestamps are expected to be non-decreasing for seeking by timestamp.
+  bool write(const TreeWrapper<T>& tree);
+  // Flush the pending block, write the block index and close the file.
+  bool close();
+
+  bool isOpen() const { return outFile_.is_open(); }
+
+ private:
+  struct BlockInfo {
+    uint64_t firstTimestamp = 0;
+    uint64_t lastTimestamp = 0;
+    uint64_t fileOffset = 0;
+    uint32_t numFrames = 0;
+  };
+
+  bool flushBlock();
+
+  TreeRecordingOptions options_;
+  std::ofstream outFile_;
+  std::vector<BlockInfo> blocks_;
+  BlockInfo currentBlock_;
+  // Uncompressed encoded frames of the current block.
+  std::vector<uint8_t> rawBlock_;
+  std::vector<uint8_t> compressedBlock_;
+  // State of the previous frame the next frame is encoded against.
+  TreeWrapper<T> prevTree_;
+  std::vector<int64_t> prevQuantized_;
+  std::vector<int64_t> quantized_;
+};
+
+template <typename T>
+class TreeRecordingReader {
+ public:
+  bool open(const std::string& filename);
+  void close();
+
+  size_t numFrames() const { return numFrames_; }
+
+  bool readFrame(size_t index, TreeWrapper<T>& tree);
+  // Read the first frame whose timestamp is not less than timestamp.
+  bool seek(uint64_t timestamp, TreeWrapper<T>& tree);
+  bool readAll(std::list<TreeWrapper<T>>& trees);
+
+ private:
+  struct BlockInfo {
+    uint64_t firstTimestamp = 0;
+    uint64_t lastTimestamp = 0;
+    uint64_t fileOffset = 0;
+    uint32_t numFrames = 0;
+    size_t firstFrame = 0;
+  };
+
+  bool decodeBlock(size_t blockIdx);
+
+  std::ifstream inFile_;
+  TreeRecordingOptions options_;
+  std::vector<BlockInfo> blocks_;
+  size_t numFrames_ = 0;
+  // Frames of the most recently decoded block.
+  int cachedBlock_ = -1;
+  std::vector<TreeWrapper<T>> cachedFrames_;
+};
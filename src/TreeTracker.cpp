@@ -0,0 +1,170 @@
+#include "TreeTracker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <utility>
+
+#include "SparseAssignment.hpp"
+#include "ThreadPool.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+template <typename T>
+TreeTracker<T>::TreeTracker(const TreeMatchingOptions<T>& options,
+                            FeatureNormalizer<T>* normalizer)
+    : options_(options), normalizer_(normalizer) {
+  if (options.similarityType == "cosine") {
+    similarity_ = computeCosineSimilarity<T>;
+  } else if (options.similarityType == "euclidean") {
+    similarity_ = computeEuclideanSimilarity<T>;
+  } else {
+    std::cout << "unknown similarityType " << options.similarityType
+              << std::endl;
+    exit(1);
+  }
+}
+
+template <typename T>
+void TreeTracker<T>::reset() {
+  hasPrevious_ = false;
+  matching_.clear();
+}
+
+template <typename T>
+void TreeTracker<T>::computeCostMatrix() {
+  size_t numRows = previousFeatures_.size();
+  size_t numCols = currentFeatures_.size();
+  // Rows keep their capacity from frame to frame.
+  costMatrix_.resize(numRows);
+  auto fillRow = [&](size_t i) {
+    costMatrix_[i].resize(numCols);
+    for (size_t j = 0; j < numCols; j++) {
+      costMatrix_[i][j] =
+          -similarity_(previousFeatures_[i], currentFeatures_[j]);
+    }
+  };
+
+  // Small matrices are not worth the scheduling overhead.
+  if (numRows * numCols < kParallelSimilarityCells) {
+    for (size_t i = 0; i < numRows; i++) fillRow(i);
+  } else {
+    size_t rowsPerTask =
+        std::max<size_t>(1, kParallelSimilarityCells / 4 / numCols);
+    defaultThreadPool().parallelFor(0, numRows, fillRow, rowsPerTask);
+  }
+}
+
+template <typename T>
+void TreeTracker<T>::solveWarmStarted() {
+  int numRows = costMatrix_.size();
+  int numCols = costMatrix_[0].size();
+  int size = std::max(numRows, numCols);
+  FrameArenaScope scope(arena_);
+  ArenaVector<T> cost = padCostMatrix(costMatrix_, size, T(0), arena_);
+
+  // Every node of the previous frame starts with the dual of its track. The
+  // tight pairs can be matched right away, only the rows left over are
+  // solved.
+  state_.rowDuals.assign(size + 1, 0);
+  std::copy(previousDuals_.begin(), previousDuals_.end(),
+            state_.rowDuals.begin() + 1);
+  std::vector<int> freeRows = matchTightPairs(cost, size, state_, arena_);
+  augmentAssignment(cost, size, freeRows, state_, arena_);
+
+  // A node of the current frame continues the track of its match with the
+  // match's row dual.
+  matching_.assign(numRows, -1);
+  for (int j = 1; j <= size; j++) {
+    int row = state_.columnMatching[j];
+    if (row > numRows || j > numCols) continue;
+    matching_[row - 1] = j - 1;
+    currentDuals_[j - 1] = state_.rowDuals[row];
+  }
+
+  // Only differences of duals matter, keep them from drifting away.
+  T minDual = *std::min_element(currentDuals_.begin(), currentDuals_.end());
+  for (T& dual : currentDuals_) dual -= minDual;
+}
+
+template <typename T>
+bool TreeTracker<T>::usesCandidates(size_t numNodes) const {
+  return options_.gatingRadius != std::numeric_limits<T>::infinity() ||
+         (options_.candidateK > 0 && options_.candidateK < numNodes);
+}
+
+template <typename T>
+void TreeTracker<T>::solveCandidates(const TreeWrapper<T>& tree) {
+  // Same candidates as matchTrees with the options.
+  CandidateGraph<T> candidates =
+      options_.gatingRadius != std::numeric_limits<T>::infinity()
+          ? generateGatedCandidates(previousTree_, tree, previousFeatures_,
+                                    currentFeatures_, options_.gatingRadius,
+                                    options_.candidateK,
+                                    options_.similarityType, grid_)
+          : generateNearestCandidates(previousFeatures_, currentFeatures_,
+                                      options_.candidateK,
+                                      options_.similarityType);
+  matching_ = matchCandidates(candidates, previousFeatures_, currentFeatures_,
+                              options_);
+}
+
+template <typename T>
+const std::vector<int>& TreeTracker<T>::update(const TreeWrapper<T>& tree) {
+  auto start = std::chrono::steady_clock::now();
+
+  generateTreePreservingEmbedding(tree, currentTpe_);
+  if (normalizer_ != nullptr) {
+    normalizer_->generateFeatureVectors(tree, currentTpe_, currentFeatures_);
+  } else {
+    currentFeatures_ = generateFeatureVectors(tree, currentTpe_);
+  }
+
+  size_t numNodes = tree.nodes.size();
+  trackIds_.assign(numNodes, -1);
+  currentDuals_.assign(numNodes, 0);
+  matching_.clear();
+  if (hasPrevious_) {
+    if (previousFeatures_.empty() || numNodes == 0) {
+      matching_.assign(previousFeatures_.size(), -1);
+    } else if (usesCandidates(numNodes)) {
+      solveCandidates(tree);
+    } else {
+      computeCostMatrix();
+      if (options_.minSimilarity == -std::numeric_limits<T>::infinity()) {
+        solveWarmStarted();
+      } else {
+        matching_ = hungarianAlgorithmWithUnmatched(
+                        costMatrix_, -options_.minSimilarity, arena_)
+                        .second;
+      }
+    }
+    for (size_t i = 0; i < matching_.size(); i++) {
+      if (matching_[i] >= 0) trackIds_[matching_[i]] = previousTrackIds_[i];
+    }
+  }
+  for (int& trackId : trackIds_) {
+    if (trackId < 0) trackId = nextTrackId_++;
+  }
+
+  // The current frame is the previous one of the next frame.
+  std::swap(previousTpe_, currentTpe_);
+  std::swap(previousFeatures_, currentFeatures_);
+  std::swap(previousDuals_, currentDuals_);
+  previousTrackIds_ = trackIds_;
+  hasPrevious_ = true;
+  if (options_.gatingRadius != std::numeric_limits<T>::infinity()) {
+    previousTree_ = tree;
+  }
+
+  double latency = std::chrono::duration<double, std::micro>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  stats_.lastLatency = latency;
+  stats_.histogram.record(latency);
+  return trackIds_;
+}
+
+// Explicit instantiations for type to use.
+template class TreeTracker<float>;
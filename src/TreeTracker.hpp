@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "FeatureNormalizer.hpp"
+#include "FrameArena.hpp"
+#include "HungarianAlgorithm.hpp"
+#include "LatencyHistogram.hpp"
+#include "SpatialGrid.hpp"
+#include "TreeMatching.hpp"
+#include "TreeNode.hpp"
+
+// Latency of the frames processed by a TreeTracker, in microseconds.
+struct TrackerStats {
+  double lastLatency = 0.0;
+  // Distribution of the latencies, its count is the number of frames.
+  LatencyHistogram histogram;
+};
+
+// Tracks the nodes of a stream of trees: every tree is matched with the
+// previous one like matchTrees does, and the matches are chained into track
+// IDs that persist as long as a node keeps being matched.
+//
+// The work of the previous frame is reused. Its TPE and feature vectors are
+// kept instead of being recomputed when it becomes tree A of the next match,
+// and the dual variables of the solve travel along the tracks: a node starts
+// with the row dual of its match, and the column duals are reduced against
+// them. In a steady stream most tracks are then tight pairs of the initial
+// duals, and only the remaining nodes need an augmenting path search. Duals
+// are not reused if options.minSimilarity is set.
+//
+// With options.candidateK or options.gatingRadius set, frames are matched on
+// the sparse candidates of matchTrees instead, and no duals are reused either.
+// Gating keeps a copy of the positions of the previous frame.
+template <typename T>
+class TreeTracker {
+ public:
+  // normalizer: optional normalizer shared across frames, by default every
+  // tree is normalized by its own bounds like matchTrees does.
+  explicit TreeTracker(
+      const TreeMatchingOptions<T>& options = TreeMatchingOptions<T>(),
+      FeatureNormalizer<T>* normalizer = nullptr);
+
+  // Match tree with the previous frame and return the track ID of each of
+  // its nodes. A node matched to a node of the previous frame continues its
+  // track, any other node starts a new one. The tree is not modified and
+  // need not outlive the call.
+  const std::vector<int>& update(const TreeWrapper<T>& tree);
+
+  // Start over, the next frame starts new tracks for all its nodes. Track IDs
+  // keep increasing.
+  void reset();
+
+  // Track IDs of the nodes of the last frame.
+  const std::vector<int>& trackIds() const { return trackIds_; }
+  // Matching of the nodes of the frame before the last one to the nodes of
+  // the last one, in the format of matchTrees.
+  const std::vector<int>& matching() const { return matching_; }
+  // Number of tracks started so far.
+  int numTracks() const { return nextTrackId_; }
+  const TrackerStats& stats() const { return stats_; }
+
+ private:
+  void computeCostMatrix();
+  void solveWarmStarted();
+  // Whether frames are matched on sparse candidates, see the class comment.
+  bool usesCandidates(size_t numNodes) const;
+  void solveCandidates(const TreeWrapper<T>& tree);
+
+  TreeMatchingOptions<T> options_;
+  T (*similarity_)(const std::vector<T>&, const std::vector<T>&);
+  FeatureNormalizer<T>* normalizer_;
+
+  // Embedding of the previous and of the current frame, swapped after every
+  // frame so their buffers are reused.
+  TreeEmbedding<T> previousTpe_, currentTpe_;
+  std::vector<std::vector<T>> previousFeatures_, currentFeatures_;
+  std::vector<int> previousTrackIds_, trackIds_;
+  // Row dual the nodes of the previous frame continue their track with.
+  std::vector<T> previousDuals_, currentDuals_;
+  bool hasPrevious_ = false;
+  // Previous frame, only kept for gating. Its node buffers are reused.
+  TreeWrapper<T> previousTree_;
+  // Buckets of the gating grid, reused by every frame.
+  SpatialGrid<T> grid_;
+
+  std::vector<std::vector<T>> costMatrix_;
+  std::vector<int> matching_;
+  HungarianState<T> state_;
+  // Scratch memory of the solver, reused by every frame.
+  FrameArena arena_;
+  int nextTrackId_ = 0;
+  TrackerStats stats_;
+};
@@ -0,0 +1,59 @@
+#include "TreeWrapperPool.hpp"
+
+#include <algorithm>
+#include <utility>
+
+template <typename T>
+TreeWrapperPool<T>::TreeWrapperPool(size_t maxPooled)
+    : maxPooled_(maxPooled) {}
+
+template <typename T>
+TreeWrapper<T> TreeWrapperPool<T>::acquire(size_t numNodes) {
+  TreeWrapper<T> tree;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pooled_.empty()) {
+      stats_.misses++;
+    } else {
+      // The most recently released tree is the most likely to be cached.
+      tree = std::move(pooled_.back());
+      pooled_.pop_back();
+      stats_.hits++;
+    }
+    stats_.inUse++;
+    stats_.highWaterMark = std::max(stats_.highWaterMark, stats_.inUse);
+  }
+  resetTreeNodes(tree, numNodes);
+  return tree;
+}
+
+template <typename T>
+void TreeWrapperPool<T>::release(TreeWrapper<T>&& tree) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (stats_.inUse > 0) stats_.inUse--;
+  if (pooled_.size() < maxPooled_) pooled_.push_back(std::move(tree));
+}
+
+template <typename T>
+void TreeWrapperPool<T>::reserve(size_t numTrees, size_t numNodes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (pooled_.size() < std::min(numTrees, maxPooled_)) {
+    pooled_.emplace_back();
+    pooled_.back().nodes.resize(numNodes);
+  }
+}
+
+template <typename T>
+TreeWrapperPoolStats TreeWrapperPool<T>::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+template <typename T>
+size_t TreeWrapperPool<T>::numPooled() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pooled_.size();
+}
+
+// Explicit instantiations for type to use.
+template class TreeWrapperPool<float>;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "TreeNode.hpp"
+
+// Statistics of a TreeWrapperPool.
+struct TreeWrapperPoolStats {
+  // Acquires served by a released tree.
+  size_t hits = 0;
+  // Acquires that had to create a new tree.
+  size_t misses = 0;
+  // Trees acquired and not released yet.
+  size_t inUse = 0;
+  // Maximum of inUse since the pool was created.
+  size_t highWaterMark = 0;
+};
+
+// Pool of TreeWrapper objects that recycles trees with the capacity of their
+// node vector and of the children vectors of the nodes, so that processing a
+// sequence of similar-sized trees performs no allocation once the pool is
+// warmed up. Trees are fully owned by the caller between acquire and release.
+//
+// All methods are thread safe.
+template <typename T>
+class TreeWrapperPool {
+ public:
+  // maxPooled: number of released trees kept, further trees are freed.
+  explicit TreeWrapperPool(size_t maxPooled = 16);
+
+  // Tree with numNodes default nodes, see resetTreeNodes. Pass the expected
+  // number of nodes, node slots beyond numNodes are freed.
+  TreeWrapper<T> acquire(size_t numNodes = 0);
+  void release(TreeWrapper<T>&& tree);
+
+  // Allocate trees upfront so that the first acquires are hits as well.
+  void reserve(size_t numTrees, size_t numNodes);
+
+  TreeWrapperPoolStats stats() const;
+  // Number of released trees held by the pool.
+  size_t numPooled() const;
+
+ private:
+  size_t maxPooled_;
+  std::vector<TreeWrapper<T>> pooled_;
+  TreeWrapperPoolStats stats_;
+  mutable std::mutex mutex_;
+};
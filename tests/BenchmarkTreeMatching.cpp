@@ -0,0 +1,194 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "HungarianAlgorithm.hpp"
+#include "TreeGenerator.hpp"
+#include "TreeLoader.hpp"
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Tree shapes of the tree benchmarks as {branching factor, depth}.
+static void treeShapes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"branching", "depth"});
+  for (int depth : {2, 4, 6, 8}) benchmark->Args({2, depth});
+  for (int depth : {2, 3, 4, 5}) benchmark->Args({4, depth});
+  for (int depth : {2, 3}) benchmark->Args({8, depth});
+  benchmark->Args({16, 2});
+}
+
+// Same as above, with the similarity type as third argument: 0 for "cosine",
+// 1 for "euclidean".
+static void treeShapesAndSimilarities(
+    benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"branching", "depth", "euclidean"});
+  for (int similarity : {0, 1}) {
+    for (int depth : {2, 4, 6}) benchmark->Args({2, depth, similarity});
+    for (int depth : {2, 3, 4}) benchmark->Args({4, depth, similarity});
+    benchmark->Args({8, 3, similarity});
+  }
+}
+
+static std::string similarityType(int64_t arg) {
+  return arg == 0 ? "cosine" : "euclidean";
+}
+
+// Generator of complete trees of the branching factor and depth of the
+// benchmark, seeded so that every run times the same trees.
+static TreeGenerator<float> treeGenerator(const benchmark::State& state) {
+  TreeGeneratorOptions options;
+  options.maxDepth = state.range(1);
+  options.minBranching = state.range(0);
+  options.maxBranching = state.range(0);
+  options.numNodes = 1;
+  for (int level = 0, levelSize = 1; level < options.maxDepth; level++) {
+    levelSize *= options.maxBranching;
+    options.numNodes += levelSize;
+  }
+  return TreeGenerator<float>(options);
+}
+
+static TreeWrapper<float> generateTree(const benchmark::State& state) {
+  return treeGenerator(state).generateTree();
+}
+
+// Tree of the benchmark and the same tree as observed in the next frame.
+static std::pair<TreeWrapper<float>, TreeWrapper<float>> generateTreePair(
+    const benchmark::State& state) {
+  TreeGenerator<float> generator = treeGenerator(state);
+  TreeWrapper<float> treeA = generator.generateTree();
+  TreeWrapper<float> treeB = generator.jitterTree(treeA);
+  return std::make_pair(std::move(treeA), std::move(treeB));
+}
+
+// Random cost matrix of size x size in [-1, 1], like the costs of
+// matchTrees with cosine similarity.
+static std::vector<std::vector<float>> generateCostMatrix(int size) {
+  std::mt19937 rng(size);
+  std::uniform_real_distribution<float> distCost(-1.0f, 1.0f);
+  std::vector<std::vector<float>> costMatrix(size, std::vector<float>(size));
+  for (std::vector<float>& row : costMatrix) {
+    for (float& cost : row) cost = distCost(rng);
+  }
+  return costMatrix;
+}
+
+static void BM_HungarianAlgorithm(benchmark::State& state) {
+  std::vector<std::vector<float>> costMatrix =
+      generateCostMatrix(state.range(0));
+  FrameArena arena;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(hungarianAlgorithm(costMatrix, arena));
+  }
+  state.SetComplexityN(state.range(0));
+}
+BENCHMARK(BM_HungarianAlgorithm)
+    ->ArgName("size")
+    ->RangeMultiplier(2)
+    ->Range(16, 1024)
+    ->Complexity(benchmark::oNCubed);
+
+static void BM_SortTree(benchmark::State& state) {
+  TreeWrapper<float> tree = generateTree(state);
+  TreeWrapper<float> sorted;
+  std::vector<int> sortedIndices;
+  FrameArena arena;
+  for (auto _ : state) {
+    sortTree(tree, sorted, sortedIndices, arena);
+    benchmark::DoNotOptimize(sorted.nodes.data());
+  }
+  state.counters["nodes"] = tree.nodes.size();
+}
+BENCHMARK(BM_SortTree)->Apply(treeShapes);
+
+static void BM_GenerateTreePreservingEmbedding(benchmark::State& state) {
+  TreeWrapper<float> tree = generateTree(state);
+  TreeEmbedding<float> embedding;
+  for (auto _ : state) {
+    generateTreePreservingEmbedding(tree, embedding);
+    benchmark::DoNotOptimize(embedding.tpeX.data());
+  }
+  state.counters["nodes"] = tree.nodes.size();
+}
+BENCHMARK(BM_GenerateTreePreservingEmbedding)->Apply(treeShapes);
+
+static void BM_GenerateFeatureVectors(benchmark::State& state) {
+  TreeWrapper<float> tree = generateTree(state);
+  generateTreePreservingEmbedding(tree);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(generateFeatureVectors(tree));
+  }
+  state.counters["nodes"] = tree.nodes.size();
+}
+BENCHMARK(BM_GenerateFeatureVectors)->Apply(treeShapes);
+
+static void BM_CreateSimilarityMatrix(benchmark::State& state) {
+  std::pair<TreeWrapper<float>, TreeWrapper<float>> trees =
+      generateTreePair(state);
+  TreeWrapper<float>& treeA = trees.first;
+  TreeWrapper<float>& treeB = trees.second;
+  generateTreePreservingEmbedding(treeA);
+  generateTreePreservingEmbedding(treeB);
+  std::vector<std::vector<float>> featuresA = generateFeatureVectors(treeA);
+  std::vector<std::vector<float>> featuresB = generateFeatureVectors(treeB);
+  std::string similarity = similarityType(state.range(2));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        createSimilarityMatrix(featuresA, featuresB, similarity));
+  }
+  state.counters["nodes"] = treeA.nodes.size();
+}
+BENCHMARK(BM_CreateSimilarityMatrix)->Apply(treeShapesAndSimilarities);
+
+static void BM_SaveTreeToJson(benchmark::State& state) {
+  TreeWrapper<float> tree = generateTree(state);
+  std::string filename = "benchmark_save_tree.json";
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(saveTreeToJson(tree, filename, true));
+  }
+  std::remove(filename.c_str());
+  state.counters["nodes"] = tree.nodes.size();
+}
+BENCHMARK(BM_SaveTreeToJson)->Apply(treeShapes);
+
+static void BM_LoadTreeFromJson(benchmark::State& state) {
+  TreeWrapper<float> tree = generateTree(state);
+  std::string filename = "benchmark_load_tree.json";
+  saveTreeToJson(tree, filename, true);
+  TreeWrapper<float> loaded;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(loadTreeFromJson(loaded, filename));
+  }
+  std::remove(filename.c_str());
+  state.counters["nodes"] = tree.nodes.size();
+}
+BENCHMARK(BM_LoadTreeFromJson)->Apply(treeShapes);
+
+static void BM_MatchTrees(benchmark::State& state) {
+  std::pair<TreeWrapper<float>, TreeWrapper<float>> trees =
+      generateTreePair(state);
+  TreeWrapper<float>& treeA = trees.first;
+  TreeWrapper<float>& treeB = trees.second;
+  std::string similarity = similarityType(state.range(2));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(matchTrees(treeA, treeB, similarity));
+  }
+  state.counters["nodes"] = treeA.nodes.size();
+}
+BENCHMARK(BM_MatchTrees)->Apply(treeShapesAndSimilarities);
+
+int main(int argc, char** argv) {
+  if (kDebug) {
+    std::printf(
+        "warning: matchTrees prints its intermediate results, configure "
+        "with -DTREE_MATCHING_DEBUG=OFF for meaningful timings\n");
+  }
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
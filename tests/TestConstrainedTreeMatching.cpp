@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <chrono>
+#include <iostream>
+
+#include "ConstrainedTreeMatching.hpp"
+#include "ThreadPool.hpp"
+#include "TreeGenerator.hpp"
+#include "TreeMatching.hpp"
+#include "TreeMatchingTestHelper.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Maximum number of nodes on one level of tree.
+int computeMaxLevelWidth(const TreeWrapper<float>& tree) {
+  int maxWidth = 0;
+  std::vector<int> level(1, 0);
+  std::vector<int> nextLevel;
+  while (!level.empty()) {
+    maxWidth = std::max<int>(maxWidth, level.size());
+    nextLevel.clear();
+    for (int idx : level) {
+      const std::vector<int>& children = tree.nodes[idx].children;
+      nextLevel.insert(nextLevel.end(), children.begin(), children.end());
+    }
+    level.swap(nextLevel);
+  }
+  return maxWidth;
+}
+
+int main(int argc, char* argv[]) {
+  argparse::ArgumentParser parser("constrained_tree_matching");
+  parser.add_argument("--num-nodes")
+      .default_value(2000)
+      .scan<'i', int>()
+      .help("number of nodes of the generated trees");
+  parser.add_argument("--max-branching")
+      .default_value(4)
+      .scan<'i', int>()
+      .help("maximum number of children of a generated node");
+  parser.add_argument("--seed")
+      .default_value(1)
+      .scan<'i', int>()
+      .help("seed of the tree generator");
+  parser.add_argument("--similarity")
+      .default_value("cosine")
+      .help("similarity method: cosine or euclidean");
+  parser.add_argument("--threads")
+      .default_value(4)
+      .scan<'i', int>()
+      .help("number of workers of the pool the levels are solved on");
+
+  try {
+    parser.parse_args(argc, argv);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  int numNodes = parser.get<int>("--num-nodes");
+  int maxBranching = parser.get<int>("--max-branching");
+  int seed = parser.get<int>("--seed");
+  std::string similarity = parser.get<std::string>("--similarity");
+  int numThreads = parser.get<int>("--threads");
+  if (numNodes < 1 || maxBranching < 1 || numThreads < 1) {
+    std::cerr << "--num-nodes, --max-branching and --threads must be positive"
+              << std::endl;
+    return -2;
+  }
+
+  // Tree B is tree A with jittered positions, so every node of A has a known
+  // counterpart in B. The generated trees are wide, so that the levels are
+  // split into several tasks.
+  TreeGeneratorOptions options;
+  options.numNodes = numNodes;
+  options.maxBranching = maxBranching;
+  options.seed = seed;
+  TreeGenerator<float> generator(options);
+  TreeWrapper<float> treeA = generator.generateTree();
+  TreeWrapper<float> treeB = generator.jitterTree(treeA);
+
+  std::vector<int> sortedTreeAIndices, sortedTreeBIndices;
+  TreeWrapper<float> sortedTreeA, sortedTreeB;
+  sortTree(treeA, sortedTreeA, sortedTreeAIndices);
+  sortTree(treeB, sortedTreeB, sortedTreeBIndices);
+
+  // The timings include the TPE and the feature vectors, which both matchers
+  // compute, but not the debug output of matchTrees.
+  debugOutputEnabled() = false;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  TreeEmbedding<float> embeddingA, embeddingB;
+  std::vector<int> exactMatching = matchTrees(
+      sortedTreeA, sortedTreeB, embeddingA, embeddingB, similarity);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto exactDuration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+  // Wide levels are split into tasks on the pool, the result must not depend
+  // on the number of workers.
+  ThreadPool pool(numThreads);
+  start = std::chrono::high_resolution_clock::now();
+  std::vector<int> constrainedMatching =
+      matchTreesConstrained(sortedTreeA, sortedTreeB, similarity, pool);
+  end = std::chrono::high_resolution_clock::now();
+  auto constrainedDuration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+  ThreadPool serialPool(1);
+  bool deterministic =
+      matchTreesConstrained(sortedTreeA, sortedTreeB, similarity,
+                            serialPool) == constrainedMatching;
+
+  // Both matchings are rated by the cost matrix of matchTrees.
+  std::vector<std::vector<float>> costMatrix =
+      convertSimilarityMatrix2CostMatrix(createSimilarityMatrix(
+          generateFeatureVectors(sortedTreeA, embeddingA),
+          generateFeatureVectors(sortedTreeB, embeddingB), similarity));
+
+  int exactMatched = 0;
+  int constrainedMatched = 0;
+  for (size_t i = 0; i < exactMatching.size(); ++i) {
+    if (exactMatching[i] >= 0) ++exactMatched;
+    if (constrainedMatching[i] >= 0) ++constrainedMatched;
+  }
+
+  std::cout << "Trees of " << numNodes << " nodes, widest level "
+            << computeMaxLevelWidth(sortedTreeA) << " nodes, similarity "
+            << similarity << ", " << numThreads << " threads" << std::endl;
+  std::cout << "matchTrees: " << exactDuration.count() << " us, cost "
+            << computeMatchingCost(exactMatching, costMatrix) << ", matched "
+            << exactMatched << ", correct "
+            << countCorrectMatches(exactMatching, sortedTreeAIndices,
+                                   sortedTreeBIndices)
+            << ", parent-consistent "
+            << countParentConsistentMatches(exactMatching, sortedTreeA,
+                                            sortedTreeB)
+            << std::endl;
+  std::cout << "matchTreesConstrained: " << constrainedDuration.count()
+            << " us, cost "
+            << computeMatchingCost(constrainedMatching, costMatrix)
+            << ", matched " << constrainedMatched << ", correct "
+            << countCorrectMatches(constrainedMatching, sortedTreeAIndices,
+                                   sortedTreeBIndices)
+            << ", parent-consistent "
+            << countParentConsistentMatches(constrainedMatching, sortedTreeA,
+                                            sortedTreeB)
+            << std::endl;
+  std::cout << "Same result on 1 and " << numThreads
+            << " threads: " << (deterministic ? "yes" : "no") << std::endl;
+
+  return deterministic ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <chrono>
+#include <iostream>
+
+#include "HierarchicalTreeMatching.hpp"
+#include "TreeMatching.hpp"
+#include "TreeMatchingTestHelper.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Match generated tree pairs that fit into one subproblem, whose hierarchical
+// matching must be the matchTrees result. Returns the number of differing
+// matchings.
+int checkSmallTrees(int numTrees, int maxSubproblemSize, int seed,
+                    const std::string& similarity) {
+  int numDiffering = 0;
+  for (int t = 0; t < numTrees; ++t) {
+    int numNodes = 1 + t * (maxSubproblemSize - 1) / std::max(1, numTrees - 1);
+    TreeWrapper<float> treeA =
+        generateTreeA<float>(generateTreeStructure(numNodes, seed + t));
+    TreeWrapper<float> treeB = generateTreeB<float>(treeA);
+    std::vector<int> sortedTreeAIndices, sortedTreeBIndices;
+    TreeWrapper<float> sortedTreeA, sortedTreeB;
+    sortTree(treeA, sortedTreeA, sortedTreeAIndices);
+    sortTree(treeB, sortedTreeB, sortedTreeBIndices);
+
+    TreeEmbedding<float> embeddingA, embeddingB;
+    if (matchTreesHierarchical(sortedTreeA, sortedTreeB, similarity,
+                               maxSubproblemSize) !=
+        matchTrees(sortedTreeA, sortedTreeB, embeddingA, embeddingB,
+                   similarity)) {
+      ++numDiffering;
+    }
+  }
+  return numDiffering;
+}
+
+int main(int argc, char* argv[]) {
+  argparse::ArgumentParser parser("hierarchical_tree_matching");
+  parser.add_argument("--num-nodes")
+      .default_value(1000)
+      .scan<'i', int>()
+      .help("number of nodes of the generated trees");
+  parser.add_argument("--seed")
+      .default_value(1)
+      .scan<'i', int>()
+      .help("seed of the generated tree structure");
+  parser.add_argument("--similarity")
+      .default_value("cosine")
+      .help("similarity method: cosine or euclidean");
+  parser.add_argument("--max-subproblem-size")
+      .default_value(128)
+      .scan<'i', int>()
+      .help("maximum number of nodes of a subtree pair solved on its own");
+
+  try {
+    parser.parse_args(argc, argv);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  int numNodes = parser.get<int>("--num-nodes");
+  int seed = parser.get<int>("--seed");
+  std::string similarity = parser.get<std::string>("--similarity");
+  int maxSubproblemSize = parser.get<int>("--max-subproblem-size");
+  if (numNodes < 1 || maxSubproblemSize < 1) {
+    std::cerr << "--num-nodes and --max-subproblem-size must be positive"
+              << std::endl;
+    return -2;
+  }
+
+  // Tree B has the structure of tree A with drifted positions, so every node
+  // of A has a known counterpart in B.
+  TreeWrapper<float> treeA =
+      generateTreeA<float>(generateTreeStructure(numNodes, seed));
+  TreeWrapper<float> treeB = generateTreeB<float>(treeA);
+
+  std::vector<int> sortedTreeAIndices, sortedTreeBIndices;
+  TreeWrapper<float> sortedTreeA, sortedTreeB;
+  sortTree(treeA, sortedTreeA, sortedTreeAIndices);
+  sortTree(treeB, sortedTreeB, sortedTreeBIndices);
+
+  // The timings include the TPE and the feature vectors, which both matchers
+  // compute, but not the debug output of matchTrees.
+  debugOutputEnabled() = false;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  TreeEmbedding<float> embeddingA, embeddingB;
+  std::vector<int> exactMatching = matchTrees(
+      sortedTreeA, sortedTreeB, embeddingA, embeddingB, similarity);
+  auto end = std::chrono::high_resolution_clock::now();
+  auto exactDuration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+  start = std::chrono::high_resolution_clock::now();
+  std::vector<int> hierarchicalMatching = matchTreesHierarchical(
+      sortedTreeA, sortedTreeB, similarity, maxSubproblemSize);
+  end = std::chrono::high_resolution_clock::now();
+  auto hierarchicalDuration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+  // Both matchings are rated by the cost matrix of matchTrees.
+  std::vector<std::vector<float>> costMatrix =
+      convertSimilarityMatrix2CostMatrix(createSimilarityMatrix(
+          generateFeatureVectors(sortedTreeA, embeddingA),
+          generateFeatureVectors(sortedTreeB, embeddingB), similarity));
+  float exactCost = computeMatchingCost(exactMatching, costMatrix);
+  float hierarchicalCost =
+      computeMatchingCost(hierarchicalMatching, costMatrix);
+
+  int agreeing = 0;
+  for (size_t i = 0; i < exactMatching.size(); ++i) {
+    if (hierarchicalMatching[i] == exactMatching[i]) ++agreeing;
+  }
+
+  std::cout << "Trees of " << numNodes << " nodes, similarity " << similarity
+            << ", max subproblem size " << maxSubproblemSize << std::endl;
+  std::cout << "matchTrees: " << exactDuration.count() << " us, cost "
+            << exactCost << ", correct "
+            << countCorrectMatches(exactMatching, sortedTreeAIndices,
+                                   sortedTreeBIndices)
+            << "/" << numNodes << std::endl;
+  std::cout << "matchTreesHierarchical: " << hierarchicalDuration.count()
+            << " us, cost " << hierarchicalCost << ", correct "
+            << countCorrectMatches(hierarchicalMatching, sortedTreeAIndices,
+                                   sortedTreeBIndices)
+            << "/" << numNodes << std::endl;
+  double speedup = double(exactDuration.count()) /
+                   std::max<long long>(1, hierarchicalDuration.count());
+  std::cout << "Speedup " << speedup << "x, cost difference "
+            << hierarchicalCost - exactCost
+            << ", matchings agree on " << agreeing << "/" << numNodes
+            << " nodes" << std::endl;
+
+  int numSmallTrees = 20;
+  int numSmallDiffering =
+      checkSmallTrees(numSmallTrees, maxSubproblemSize, seed, similarity);
+  std::cout << "Trees of at most " << maxSubproblemSize
+            << " nodes: " << numSmallDiffering << "/" << numSmallTrees
+            << " matchings differing from matchTrees" << std::endl;
+
+  return numSmallDiffering == 0 ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 
 #include "HungarianAlgorithm.hpp"
+#include "KBestAssignment.hpp"
 
 int main() {
   std::vector<std::vector<float>> cost = {
@@ -16,5 +17,24 @@ int main() {
     std::cout << "  Row " << i << " -> Column " << assignment[i] << "\n";
   }
 
+  // Rows may stay unmatched at a cost of 3.
+  auto thresholded = hungarianAlgorithmWithUnmatched(cost, 3.0f);
+  std::cout << "Total minimum cost with unmatched cost 3: "
+            << thresholded.first << "\n";
+  std::cout << "Assignments (row -> column, -1 unmatched):\n";
+  for (size_t i = 0; i < thresholded.second.size(); ++i) {
+    std::cout << "  Row " << i << " -> Column " << thresholded.second[i]
+              << "\n";
+  }
+
+  // The three assignments of lowest cost.
+  auto kBest = kBestAssignments(cost, 3);
+  for (size_t k = 0; k < kBest.size(); ++k) {
+    std::cout << "Assignment " << k + 1 << " of cost " << kBest[k].first
+              << ":";
+    for (int column : kBest[k].second) std::cout << " " << column;
+    std::cout << "\n";
+  }
+
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include <argparse/argparse.hpp>
+#include <iostream>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "FeatureNormalizer.hpp"
+#include "IncrementalCostMatrix.hpp"
+#include "TreeGenerator.hpp"
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+// Feature vectors of every frame, all normalized with the bounds of the first
+// frame, so that the vectors of unchanged nodes are identical across frames.
+std::vector<std::vector<std::vector<float>>> generateFrameFeatures(
+    const TreeGeneratorOptions& options, int numFrames) {
+  TreeGenerator<float> generator(options);
+  std::list<TreeWrapper<float>> frames = generator.generateSequence(numFrames);
+  FeatureNormalizer<float> normalizer;
+  std::vector<std::vector<std::vector<float>>> frameFeatures;
+  for (const TreeWrapper<float>& frame : frames) {
+    std::vector<int> sortedIndices;
+    TreeWrapper<float> sorted;
+    sortTree(frame, sorted, sortedIndices);
+    TreeEmbedding<float> embedding;
+    generateTreePreservingEmbedding(sorted, embedding);
+    frameFeatures.emplace_back();
+    normalizer.generateFeatureVectors(sorted, embedding, frameFeatures.back());
+    normalizer.freeze();
+  }
+  return frameFeatures;
+}
+
+// Feed the frames through matrix as consecutive (rows, columns) pairs and
+// count the cost matrices differing from the one computed from scratch. Each
+// pair is set twice, the second time nothing changed and no cell may be
+// recomputed. recomputedCells and totalCells sum up the first updates.
+int checkSequence(
+    const std::vector<std::vector<std::vector<float>>>& frameFeatures,
+    const std::string& similarity, size_t& recomputedCells,
+    size_t& totalCells, int& numStaticRecomputed) {
+  IncrementalCostMatrix<float> matrix(similarity);
+  int numDiffering = 0;
+  recomputedCells = 0;
+  totalCells = 0;
+  numStaticRecomputed = 0;
+  for (size_t t = 1; t < frameFeatures.size(); ++t) {
+    std::vector<std::vector<float>> expected =
+        convertSimilarityMatrix2CostMatrix(createSimilarityMatrix(
+            frameFeatures[t - 1], frameFeatures[t], similarity));
+
+    matrix.setRows(frameFeatures[t - 1]);
+    matrix.setColumns(frameFeatures[t]);
+    if (matrix.costMatrix() != expected) ++numDiffering;
+    if (t > 1) {
+      recomputedCells += matrix.numRecomputedCells();
+      totalCells += expected.size() * expected[0].size();
+    }
+
+    matrix.setRows(frameFeatures[t - 1]);
+    matrix.setColumns(frameFeatures[t]);
+    if (matrix.costMatrix() != expected) ++numDiffering;
+    if (matrix.numRecomputedCells() != 0) ++numStaticRecomputed;
+  }
+  return numDiffering;
+}
+
+int main(int argc, char* argv[]) {
+  argparse::ArgumentParser parser("incremental_cost_matrix");
+  parser.add_argument("--num-nodes")
+      .default_value(300)
+      .scan<'i', int>()
+      .help("number of nodes of the first generated tree");
+  parser.add_argument("--frames")
+      .default_value(8)
+      .scan<'i', int>()
+      .help("number of frames of the generated sequences");
+  parser.add_argument("--seed")
+      .default_value(1)
+      .scan<'i', int>()
+      .help("seed of the tree generator");
+  parser.add_argument("--similarity")
+      .default_value("cosine")
+      .help("similarity method: cosine or euclidean");
+
+  try {
+    parser.parse_args(argc, argv);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  int numNodes = parser.get<int>("--num-nodes");
+  int numFrames = parser.get<int>("--frames");
+  int seed = parser.get<int>("--seed");
+  std::string similarity = parser.get<std::string>("--similarity");
+  if (numNodes < 1 || numFrames < 3) {
+    std::cerr << "--num-nodes must be positive and --frames at least 3"
+              << std::endl;
+    return -2;
+  }
+
+  TreeGeneratorOptions options;
+  options.numNodes = numNodes;
+  options.insertionRate = 0.02f;
+  options.deletionRate = 0.02f;
+  options.seed = seed;
+  bool ok = true;
+
+  // Jittered frames: every node moves, the result must still be exact.
+  size_t recomputedCells, totalCells;
+  int numStaticRecomputed;
+  int numDiffering =
+      checkSequence(generateFrameFeatures(options, numFrames), similarity,
+                    recomputedCells, totalCells, numStaticRecomputed);
+  std::cout << "Jittered frames: " << numDiffering
+            << " cost matrices differing, " << recomputedCells << "/"
+            << totalCells << " cells recomputed, " << numStaticRecomputed
+            << " unchanged updates recomputing cells" << std::endl;
+  ok = ok && numDiffering == 0 && numStaticRecomputed == 0;
+
+  // Frames that only differ by inserted and deleted leaves: most rows and
+  // columns keep their cells.
+  options.jitterScale = 0.0f;
+  options.angleJitterDegrees = 0.0f;
+  numDiffering =
+      checkSequence(generateFrameFeatures(options, numFrames), similarity,
+                    recomputedCells, totalCells, numStaticRecomputed);
+  std::cout << "Static frames: " << numDiffering
+            << " cost matrices differing, " << recomputedCells << "/"
+            << totalCells << " cells recomputed, " << numStaticRecomputed
+            << " unchanged updates recomputing cells" << std::endl;
+  ok = ok && numDiffering == 0 && numStaticRecomputed == 0 &&
+       recomputedCells < totalCells;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,174 @@
+#include <argparse/argparse.hpp>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "HungarianAlgorithm.hpp"
+#include "SparseAssignment.hpp"
+#include "TreeGenerator.hpp"
+#include "TreeMatching.hpp"
+#include "TreeMatchingTestHelper.hpp"
+
+// Random costs in [0, 1) of which a fraction density are candidates, every
+// pair for density 1. The other cells of costMatrix cost more than leaving a
+// row unmatched at unmatchedCost, so the dense solver never picks them.
+CandidateGraph<float> generateCandidates(
+    int numRows, int numCols, double density, float unmatchedCost,
+    std::mt19937& rng, std::vector<std::vector<float>>& costMatrix) {
+  std::uniform_real_distribution<float> cost(0.0f, 1.0f);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  CandidateGraph<float> candidates;
+  costMatrix.assign(numRows,
+                    std::vector<float>(numCols, 2.0f * unmatchedCost + 1.0f));
+  candidates.rowStart.push_back(0);
+  for (int i = 0; i < numRows; ++i) {
+    for (int j = 0; j < numCols; ++j) {
+      if (density < 1.0 && unit(rng) >= density) continue;
+      costMatrix[i][j] = cost(rng);
+      candidates.columns.push_back(j);
+      candidates.costs.push_back(costMatrix[i][j]);
+    }
+    candidates.rowStart.push_back(candidates.columns.size());
+  }
+  return candidates;
+}
+
+// Compare sparseAssignment and sparseAssignmentByComponents with
+// hungarianAlgorithmWithUnmatched on random problems. Returns the number of
+// problems with a different optimal cost.
+int checkAgainstDense(int numProblems, double density, unsigned int seed) {
+  const float unmatchedCost = 0.8f;
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> size(1, 60);
+  int numDiffering = 0;
+  for (int p = 0; p < numProblems; ++p) {
+    int numRows = size(rng);
+    int numCols = size(rng);
+    std::vector<std::vector<float>> costMatrix;
+    CandidateGraph<float> candidates = generateCandidates(
+        numRows, numCols, density, unmatchedCost, rng, costMatrix);
+
+    float denseCost =
+        hungarianAlgorithmWithUnmatched(costMatrix, unmatchedCost).first;
+    float sparseCost =
+        sparseAssignment(candidates, numCols, unmatchedCost).first;
+    float componentsCost =
+        sparseAssignmentByComponents(candidates, numCols, unmatchedCost)
+            .first;
+    float tolerance = 1e-4f * numRows;
+    if (std::abs(sparseCost - denseCost) > tolerance ||
+        std::abs(componentsCost - denseCost) > tolerance) {
+      ++numDiffering;
+    }
+  }
+  return numDiffering;
+}
+
+int main(int argc, char* argv[]) {
+  argparse::ArgumentParser parser("sparse_assignment");
+  parser.add_argument("--num-nodes")
+      .default_value(1000)
+      .scan<'i', int>()
+      .help("number of nodes of the generated trees");
+  parser.add_argument("--seed")
+      .default_value(1)
+      .scan<'i', int>()
+      .help("seed of the random problems and of the tree generator");
+  parser.add_argument("--similarity")
+      .default_value("cosine")
+      .help("similarity method: cosine or euclidean");
+
+  try {
+    parser.parse_args(argc, argv);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  int numNodes = parser.get<int>("--num-nodes");
+  int seed = parser.get<int>("--seed");
+  std::string similarity = parser.get<std::string>("--similarity");
+  if (numNodes < 1) {
+    std::cerr << "--num-nodes must be positive" << std::endl;
+    return -2;
+  }
+
+  // The sparse solvers must be exact on their candidates: on a complete
+  // candidate graph, and on sparse graphs that fall apart into components.
+  int numProblems = 200;
+  int completeDiffering = checkAgainstDense(numProblems, 1.0, seed);
+  int sparseDiffering = checkAgainstDense(numProblems, 0.05, seed + 1);
+  std::cout << "Complete candidate graphs: " << completeDiffering << "/"
+            << numProblems << " costs differing from the dense solver"
+            << std::endl;
+  std::cout << "Sparse candidate graphs: " << sparseDiffering << "/"
+            << numProblems << " costs differing from the dense solver"
+            << std::endl;
+
+  // Quality and speed of matchTrees as the candidates are restricted, against
+  // the exact matchTrees.
+  TreeGeneratorOptions options;
+  options.numNodes = numNodes;
+  options.seed = seed;
+  TreeGenerator<float> generator(options);
+  TreeWrapper<float> treeA = generator.generateTree();
+  TreeWrapper<float> treeB = generator.jitterTree(treeA);
+  std::vector<int> sortedTreeAIndices, sortedTreeBIndices;
+  TreeWrapper<float> sortedTreeA, sortedTreeB;
+  sortTree(treeA, sortedTreeA, sortedTreeAIndices);
+  sortTree(treeB, sortedTreeB, sortedTreeBIndices);
+
+  debugOutputEnabled() = false;
+
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<int> exactMatching =
+      matchTrees(sortedTreeA, sortedTreeB, similarity);
+  auto end = std::chrono::high_resolution_clock::now();
+  std::cout << "Trees of " << numNodes << " nodes, similarity " << similarity
+            << ", matchTrees: "
+            << std::chrono::duration_cast<std::chrono::microseconds>(end -
+                                                                     start)
+                   .count()
+            << " us, correct "
+            << countCorrectMatches(exactMatching, sortedTreeAIndices,
+                                   sortedTreeBIndices)
+            << "/" << exactMatching.size() << std::endl;
+
+  const float inf = std::numeric_limits<float>::infinity();
+  for (float radius : {inf, 40.0f, 20.0f, 10.0f}) {
+    for (size_t k : {0, 1, 4, 16}) {
+      if (k == 0 && radius == inf) continue;
+      TreeMatchingOptions<float> sparseOptions;
+      sparseOptions.similarityType = similarity;
+      sparseOptions.candidateK = k;
+      sparseOptions.gatingRadius = radius;
+
+      start = std::chrono::high_resolution_clock::now();
+      std::vector<int> matching =
+          matchTrees(sortedTreeA, sortedTreeB, sparseOptions);
+      end = std::chrono::high_resolution_clock::now();
+
+      int agreeing = 0;
+      int matched = 0;
+      for (size_t i = 0; i < matching.size(); ++i) {
+        if (matching[i] == exactMatching[i]) ++agreeing;
+        if (matching[i] >= 0) ++matched;
+      }
+      std::cout << "candidateK " << k << ", gatingRadius " << radius << ": "
+                << std::chrono::duration_cast<std::chrono::microseconds>(
+                       end - start)
+                       .count()
+                << " us, matched " << matched << ", agree with matchTrees "
+                << agreeing << "/" << matching.size() << ", correct "
+                << countCorrectMatches(matching, sortedTreeAIndices,
+                                       sortedTreeBIndices)
+                << std::endl;
+    }
+  }
+
+  return completeDiffering == 0 && sparseDiffering == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include <argparse/argparse.hpp>
+#include <chrono>
+#include <iostream>
+
+#include "HungarianAlgorithm.hpp"
+#include "TreeAlignment.hpp"
+#include "TreeMatching.hpp"
+#include "TreeMatchingTestHelper.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+int main(int argc, char* argv[]) {
+  argparse::ArgumentParser parser("tree_alignment");
+  parser.add_argument("--num-nodes")
+      .default_value(200)
+      .scan<'i', int>()
+      .help("number of nodes of the generated trees");
+  parser.add_argument("--seed")
+      .default_value(1)
+      .scan<'i', int>()
+      .help("seed of the generated tree structure");
+  parser.add_argument("--similarity")
+      .default_value("cosine")
+      .help("similarity method: cosine or euclidean");
+  parser.add_argument("--indel-cost")
+      .default_value(1.0f)
+      .scan<'g', float>()
+      .help("cost of an unaligned node");
+
+  try {
+    parser.parse_args(argc, argv);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  int numNodes = parser.get<int>("--num-nodes");
+  int seed = parser.get<int>("--seed");
+  std::string similarity = parser.get<std::string>("--similarity");
+  float indelCost = parser.get<float>("--indel-cost");
+  if (numNodes < 1) {
+    std::cerr << "--num-nodes must be positive" << std::endl;
+    return -2;
+  }
+
+  // Tree B has the structure of tree A with drifted positions, so every node
+  // of A has a known counterpart in B.
+  TreeWrapper<float> treeA =
+      generateTreeA<float>(generateTreeStructure(numNodes, seed));
+  TreeWrapper<float> treeB = generateTreeB<float>(treeA);
+
+  std::vector<int> sortedTreeAIndices, sortedTreeBIndices;
+  TreeWrapper<float> sortedTreeA, sortedTreeB;
+  sortTree(treeA, sortedTreeA, sortedTreeAIndices);
+  sortTree(treeB, sortedTreeB, sortedTreeBIndices);
+
+  // Both matchers work on the same feature vectors.
+  debugOutputEnabled() = false;
+  TreeEmbedding<float> embeddingA, embeddingB;
+  std::vector<std::vector<float>> featuresA, featuresB;
+  generatePairFeatures(sortedTreeA, sortedTreeB, embeddingA, embeddingB,
+                       featuresA, featuresB);
+
+  // Hungarian matching as matchTrees computes it, without its debug output.
+  auto start = std::chrono::high_resolution_clock::now();
+  std::vector<std::vector<float>> costMatrix =
+      convertSimilarityMatrix2CostMatrix(
+          createSimilarityMatrix(featuresA, featuresB, similarity));
+  std::vector<int> hungarianMatching = hungarianAlgorithm(costMatrix).second;
+  auto end = std::chrono::high_resolution_clock::now();
+  auto hungarianDuration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+  // Ordered tree alignment.
+  start = std::chrono::high_resolution_clock::now();
+  std::vector<float> relabelCosts =
+      createRelabelCosts(featuresA, featuresB, similarity);
+  std::vector<float> deleteCosts(sortedTreeA.nodes.size(), indelCost);
+  std::vector<float> insertCosts(sortedTreeB.nodes.size(), indelCost);
+  TreeAlignmentResult<float> alignment = alignTrees(
+      sortedTreeA, sortedTreeB, relabelCosts, deleteCosts, insertCosts);
+  end = std::chrono::high_resolution_clock::now();
+  auto alignmentDuration =
+      std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+
+  int agreeing = 0;
+  int alignedNodes = 0;
+  for (size_t i = 0; i < alignment.matching.size(); ++i) {
+    if (alignment.matching[i] >= 0) ++alignedNodes;
+    if (alignment.matching[i] == hungarianMatching[i]) ++agreeing;
+  }
+
+  std::cout << "Trees of " << numNodes << " nodes, similarity " << similarity
+            << ", indel cost " << indelCost << std::endl;
+  std::cout << "matchTrees (Hungarian): " << hungarianDuration.count()
+            << " us, correct "
+            << countCorrectMatches(hungarianMatching, sortedTreeAIndices,
+                                   sortedTreeBIndices)
+            << "/" << numNodes << ", parent-consistent "
+            << countParentConsistentMatches(hungarianMatching, sortedTreeA,
+                                            sortedTreeB)
+            << std::endl;
+  // The roots are aligned, and every other aligned node has its parent
+  // aligned with the parent of its counterpart.
+  int parentConsistent = countParentConsistentMatches(
+      alignment.matching, sortedTreeA, sortedTreeB);
+  bool structureOk =
+      alignment.matching[0] == 0 && parentConsistent == alignedNodes - 1;
+  std::cout << "Tree alignment: " << alignmentDuration.count()
+            << " us, cost " << alignment.cost << ", aligned " << alignedNodes
+            << ", correct "
+            << countCorrectMatches(alignment.matching, sortedTreeAIndices,
+                                   sortedTreeBIndices)
+            << "/" << numNodes << ", parent-consistent " << parentConsistent
+            << ": " << (structureOk ? "ok" : "wrong") << std::endl;
+  std::cout << "Matchings agree on " << agreeing << "/" << numNodes
+            << " nodes" << std::endl;
+
+  return structureOk ? 0 : 1;
+}
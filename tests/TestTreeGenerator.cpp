@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <argparse/argparse.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <string>
+
+#include "TreeGenerator.hpp"
+#include "TreeLoader.hpp"
+
+// Whether both sequences are bit-identical, TPE fields aside.
+bool identicalSequences(const std::list<TreeWrapper<float>>& framesA,
+                        const std::list<TreeWrapper<float>>& framesB) {
+  if (framesA.size() != framesB.size()) return false;
+  auto itB = framesB.begin();
+  for (const TreeWrapper<float>& frameA : framesA) {
+    const TreeWrapper<float>& frameB = *itB++;
+    if (frameA.timestamp != frameB.timestamp ||
+        frameA.nodes.size() != frameB.nodes.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < frameA.nodes.size(); ++i) {
+      const TreeNode<float>& nodeA = frameA.nodes[i];
+      const TreeNode<float>& nodeB = frameB.nodes[i];
+      const float valuesA[] = {nodeA.posX, nodeA.posY, nodeA.offset,
+                               nodeA.angle};
+      const float valuesB[] = {nodeB.posX, nodeB.posY, nodeB.offset,
+                               nodeB.angle};
+      if (std::memcmp(valuesA, valuesB, sizeof(valuesA)) != 0 ||
+          nodeA.type != nodeB.type || nodeA.parent != nodeB.parent ||
+          nodeA.children != nodeB.children) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Whether value, restored from a recording with quantization step step, lies
+// within half a step of original, up to the rounding of float.
+bool withinStep(float value, float original, double step) {
+  return std::abs(double(value) - original) <=
+         0.5 * step + 1e-6 * std::abs(original);
+}
+
+// Save frames to a recording in filename and check that loading it restores
+// the topology and the values within the quantization steps, and that every
+// frame is found by seeking its timestamp.
+bool checkRecordingRoundTrip(const std::list<TreeWrapper<float>>& frames,
+                             const std::string& filename) {
+  TreeRecordingOptions options;
+  // Small blocks, so that seeking has to pick the right one.
+  options.framesPerBlock = 4;
+  if (!saveTreesToRecording(frames, filename, options)) return false;
+
+  std::list<TreeWrapper<float>> loaded;
+  if (!loadTreesFromRecording(loaded, filename) ||
+      loaded.size() != frames.size()) {
+    return false;
+  }
+  auto itLoaded = loaded.begin();
+  for (const TreeWrapper<float>& frame : frames) {
+    const TreeWrapper<float>& loadedFrame = *itLoaded++;
+    if (loadedFrame.timestamp != frame.timestamp ||
+        loadedFrame.nodes.size() != frame.nodes.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < frame.nodes.size(); ++i) {
+      const TreeNode<float>& node = frame.nodes[i];
+      const TreeNode<float>& loadedNode = loadedFrame.nodes[i];
+      if (loadedNode.type != node.type || loadedNode.parent != node.parent ||
+          loadedNode.children != node.children ||
+          !withinStep(loadedNode.posX, node.posX, options.positionStep) ||
+          !withinStep(loadedNode.posY, node.posY, options.positionStep) ||
+          !withinStep(loadedNode.offset, node.offset, options.positionStep) ||
+          !withinStep(loadedNode.angle, node.angle, options.angleStep)) {
+        return false;
+      }
+    }
+  }
+
+  TreeRecordingReader<float> reader;
+  if (!reader.open(filename) || reader.numFrames() != frames.size()) {
+    return false;
+  }
+  TreeWrapper<float> seeked;
+  for (const TreeWrapper<float>& loadedFrame : loaded) {
+    if (!reader.seek(loadedFrame.timestamp, seeked) ||
+        !identicalSequences({seeked}, {loadedFrame})) {
+      return false;
+    }
+  }
+  // Nothing follows the last frame.
+  bool pastEnd = !loaded.empty() &&
+                 reader.seek(loaded.back().timestamp + 1, seeked);
+  reader.close();
+  std::remove(filename.c_str());
+  return !pastEnd;
+}
+
+int main(int argc, char* argv[]) {
+  argparse::ArgumentParser parser("tree_generator");
+  parser.add_argument("--num-nodes")
+      .default_value(100)
+      .scan<'i', int>()
+      .help("number of nodes of the first frame");
+  parser.add_argument("--depth")
+      .default_value(8)
+      .scan<'i', int>()
+      .help("maximum number of levels below the root");
+  parser.add_argument("--min-branching")
+      .default_value(1)
+      .scan<'i', int>()
+      .help("minimum number of children of an expanded node");
+  parser.add_argument("--max-branching")
+      .default_value(4)
+      .scan<'i', int>()
+      .help("maximum number of children of an expanded node");
+  parser.add_argument("--jitter")
+      .default_value(0.3f)
+      .scan<'g', float>()
+      .help("position jitter as a fraction of the distance to the parent");
+  parser.add_argument("--insertion-rate")
+      .default_value(0.0f)
+      .scan<'g', float>()
+      .help("expected fraction of nodes inserted per frame");
+  parser.add_argument("--deletion-rate")
+      .default_value(0.0f)
+      .scan<'g', float>()
+      .help("expected fraction of leaves deleted per frame");
+  parser.add_argument("--frames")
+      .default_value(10)
+      .scan<'i', int>()
+      .help("number of frames of the sequence");
+  parser.add_argument("--seed")
+      .default_value(1)
+      .scan<'i', int>()
+      .help("seed of the generator");
+  parser.add_argument("--output")
+      .default_value(std::string(""))
+      .help("file to save the sequence to, .json or a recording otherwise");
+
+  try {
+    parser.parse_args(argc, argv);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  TreeGeneratorOptions options;
+  options.numNodes = parser.get<int>("--num-nodes");
+  options.maxDepth = parser.get<int>("--depth");
+  options.minBranching = parser.get<int>("--min-branching");
+  options.maxBranching = parser.get<int>("--max-branching");
+  options.jitterScale = parser.get<float>("--jitter");
+  options.insertionRate = parser.get<float>("--insertion-rate");
+  options.deletionRate = parser.get<float>("--deletion-rate");
+  options.seed = parser.get<int>("--seed");
+  int numFrames = parser.get<int>("--frames");
+  std::string output = parser.get<std::string>("--output");
+
+  TreeGenerator<float> generator(options);
+  std::list<TreeWrapper<float>> frames = generator.generateSequence(numFrames);
+
+  // A second generator with the same seed must give the same sequence.
+  TreeGenerator<float> repeatGenerator(options);
+  bool reproducible =
+      identicalSequences(frames, repeatGenerator.generateSequence(numFrames));
+
+  size_t minNodes = frames.empty() ? 0 : frames.front().nodes.size();
+  size_t maxNodes = minNodes;
+  for (const TreeWrapper<float>& frame : frames) {
+    minNodes = std::min(minNodes, frame.nodes.size());
+    maxNodes = std::max(maxNodes, frame.nodes.size());
+  }
+  std::cout << "Generated " << frames.size() << " frames of " << minNodes
+            << " to " << maxNodes << " nodes with seed " << options.seed
+            << std::endl;
+  std::cout << "Reproducible: " << (reproducible ? "yes" : "no") << std::endl;
+
+  bool roundTrip =
+      checkRecordingRoundTrip(frames, "tree_generator_round_trip.trec");
+  std::cout << "Recording round trip and seek: " << (roundTrip ? "yes" : "no")
+            << std::endl;
+
+  if (!output.empty()) {
+    bool json = output.size() >= 5 &&
+                output.compare(output.size() - 5, 5, ".json") == 0;
+    bool saved = json ? saveTreesToJson(frames, output, true)
+                      : saveTreesToRecording(frames, output);
+    if (!saved) {
+      std::cerr << "failed to save " << output << std::endl;
+      return -2;
+    }
+    std::cout << "Saved to " << output << std::endl;
+  }
+
+  return reproducible && roundTrip ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+#include <argparse/argparse.hpp>
+#include <iostream>
+#include <iterator>
+#include <list>
+#include <string>
+#include <utility>
+
+#include "TreeGenerator.hpp"
+#include "TreeMatcher.hpp"
+#include "TreeMatching.hpp"
+#include "TreePreservingEmbedding.hpp"
+
+int main(int argc, char* argv[]) {
+  argparse::ArgumentParser parser("tree_matcher");
+  parser.add_argument("--num-nodes")
+      .default_value(300)
+      .scan<'i', int>()
+      .help("number of nodes of the first generated tree");
+  parser.add_argument("--frames")
+      .default_value(8)
+      .scan<'i', int>()
+      .help("number of frames of the generated sequence");
+  parser.add_argument("--seed")
+      .default_value(1)
+      .scan<'i', int>()
+      .help("seed of the tree generator");
+  parser.add_argument("--similarity")
+      .default_value("cosine")
+      .help("similarity method: cosine or euclidean");
+
+  try {
+    parser.parse_args(argc, argv);
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  int numNodes = parser.get<int>("--num-nodes");
+  int numFrames = parser.get<int>("--frames");
+  int seed = parser.get<int>("--seed");
+  std::string similarity = parser.get<std::string>("--similarity");
+  if (numNodes < 1 || numFrames < 2) {
+    std::cerr << "--num-nodes must be positive and --frames at least 2"
+              << std::endl;
+    return -2;
+  }
+
+  // Frames of one tree with inserted and deleted leaves, so that consecutive
+  // trees differ in size and node order.
+  TreeGeneratorOptions options;
+  options.numNodes = numNodes;
+  options.insertionRate = 0.05f;
+  options.deletionRate = 0.05f;
+  options.seed = seed;
+  TreeGenerator<float> generator(options);
+  std::list<TreeWrapper<float>> frames = generator.generateSequence(numFrames);
+  for (TreeWrapper<float>& frame : frames) {
+    std::vector<int> sortedIndices;
+    TreeWrapper<float> sorted;
+    sortTree(frame, sorted, sortedIndices);
+    frame = std::move(sorted);
+  }
+
+  debugOutputEnabled() = false;
+
+  // Every tree but the first and the last is matched twice, as treeB and then
+  // as treeA, and must be embedded only once.
+  TreeMatcher<float> matcher(similarity);
+  int numMatches = 0;
+  int numDiffering = 0;
+  for (auto it = std::next(frames.begin()); it != frames.end(); ++it) {
+    const TreeWrapper<float>& treeA = *std::prev(it);
+    const TreeWrapper<float>& treeB = *it;
+    std::vector<int> matching = matcher.match(treeA, treeB);
+
+    TreeEmbedding<float> embeddingA, embeddingB;
+    if (matching !=
+        matchTrees(treeA, treeB, embeddingA, embeddingB, similarity)) {
+      ++numDiffering;
+    }
+    ++numMatches;
+  }
+
+  bool cacheOk = matcher.cacheHits() == size_t(numMatches - 1) &&
+                 matcher.cacheMisses() == frames.size();
+  std::cout << "Matched " << numMatches << " pairs of " << numFrames
+            << " frames, similarity " << similarity << std::endl;
+  std::cout << "Matchings differing from matchTrees: " << numDiffering
+            << std::endl;
+  std::cout << "Cache hits " << matcher.cacheHits() << ", misses "
+            << matcher.cacheMisses() << ": " << (cacheOk ? "ok" : "wrong")
+            << std::endl;
+  std::cout << "Fast path optimal for "
+            << matcher.fastPathStats().numGreedyOptimal << "/"
+            << matcher.fastPathStats().numSolves << " solves" << std::endl;
+
+  return numDiffering == 0 && cacheOk ? 0 : 1;
+}
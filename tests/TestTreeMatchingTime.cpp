@@ -1,14 +1,24 @@
 #include <Python.h>
 
+#include <sys/resource.h>
+
 #include <argparse/argparse.hpp>
 #include <chrono>
+#include <fstream>
 #include <iostream>
 #include <list>
+#include <nlohmann/json.hpp>
+#include <thread>
+#include <utility>
 
+#include "FramePipeline.hpp"
+#include "LatencyHistogram.hpp"
 #include "TreeLoader.hpp"
 #include "TreeMatching.hpp"
 #include "TreeMatchingTestHelper.hpp"
 #include "TreeMatchingVisualizer.hpp"
+#include "TreeTracker.hpp"
+#include "TreeWrapperPool.hpp"
 #include "matplotlibcpp.h"
 
 namespace plt = matplotlibcpp;
@@ -34,6 +44,101 @@ void visualizeTimeOfFrames(const std::list<float>& timeOfFrames,
   plt::show();
 }
 
+// Latency distributions of the stages of a run, in microseconds.
+struct LatencyReport {
+  std::vector<std::pair<std::string, LatencyHistogram>> stages;
+  size_t numFrames = 0;
+  // Seconds from the first to the last frame.
+  double wallTime = 0.0;
+
+  LatencyHistogram& stage(const std::string& name) {
+    for (auto& stage : stages) {
+      if (stage.first == name) return stage.second;
+    }
+    stages.emplace_back(name, LatencyHistogram());
+    return stages.back().second;
+  }
+
+  double throughput() const {
+    return wallTime > 0 ? numFrames / wallTime : 0.0;
+  }
+};
+
+double elapsedMicroseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Peak resident set size of the process in kilobytes.
+long peakRssKilobytes() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+  // macOS reports ru_maxrss in bytes, Linux in kilobytes.
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+void printLatencyReport(const LatencyReport& report) {
+  std::cout << "Frames " << report.numFrames << ", throughput "
+            << report.throughput() << " frames/s, peak RSS "
+            << peakRssKilobytes() << " kB" << std::endl;
+  for (const auto& stage : report.stages) {
+    const LatencyHistogram& histogram = stage.second;
+    std::cout << "Stage " << stage.first << ": p50 "
+              << histogram.percentile(50) << " us, p90 "
+              << histogram.percentile(90) << " us, p99 "
+              << histogram.percentile(99) << " us, p99.9 "
+              << histogram.percentile(99.9) << " us, max " << histogram.max()
+              << " us" << std::endl;
+  }
+}
+
+// Write report as csv if filename ends with .csv, as json otherwise.
+bool writeLatencyReport(const LatencyReport& report,
+                        const std::string& filename) {
+  std::ofstream file(filename);
+  if (!file.is_open()) return false;
+  bool csv = filename.size() >= 4 &&
+             filename.compare(filename.size() - 4, 4, ".csv") == 0;
+  if (csv) {
+    file << "stage,count,mean_us,p50_us,p90_us,p99_us,p999_us,max_us,"
+            "throughput_fps,peak_rss_kb\n";
+    for (const auto& stage : report.stages) {
+      const LatencyHistogram& histogram = stage.second;
+      file << stage.first << "," << histogram.count() << ","
+           << histogram.mean() << "," << histogram.percentile(50) << ","
+           << histogram.percentile(90) << "," << histogram.percentile(99)
+           << "," << histogram.percentile(99.9) << "," << histogram.max()
+           << "," << report.throughput() << "," << peakRssKilobytes()
+           << "\n";
+    }
+  } else {
+    nlohmann::json json;
+    json["frames"] = report.numFrames;
+    json["wall_time_s"] = report.wallTime;
+    json["throughput_fps"] = report.throughput();
+    json["peak_rss_kb"] = peakRssKilobytes();
+    json["stages"] = nlohmann::json::array();
+    for (const auto& stage : report.stages) {
+      const LatencyHistogram& histogram = stage.second;
+      json["stages"].push_back({{"name", stage.first},
+                                {"count", histogram.count()},
+                                {"mean_us", histogram.mean()},
+                                {"p50_us", histogram.percentile(50)},
+                                {"p90_us", histogram.percentile(90)},
+                                {"p99_us", histogram.percentile(99)},
+                                {"p999_us", histogram.percentile(99.9)},
+                                {"max_us", histogram.max()}});
+    }
+    file << json.dump(2) << "\n";
+  }
+  return file.good();
+}
+
 int main(int argc, char* argv[]) {
   argparse::ArgumentParser parser("tree_maximum_matching");
   parser.add_argument("--trees1").default_value("").help("json file of trees1");
@@ -41,6 +146,21 @@ int main(int argc, char* argv[]) {
   parser.add_argument("--similarity")
       .default_value("cosine")
       .help("similarity method: cosine or euclidean");
+  parser.add_argument("--pipeline")
+      .default_value(false)
+      .implicit_value(true)
+      .help("match frames in a pipeline with overlapping stages");
+  parser.add_argument("--track")
+      .default_value(false)
+      .implicit_value(true)
+      .help("track the nodes of trees1 as one stream of frames");
+  parser.add_argument("--headless")
+      .default_value(false)
+      .implicit_value(true)
+      .help("no plots and no per frame output, print a latency report");
+  parser.add_argument("--report")
+      .default_value(std::string(""))
+      .help("write the latency report to this .json or .csv file");
 
   try {
     parser.parse_args(argc, argv);
@@ -52,6 +172,13 @@ int main(int argc, char* argv[]) {
   std::string trees1json = parser.get<std::string>("--trees1");
   std::string trees2json = parser.get<std::string>("--trees2");
   std::string similarity = parser.get<std::string>("--similarity");
+  bool pipeline = parser.get<bool>("--pipeline");
+  bool track = parser.get<bool>("--track");
+  bool headless = parser.get<bool>("--headless");
+  std::string reportFile = parser.get<std::string>("--report");
+  // The latencies of a headless run must not include the debug output of
+  // matchTrees.
+  if (headless) debugOutputEnabled() = false;
 
   std::list<TreeWrapper<float>> treesA;
   if (!loadTreesFromJson(treesA, trees1json)) {
@@ -89,6 +216,19 @@ int main(int argc, char* argv[]) {
   }
 
   std::list<float> timeOfFrames;
+  LatencyReport report;
+  // Print and write the report once all frames are done.
+  auto finishReport = [&]() {
+    if (headless) printLatencyReport(report);
+    if (!reportFile.empty() && !writeLatencyReport(report, reportFile)) {
+      std::cerr << "Failed to write the latency report to " << reportFile
+                << std::endl;
+      return false;
+    }
+    return true;
+  };
+  // Recycles the sorted trees of the frames with their node buffers.
+  TreeWrapperPool<float> treePool;
   std::list<TreeWrapper<float>>::iterator treesAIter = treesA.begin();
   std::list<TreeWrapper<float>>::iterator treesBIter = treesB.begin();
 
@@ -97,6 +237,126 @@ int main(int argc, char* argv[]) {
   std::string treeBEdgeColor = "blue";
   std::string matchLineColor = "green";
 
+  if (track) {
+    TreeMatchingOptions<float> options;
+    options.similarityType = similarity;
+    TreeTracker<float> tracker(options);
+    auto runStart = std::chrono::steady_clock::now();
+    for (TreeWrapper<float>& tree : treesA) {
+      auto frameStart = std::chrono::steady_clock::now();
+      // Convert point from vehicle coordinate system(x->forward, y->left) to
+      // nomal coordinate system(x->right, y->forward).
+      clockwiseRotate90Degrees(tree);
+      TreeWrapper<float> sortedTree = treePool.acquire(tree.nodes.size());
+      std::vector<int> sortedTreeIndices;
+      sortTree(tree, sortedTree, sortedTreeIndices);
+      report.stage("sort").record(elapsedMicroseconds(frameStart));
+
+      const std::vector<int>& trackIds = tracker.update(sortedTree);
+      report.stage("frame").record(elapsedMicroseconds(frameStart));
+      timeOfFrames.push_back(tracker.stats().lastLatency);
+      if (!headless) {
+        std::cout << "Frame of timestamp " << sortedTree.timestamp << ": "
+                  << trackIds.size() << " nodes, " << tracker.numTracks()
+                  << " tracks so far, " << tracker.stats().lastLatency
+                  << " us" << std::endl;
+      }
+      treePool.release(std::move(sortedTree));
+    }
+    report.numFrames = treesA.size();
+    report.wallTime = elapsedMicroseconds(runStart) / 1e6;
+    report.stage("track") = tracker.stats().histogram;
+
+    const TrackerStats& stats = tracker.stats();
+    std::cout << "Tracker: frames " << stats.histogram.count() << ", mean "
+              << stats.histogram.mean() << " us, min " << stats.histogram.min()
+              << " us, max " << stats.histogram.max() << " us" << std::endl;
+    if (!headless) {
+      visualizeTimeOfFrames(timeOfFrames,
+                            "Time consumption per frame of tree tracking (" +
+                                similarity + ")");
+    }
+    return finishReport() ? 0 : -5;
+  }
+
+  if (pipeline) {
+    FramePipeline<float> framePipeline;
+    // Convert point from vehicle coordinate system(x->forward, y->left) to
+    // nomal coordinate system(x->right, y->forward) in the first stage.
+    addMatchingStages(framePipeline, similarity, true);
+    framePipeline.start();
+
+    // Feed the frames from another thread so that the stages overlap. The
+    // input trees are not needed afterwards and are moved into the slots.
+    std::thread producer([&]() {
+      while (treesAIter != treesA.end() && treesBIter != treesB.end()) {
+        MatchingFrame<float>* slot = framePipeline.acquireFrame();
+        if (slot == nullptr) break;
+        slot->treeA = std::move(*treesAIter++);
+        slot->treeB = std::move(*treesBIter++);
+        framePipeline.push(slot);
+      }
+      framePipeline.finish();
+    });
+
+    auto runStart = std::chrono::steady_clock::now();
+    auto last = std::chrono::high_resolution_clock::now();
+    while (MatchingFrame<float>* slot = framePipeline.popFrame()) {
+      const MatchingFrame<float>& frame = *slot;
+      auto now = std::chrono::high_resolution_clock::now();
+      auto duration =
+          std::chrono::duration_cast<std::chrono::microseconds>(now - last);
+      timeOfFrames.push_back(duration.count());
+      // Time between two output frames, the inverse of the throughput.
+      report.stage("frame").record(
+          std::chrono::duration<double, std::micro>(now - last).count());
+      report.numFrames++;
+
+      if (!headless) {
+        printMatching(frame.matching, "sortedTreeA", "sortedTreeB",
+                      frame.sortedTreeA.timestamp,
+                      frame.sortedTreeB.timestamp);
+
+        // Visualize the trees and their matching.
+        visualizeTreesMatching(frame.sortedTreeA, frame.sortedTreeB,
+                               frame.matching, similarity, treeAEdgeColor,
+                               treeBEdgeColor, matchLineColor);
+      }
+      framePipeline.releaseFrame(slot);
+      last = std::chrono::high_resolution_clock::now();
+    }
+    producer.join();
+    report.wallTime = elapsedMicroseconds(runStart) / 1e6;
+
+    for (const StageStats& stats : framePipeline.stats()) {
+      std::cout << "Stage " << stats.name << ": frames "
+                << stats.histogram.count() << ", mean "
+                << stats.histogram.mean() << " us, min "
+                << stats.histogram.min() << " us, max "
+                << stats.histogram.max() << " us, blocked "
+                << stats.totalBlocked << " us" << std::endl;
+      report.stage(stats.name) = stats.histogram;
+    }
+
+    if (!headless) {
+      visualizeTimeOfFrames(timeOfFrames,
+                            "Time consumption per frame of pipelined tree "
+                            "matching (" +
+                                similarity + ")");
+    }
+    return finishReport() ? 0 : -5;
+  }
+
+  // The sequential matches report how often the greedy fast path of the
+  // solver was already optimal.
+  FastPathStats fastPathStats;
+  TreeMatchingOptions<float> matchingOptions;
+  matchingOptions.similarityType = similarity;
+  matchingOptions.fastPathStats = &fastPathStats;
+  // Scratch memory of sorting and solving, reset for every frame.
+  FrameArena frameArena;
+  auto runStart = std::chrono::steady_clock::now();
+
   // Cosine match
   while (similarity == "cosine" && treesAIter != treesA.end() &&
          treesBIter != treesB.end()) {
@@ -104,40 +364,55 @@ int main(int argc, char* argv[]) {
     TreeWrapper<float>& treeB = *treesBIter;
     ++treesAIter;
     ++treesBIter;
+    auto frameStart = std::chrono::steady_clock::now();
+    frameArena.reset();
 
-    TreeWrapper<float> sortedTreeA;
+    TreeWrapper<float> sortedTreeA = treePool.acquire(treeA.nodes.size());
     std::vector<int> sortedTreeAIndices;
     // Convert point from vehicle coordinate system(x->forward, y->left) to
     // nomal coordinate system(x->right, y->forward).
     clockwiseRotate90Degrees(treeA);
-    sortTree(treeA, sortedTreeA, sortedTreeAIndices);
+    sortTree(treeA, sortedTreeA, sortedTreeAIndices, frameArena);
 
-    TreeWrapper<float> sortedTreeB;
+    TreeWrapper<float> sortedTreeB = treePool.acquire(treeB.nodes.size());
     std::vector<int> sortedTreeBIndices;
     // Convert point from vehicle coordinate system(x->forward, y->left) to
     // nomal coordinate system(x->right, y->forward).
     clockwiseRotate90Degrees(treeB);
-    sortTree(treeB, sortedTreeB, sortedTreeBIndices);
+    sortTree(treeB, sortedTreeB, sortedTreeBIndices, frameArena);
+    report.stage("sort").record(elapsedMicroseconds(frameStart));
 
     auto start = std::chrono::high_resolution_clock::now();
-    std::vector<int> cosMatchRes = matchTrees(sortedTreeA, sortedTreeB);
+    std::vector<int> cosMatchRes =
+        matchTrees(sortedTreeA, sortedTreeB, matchingOptions, frameArena);
     auto end = std::chrono::high_resolution_clock::now();
     auto duration =
         std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 
     timeOfFrames.push_back(duration.count());
-    printMatching(cosMatchRes, "sortedTreeA", "sortedTreeB",
-                  sortedTreeA.timestamp, sortedTreeB.timestamp);
-
-    // Visualize the trees and their cosine matching.
-    visualizeTreesMatching(sortedTreeA, sortedTreeB, cosMatchRes, "cosine",
-                           treeAEdgeColor, treeBEdgeColor, matchLineColor);
+    report.stage("match").record(
+        std::chrono::duration<double, std::micro>(end - start).count());
+    report.stage("frame").record(elapsedMicroseconds(frameStart));
+    report.numFrames++;
+
+    if (!headless) {
+      printMatching(cosMatchRes, "sortedTreeA", "sortedTreeB",
+                    sortedTreeA.timestamp, sortedTreeB.timestamp);
+
+      // Visualize the trees and their cosine matching.
+      visualizeTreesMatching(sortedTreeA, sortedTreeB, cosMatchRes, "cosine",
+                             treeAEdgeColor, treeBEdgeColor, matchLineColor);
+    }
+
+    treePool.release(std::move(sortedTreeA));
+    treePool.release(std::move(sortedTreeB));
   }
 
-  if (similarity == "cosine") {
+  if (similarity == "cosine" && !headless) {
     visualizeTimeOfFrames(
         timeOfFrames, "Time consumption per frame of tree matching (cosine)");
-
+  }
+  if (similarity == "cosine") {
     timeOfFrames.clear();
     treesAIter = treesA.begin();
     treesBIter = treesB.begin();
@@ -150,43 +425,68 @@ int main(int argc, char* argv[]) {
     TreeWrapper<float>& treeB = *treesBIter;
     ++treesAIter;
     ++treesBIter;
+    auto frameStart = std::chrono::steady_clock::now();
+    frameArena.reset();
 
-    TreeWrapper<float> sortedTreeA;
+    TreeWrapper<float> sortedTreeA = treePool.acquire(treeA.nodes.size());
     std::vector<int> sortedTreeAIndices;
     // Convert point from vehicle coordinate system(x->forward, y->left) to
     // nomal coordinate system(x->right, y->forward).
     clockwiseRotate90Degrees(treeA);
-    sortTree(treeA, sortedTreeA, sortedTreeAIndices);
+    sortTree(treeA, sortedTreeA, sortedTreeAIndices, frameArena);
 
-    TreeWrapper<float> sortedTreeB;
+    TreeWrapper<float> sortedTreeB = treePool.acquire(treeB.nodes.size());
     std::vector<int> sortedTreeBIndices;
     // Convert point from vehicle coordinate system(x->forward, y->left) to
     // nomal coordinate system(x->right, y->forward).
     clockwiseRotate90Degrees(treeB);
-    sortTree(treeB, sortedTreeB, sortedTreeBIndices);
+    sortTree(treeB, sortedTreeB, sortedTreeBIndices, frameArena);
+    report.stage("sort").record(elapsedMicroseconds(frameStart));
 
     auto start = std::chrono::high_resolution_clock::now();
     std::vector<int> euclideanMatchRes =
-        matchTrees(sortedTreeA, sortedTreeB, "euclidean");
+        matchTrees(sortedTreeA, sortedTreeB, matchingOptions, frameArena);
     auto end = std::chrono::high_resolution_clock::now();
     auto duration =
         std::chrono::duration_cast<std::chrono::microseconds>(end - start);
 
     timeOfFrames.push_back(duration.count());
-    printMatching(euclideanMatchRes, "sortedTreeA", "sortedTreeB",
-                  sortedTreeA.timestamp, sortedTreeB.timestamp);
-
-    // Visualize the trees and their euclidean matching.
-    visualizeTreesMatching(sortedTreeA, sortedTreeB, euclideanMatchRes,
-                           "euclidean", treeAEdgeColor, treeBEdgeColor,
-                           matchLineColor);
+    report.stage("match").record(
+        std::chrono::duration<double, std::micro>(end - start).count());
+    report.stage("frame").record(elapsedMicroseconds(frameStart));
+    report.numFrames++;
+
+    if (!headless) {
+      printMatching(euclideanMatchRes, "sortedTreeA", "sortedTreeB",
+                    sortedTreeA.timestamp, sortedTreeB.timestamp);
+
+      // Visualize the trees and their euclidean matching.
+      visualizeTreesMatching(sortedTreeA, sortedTreeB, euclideanMatchRes,
+                             "euclidean", treeAEdgeColor, treeBEdgeColor,
+                             matchLineColor);
+    }
+
+    treePool.release(std::move(sortedTreeA));
+    treePool.release(std::move(sortedTreeB));
   }
 
-  if (similarity == "euclidean") {
+  if (similarity == "euclidean" && !headless) {
     visualizeTimeOfFrames(
         timeOfFrames,
         "Time consumption per frame of tree matching (euclidean)");
   }
 
-  return 0;
+  report.wallTime = elapsedMicroseconds(runStart) / 1e6;
+
+  std::cout << "Fast path: optimal for " << fastPathStats.numGreedyOptimal
+            << "/" << fastPathStats.numSolves << " solves, hit rate "
+            << fastPathStats.hitRate() << ", rows matched greedily "
+            << fastPathStats.numGreedyRows << ", augmented "
+            << fastPathStats.numAugmentedRows << std::endl;
+  TreeWrapperPoolStats poolStats = treePool.stats();
+  std::cout << "Tree pool: hits " << poolStats.hits << ", misses "
+            << poolStats.misses << ", high-water mark "
+            << poolStats.highWaterMark << std::endl;
+
+  return finishReport() ? 0 : -5;
 }
\ No newline at end of file
@@ -1,12 +1,141 @@
+#include <algorithm>
 #include <argparse/argparse.hpp>
+#include <functional>
 #include <iostream>
 
+#include "TreeGenerator.hpp"
 #include "TreeLoader.hpp"
 #include "TreeMatchingTestHelper.hpp"
 #include "TreeMatchingVisualizer.hpp"
 #include "TreePreservingEmbedding.hpp"
 #include "TreePreservingEmbeddingVisualizer.hpp"
 
+// Whether any TPE field of two nodes differs.
+bool isTpeDifferent(const TreeNode<float>& nodeA,
+                    const TreeNode<float>& nodeB) {
+  return nodeA.tpeX != nodeB.tpeX || nodeA.tpeY != nodeB.tpeY ||
+         nodeA.tpeRadius != nodeB.tpeRadius ||
+         nodeA.tpeMinAngle != nodeB.tpeMinAngle ||
+         nodeA.tpeMaxAngle != nodeB.tpeMaxAngle ||
+         nodeA.tpeAngle != nodeB.tpeAngle || nodeA.tpeLevel != nodeB.tpeLevel;
+}
+
+int computeMaxLevel(const TreeWrapper<float>& tree) {
+  int maxLevel = 0;
+  for (const TreeNode<float>& node : tree.nodes) {
+    maxLevel = std::max(maxLevel, node.tpeLevel);
+  }
+  return maxLevel;
+}
+
+// Apply edit to a copy of tree, whose TPE has been generated, and update the
+// TPE of the copy with dirtyNodes. The result must equal a full
+// generateTreePreservingEmbedding, and the returned nodes must be exactly the
+// nodes whose TPE differs from before the edit (nodes added by the edit
+// compare against a default node).
+bool checkUpdate(const TreeWrapper<float>& tree, const std::string& name,
+                 const std::function<std::vector<int>(TreeWrapper<float>&)>&
+                     edit) {
+  TreeWrapper<float> updated = tree;
+  std::vector<int> dirtyNodes = edit(updated);
+  TreeWrapper<float> expected = updated;
+  generateTreePreservingEmbedding(expected);
+  std::vector<int> changedNodes =
+      updateTreePreservingEmbedding(updated, dirtyNodes);
+
+  int numWrong = 0;
+  std::vector<int> expectedChanged;
+  for (size_t i = 0; i < expected.nodes.size(); ++i) {
+    if (isTpeDifferent(updated.nodes[i], expected.nodes[i])) ++numWrong;
+    TreeNode<float> before =
+        i < tree.nodes.size() ? tree.nodes[i] : TreeNode<float>();
+    if (isTpeDifferent(before, expected.nodes[i])) {
+      expectedChanged.push_back(i);
+    }
+  }
+  std::sort(changedNodes.begin(), changedNodes.end());
+  bool ok = numWrong == 0 && changedNodes == expectedChanged;
+  std::cout << "Update after " << name << ": max level "
+            << computeMaxLevel(tree) << " -> " << computeMaxLevel(expected)
+            << ", " << numWrong << " nodes differing from a full TPE, "
+            << changedNodes.size() << "/" << expectedChanged.size()
+            << " changed nodes reported: " << (ok ? "ok" : "wrong")
+            << std::endl;
+  return ok;
+}
+
+// Add a leaf below parent, 10 units further from the root.
+int addLeaf(TreeWrapper<float>& tree, int parent) {
+  TreeNode<float> leaf;
+  leaf.parent = parent;
+  leaf.posX = tree.nodes[parent].posX + 1.0f;
+  leaf.posY = tree.nodes[parent].posY + 10.0f;
+  tree.nodes.push_back(leaf);
+  int idx = tree.nodes.size() - 1;
+  tree.nodes[parent].children.push_back(idx);
+  return idx;
+}
+
+// Check updateTreePreservingEmbedding against generateTreePreservingEmbedding
+// for leaf insertions, moves, a root edit and a change of the maximum level.
+bool checkUpdates() {
+  TreeGeneratorOptions options;
+  options.numNodes = 200;
+  TreeGenerator<float> generator(options);
+  TreeWrapper<float> tree;
+  std::vector<int> sortedIndices;
+  sortTree(generator.generateTree(), tree, sortedIndices);
+  generateTreePreservingEmbedding(tree);
+
+  int maxLevel = computeMaxLevel(tree);
+  std::vector<int> shallowNodes, deepestNodes, leaves;
+  for (size_t i = 1; i < tree.nodes.size(); ++i) {
+    if (tree.nodes[i].tpeLevel + 1 < maxLevel) shallowNodes.push_back(i);
+    if (tree.nodes[i].tpeLevel == maxLevel) deepestNodes.push_back(i);
+    if (tree.nodes[i].children.empty()) leaves.push_back(i);
+  }
+  if (shallowNodes.size() < 2 || deepestNodes.empty() || leaves.size() < 2) {
+    std::cerr << "Generated tree is too small to check the TPE update"
+              << std::endl;
+    return false;
+  }
+
+  bool ok = true;
+  // The nodes are in breadth first order, the last shallow nodes are the
+  // deepest ones below which a leaf does not change the maximum level.
+  int parentA = shallowNodes[shallowNodes.size() - 1];
+  int parentB = shallowNodes[shallowNodes.size() - 2];
+  ok &= checkUpdate(tree, "leaf insertions", [&](TreeWrapper<float>& t) {
+    return std::vector<int>{addLeaf(t, parentA), addLeaf(t, parentB)};
+  });
+  ok &= checkUpdate(tree, "leaf move", [&](TreeWrapper<float>& t) {
+    // Reparent a leaf, both its old parent and the leaf are dirty.
+    int leaf = leaves[0];
+    int oldParent = t.nodes[leaf].parent;
+    std::vector<int>& siblings = t.nodes[oldParent].children;
+    siblings.erase(std::find(siblings.begin(), siblings.end(), leaf));
+    int newParent = parentA != oldParent ? parentA : parentB;
+    t.nodes[leaf].parent = newParent;
+    t.nodes[newParent].children.push_back(leaf);
+    return std::vector<int>{leaf, oldParent};
+  });
+  ok &= checkUpdate(tree, "position move", [&](TreeWrapper<float>& t) {
+    // Move a leaf onto its parent, which lowers its level.
+    int leaf = leaves[1];
+    t.nodes[leaf].posX = t.nodes[t.nodes[leaf].parent].posX;
+    t.nodes[leaf].posY = t.nodes[t.nodes[leaf].parent].posY;
+    return std::vector<int>{leaf};
+  });
+  ok &= checkUpdate(tree, "root edit", [&](TreeWrapper<float>& t) {
+    std::reverse(t.nodes[0].children.begin(), t.nodes[0].children.end());
+    return std::vector<int>{0};
+  });
+  ok &= checkUpdate(tree, "max level change", [&](TreeWrapper<float>& t) {
+    return std::vector<int>{addLeaf(t, deepestNodes[0])};
+  });
+  return ok;
+}
+
 int main(int argc, char* argv[]) {
   argparse::ArgumentParser parser("tree_maximum_matching");
   parser.add_argument("--tree").default_value("").help("json file of tree");
@@ -14,6 +143,10 @@ int main(int argc, char* argv[]) {
       .default_value(false)
       .implicit_value(true)
       .help("clockwise rotate 90 degrees");
+  parser.add_argument("--check-update")
+      .default_value(false)
+      .implicit_value(true)
+      .help("check the incremental TPE update against the full TPE and exit");
 
   try {
     parser.parse_args(argc, argv);
@@ -24,6 +157,9 @@ int main(int argc, char* argv[]) {
 
   std::string treeJson = parser.get<std::string>("--tree");
   bool rotate = parser.get<bool>("--rotate");
+  if (parser.get<bool>("--check-update")) {
+    return checkUpdates() ? 0 : 1;
+  }
 
   bool block = false;
 
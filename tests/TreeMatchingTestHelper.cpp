@@ -1,5 +1,6 @@
 #include "TreeMatchingTestHelper.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <random>
 
@@ -143,6 +144,60 @@ TreeWrapper<T> generateTreeB(const TreeWrapper<T>& treeA) {
   return treeB;
 }
 
+std::vector<std::vector<int>> generateTreeStructure(int numNodes,
+                                                    unsigned int seed) {
+  std::vector<std::vector<int>> treeStructure(numNodes);
+  std::mt19937 rng(seed);
+  for (int i = 1; i < numNodes; ++i) {
+    std::uniform_int_distribution<int> distParent(std::max(0, i - 8), i - 1);
+    treeStructure[distParent(rng)].push_back(i);
+  }
+  return treeStructure;
+}
+
+int countCorrectMatches(const std::vector<int>& matching,
+                        const std::vector<int>& sortedTreeAIndices,
+                        const std::vector<int>& sortedTreeBIndices) {
+  std::vector<int> sortedPositionB(sortedTreeBIndices.size(), -1);
+  for (size_t j = 0; j < sortedTreeBIndices.size(); ++j) {
+    sortedPositionB[sortedTreeBIndices[j]] = j;
+  }
+  int correct = 0;
+  for (size_t i = 0; i < matching.size(); ++i) {
+    if (matching[i] >= 0 &&
+        matching[i] == sortedPositionB[sortedTreeAIndices[i]]) {
+      ++correct;
+    }
+  }
+  return correct;
+}
+
+template <typename T>
+int countParentConsistentMatches(const std::vector<int>& matching,
+                                 const TreeWrapper<T>& treeA,
+                                 const TreeWrapper<T>& treeB) {
+  int consistent = 0;
+  for (size_t i = 1; i < matching.size(); ++i) {
+    if (matching[i] < 0) continue;
+    int parentA = treeA.nodes[i].parent;
+    int parentB = treeB.nodes[matching[i]].parent;
+    if (parentA >= 0 && parentB >= 0 && matching[parentA] == parentB) {
+      ++consistent;
+    }
+  }
+  return consistent;
+}
+
+template <typename T>
+T computeMatchingCost(const std::vector<int>& matching,
+                      const std::vector<std::vector<T>>& costMatrix) {
+  T cost = 0;
+  for (size_t i = 0; i < matching.size(); ++i) {
+    if (matching[i] >= 0) cost += costMatrix[i][matching[i]];
+  }
+  return cost;
+}
+
 // Explicit instantiations for type to use.
 template void assignPositions<float>(
     std::vector<TreeNode<float>>& nodes, int nodeIdx, float x, float y,
@@ -153,4 +208,12 @@ template TreeWrapper<float> generateTreeA<float>(
     const std::vector<std::vector<int>>& treeStructure);
 
 template TreeWrapper<float> generateTreeB<float>(
-    const TreeWrapper<float>& treeA);
\ No newline at end of file
+    const TreeWrapper<float>& treeA);
+
+template int countParentConsistentMatches<float>(
+    const std::vector<int>& matching, const TreeWrapper<float>& treeA,
+    const TreeWrapper<float>& treeB);
+
+template float computeMatchingCost<float>(
+    const std::vector<int>& matching,
+    const std::vector<std::vector<float>>& costMatrix);
@@ -5,4 +5,26 @@ TreeWrapper<T> generateTreeA(
     const std::vector<std::vector<int>>& treeStructure);
 
 template <typename T>
-TreeWrapper<T> generateTreeB(const TreeWrapper<T>& treeA);
\ No newline at end of file
+TreeWrapper<T> generateTreeB(const TreeWrapper<T>& treeA);
+
+// Random tree structure of numNodes nodes: every node gets a parent among the
+// few nodes created before it, so the tree is both deep and branchy.
+std::vector<std::vector<int>> generateTreeStructure(int numNodes,
+                                                    unsigned int seed);
+
+// Number of nodes of sortedTreeA matched to the sorted node of treeB which was
+// generated from the same node.
+int countCorrectMatches(const std::vector<int>& matching,
+                        const std::vector<int>& sortedTreeAIndices,
+                        const std::vector<int>& sortedTreeBIndices);
+
+// Number of matched nodes whose parents are matched to each other.
+template <typename T>
+int countParentConsistentMatches(const std::vector<int>& matching,
+                                 const TreeWrapper<T>& treeA,
+                                 const TreeWrapper<T>& treeB);
+
+// Total cost of the matched pairs of matching in costMatrix.
+template <typename T>
+T computeMatchingCost(const std::vector<int>& matching,
+                      const std::vector<std::vector<T>>& costMatrix);